@@ -0,0 +1,150 @@
+/*
+ * Benchmark of the replay of compressed ITCH archives
+ *
+ * Build with `make bench_archive`, or `make bench_archive ZSTD=1` to
+ * include zstd archives, then run
+ *   ./bench_archive [messages] [directory]
+ *
+ * A synthetic stream from the Generator is written to the directory as a
+ * plain file and a gzip archive, then replayed through a BookManager:
+ *  - from a mapping of the plain file, the baseline
+ *  - from the gzip archive, decompressed inline with gzread
+ *  - from the gzip archive through ArchiveReader, decompressing on a
+ *    dedicated thread while the books are updated
+ * Decompression alone, draining ArchiveReader, gives the bound of the
+ * overlap. The page cache is warm, every file is read once beforehand.
+ */
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/archive.hpp"
+#include "../include/filesystem.hpp"
+#include "../include/generator.hpp"
+#include "../include/manager.hpp"
+
+namespace {
+
+bool WriteGzip(const std::string& path, const std::vector<uint8_t>& bytes) {
+    gzFile file = gzopen(path.c_str(), "wb6");
+    if (file == nullptr) return false;
+    // gzwrite takes at most UINT_MAX bytes at once
+    const std::size_t chunk = 1 << 26;
+    bool ok = true;
+    for (std::size_t i = 0; ok && i < bytes.size(); i += chunk) {
+        const unsigned size =
+            static_cast<unsigned>(std::min(chunk, bytes.size() - i));
+        ok = gzwrite(file, bytes.data() + i, size) == static_cast<int>(size);
+    }
+    return gzclose(file) == Z_OK && ok;
+}
+
+bool WritePlain(const std::string& path, const std::vector<uint8_t>& bytes) {
+    FileSystem::FileWriter file{FileSystem::Path(path)};
+    if (!file.Open(true)) return false;
+    const bool ok = file.Write(bytes.data(), bytes.size());
+    file.Close();
+    return ok;
+}
+
+template <class Function>
+void Measure(const char* name, const std::size_t messages,
+             const std::size_t bytes, Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t processed = function();
+    const auto stop = std::chrono::steady_clock::now();
+    const double seconds =
+        std::chrono::duration<double>(stop - start).count();
+    std::printf("%-28s %8.1f ns/msg %8.1f MB/s  (%llu)\n", name,
+                seconds * 1e9 / messages, bytes / seconds / 1e6,
+                static_cast<unsigned long long>(processed));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t messages =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    const std::string directory = argc > 2 ? argv[2] : ".";
+    const std::string plain = directory + "/bench_archive.itch";
+    const std::string gzip = plain + ".gz";
+
+    std::vector<uint8_t> stream;
+    {
+        GeneratorConfig config;
+        Generator generator(config);
+        generator.start(stream);
+        generator.generate(messages, stream);
+        generator.finish(stream);
+    }
+    if (!WritePlain(plain, stream) || !WriteGzip(gzip, stream)) {
+        std::fprintf(stderr, "Failed to write %s\n", directory.c_str());
+        return 1;
+    }
+    const std::size_t size = stream.size();
+    std::vector<uint8_t>().swap(stream);
+
+    FileSystem::ArchiveReader warm{FileSystem::Path(gzip)};
+    warm.Open();
+    const void* data;
+    std::size_t length;
+    while (warm.Next(data, length)) {
+    }
+    std::printf("%zu messages, %zu bytes, %llu compressed\n", messages, size,
+                static_cast<unsigned long long>(warm.compressed_size()));
+    warm.Close();
+
+    Measure("mmap plain", messages, size, [&] {
+        FileSystem::MappedFile file{FileSystem::Path(plain)};
+        file.Open(true, true);
+        BookManager manager;
+        manager.Process(file.data(), file.size());
+        return manager.order_count();
+    });
+
+    Measure("gzread inline", messages, size, [&] {
+        gzFile file = gzopen(gzip.c_str(), "rb");
+        gzbuffer(file, 1 << 20);
+        std::unique_ptr<char[]> buffer(
+            new char[FileSystem::ArchiveReader::DEFAULT_BLOCK]);
+        BookManager manager;
+        int got;
+        while ((got = gzread(file, buffer.get(),
+                             FileSystem::ArchiveReader::DEFAULT_BLOCK)) > 0) {
+            manager.Process(buffer.get(), got);
+        }
+        gzclose(file);
+        return manager.order_count();
+    });
+
+    Measure("ArchiveReader gzip", messages, size, [&] {
+        FileSystem::ArchiveReader file{FileSystem::Path(gzip)};
+        file.Open();
+        BookManager manager;
+        while (file.Next(data, length)) {
+            manager.Process(data, length);
+        }
+        return manager.order_count();
+    });
+
+    Measure("ArchiveReader gzip, drain", messages, size, [&] {
+        FileSystem::ArchiveReader file{FileSystem::Path(gzip)};
+        file.Open();
+        while (file.Next(data, length)) {
+        }
+        return file.size();
+    });
+
+    std::remove(plain.c_str());
+    std::remove(gzip.c_str());
+    return 0;
+}
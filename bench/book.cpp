@@ -0,0 +1,324 @@
+/*
+ * Microbenchmarks of the Book hot paths
+ *
+ * Build with `make bench`, then run
+ *   ./bench_book [levels] [orders per level] [sweep levels]
+ * Without arguments a grid of book shapes is measured.
+ *
+ * Workloads, each on books of `levels` price levels per side holding
+ * `orders per level` orders:
+ *  - passive, inserting the non-marketable bids and asks of the book
+ *  - cancel, canceling every resting order in random order
+ *  - sweep, marketable bids crossing `sweep levels` ask levels each
+ *  - aon, passive bids inserted against asks holding only unfillable
+ *    all-or-nothing orders, every insert rechecks them
+ *  - cascade, one marketable bid firing a chain of stop triggers, each
+ *    trigger buying the next ask level
+ *  - stops, marketable bids filling one order each while stop triggers
+ *    rest beyond the book on both sides, none of them fires
+ *  - load / batch, loading a snapshot of both sides, orders with
+ *    reference numbers created beforehand, with one insert per order or
+ *    with a single insert_batch
+ *
+ * Setup runs outside the timed section, the best of a few rounds is
+ * reported as ns/op along with heap allocations/op, counted through the
+ * global operator new. Books are warmed up first, so that the one-off
+ * allocation of their ladders is not charged to the workloads.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "../include/book.hpp"
+
+namespace {
+std::size_t allocations = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* pointer = std::malloc(size != 0 ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+const Utils::Price bid_touch = 100000;
+const Utils::Price ask_touch = bid_touch + 1;
+const std::size_t min_ops = 1000;
+
+struct Shape {
+    std::size_t levels;
+    std::size_t orders;
+    std::size_t sweep;
+};
+
+/*
+ * @brief time `ops` operations done by run(), after setup() prepared the
+ * state they need, and report the best round
+ */
+template <class State, class Setup, class Run>
+void Measure(const char* name, const Shape& shape, const std::size_t ops,
+             Setup setup, Run run) {
+    // small workloads get more rounds to find a quiet one
+    const std::size_t rounds = ops < min_ops ? 50 : 5;
+
+    double best_ns = 0;
+    double best_allocations = 0;
+    for (std::size_t round = 0; round < rounds; ++round) {
+        State state;
+        setup(state);
+
+        const std::size_t allocated = allocations;
+        const auto start = std::chrono::steady_clock::now();
+        run(state);
+        const auto stop = std::chrono::steady_clock::now();
+
+        const double ns =
+            std::chrono::duration<double, std::nano>(stop - start).count() /
+            ops;
+        if (round == 0 || ns < best_ns) {
+            best_ns = ns;
+            best_allocations =
+                static_cast<double>(allocations - allocated) / ops;
+        }
+    }
+    std::printf("%-10s %7zu %7zu %9zu %12.1f %12.2f\n", name, shape.levels,
+                shape.orders, ops, best_ns, best_allocations);
+}
+
+// books start warm: ladders and the first pool slab are allocated
+struct BookState {
+    std::unique_ptr<Book> book{new Book()};
+    std::vector<SharedOrderPtr> orders;
+
+    BookState() {
+        book->insert<Order>(Utils::Side::bid, bid_touch, 1.0)->cancel();
+        book->insert<Order>(Utils::Side::ask, ask_touch, 1.0)->cancel();
+    }
+};
+
+void Fill(Book& book, const Utils::Side side, const Shape& shape,
+          const bool all_or_nothing, const double quantity,
+          std::vector<SharedOrderPtr>* orders = nullptr) {
+    for (std::size_t level = 0; level < shape.levels; ++level) {
+        const Utils::Price price =
+            side == Utils::Side::bid
+                ? bid_touch - static_cast<Utils::Price>(level)
+                : ask_touch + static_cast<Utils::Price>(level);
+        for (std::size_t i = 0; i < shape.orders; ++i) {
+            auto order = book.insert<Order>(side, price, quantity, false,
+                                            all_or_nothing);
+            if (orders != nullptr) orders->push_back(order);
+        }
+    }
+}
+
+void Passive(const Shape& shape) {
+    const std::size_t ops = 2 * shape.levels * shape.orders;
+    Measure<BookState>(
+        "passive", shape, ops, [](BookState&) {},
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::bid, shape, false, 1.0);
+            Fill(*state.book, Utils::Side::ask, shape, false, 1.0);
+        });
+}
+
+void Cancel(const Shape& shape) {
+    const std::size_t ops = 2 * shape.levels * shape.orders;
+    Measure<BookState>(
+        "cancel", shape, ops,
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::bid, shape, false, 1.0,
+                 &state.orders);
+            Fill(*state.book, Utils::Side::ask, shape, false, 1.0,
+                 &state.orders);
+            std::shuffle(state.orders.begin(), state.orders.end(),
+                         std::mt19937(7));
+        },
+        [](BookState& state) {
+            for (const SharedOrderPtr& order : state.orders) {
+                order->cancel();
+            }
+        });
+}
+
+void Sweep(const Shape& shape) {
+    const std::size_t sweep = std::min(shape.sweep, shape.levels);
+    const std::size_t ops = shape.levels / sweep;
+    Measure<BookState>(
+        "sweep", shape, ops,
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::ask, shape, false, 1.0);
+        },
+        [&](BookState& state) {
+            for (std::size_t i = 0; i < ops; ++i) {
+                const Utils::Price price = ask_touch +
+                    static_cast<Utils::Price>((i + 1) * sweep - 1);
+                state.book->insert<Order>(Utils::Side::bid, price,
+                                          static_cast<double>(
+                                              sweep * shape.orders));
+            }
+        });
+}
+
+void AllOrNothing(const Shape& shape) {
+    const std::size_t ops = 1000;
+    Measure<BookState>(
+        "aon", shape, ops,
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::ask, shape, true, 1e9);
+        },
+        [&](BookState& state) {
+            for (std::size_t i = 0; i < ops; ++i) {
+                const Utils::Price price =
+                    bid_touch - static_cast<Utils::Price>(i % shape.levels);
+                state.book->insert<Order>(Utils::Side::bid, price, 1.0);
+            }
+        });
+}
+
+// buys the ask level above its own price once the market reaches it
+class StopBuy : public Trigger {
+   public:
+    StopBuy(const Utils::Price price, const double quantity)
+        : Trigger(Utils::Side::ask, price), quantity(quantity) {}
+
+   protected:
+    void on_triggered() override {
+        get_book()->insert<Order>(Utils::Side::bid, get_price() + 1,
+                                  quantity);
+    }
+
+   private:
+    const double quantity;
+};
+
+void Cascade(const Shape& shape) {
+    const std::size_t ops = shape.levels - 1;
+    if (ops == 0) return;
+    Measure<BookState>(
+        "cascade", shape, ops,
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::ask, shape, false, 1.0);
+            for (std::size_t level = 0; level < ops; ++level) {
+                state.book->insert<StopBuy>(
+                    ask_touch + static_cast<Utils::Price>(level),
+                    static_cast<double>(shape.orders));
+            }
+        },
+        [&](BookState& state) {
+            state.book->insert<Order>(Utils::Side::bid, ask_touch,
+                                      static_cast<double>(shape.orders));
+        });
+}
+
+void Stops(const Shape& shape) {
+    const std::size_t ops = shape.levels * shape.orders;
+    Measure<BookState>(
+        "stops", shape, ops,
+        [&](BookState& state) {
+            Fill(*state.book, Utils::Side::ask, shape, false, 1.0);
+            const Utils::Price far = static_cast<Utils::Price>(shape.levels);
+            for (std::size_t level = 0; level < shape.levels; ++level) {
+                const Utils::Price offset = static_cast<Utils::Price>(level);
+                state.book->insert<Trigger>(Utils::Side::ask,
+                                            ask_touch + far + offset);
+                state.book->insert<Trigger>(Utils::Side::bid,
+                                            bid_touch - offset);
+            }
+        },
+        [&](BookState& state) {
+            const Utils::Price price =
+                ask_touch + static_cast<Utils::Price>(shape.levels);
+            for (std::size_t i = 0; i < ops; ++i) {
+                state.book->insert<Order>(Utils::Side::bid, price, 1.0);
+            }
+        });
+}
+
+// the orders of a snapshot of both sides, constructed in the book pool
+void Snapshot(BookState& state, const Shape& shape) {
+    uint64_t id = 1;
+    for (const Utils::Side side : {Utils::Side::bid, Utils::Side::ask}) {
+        for (std::size_t level = 0; level < shape.levels; ++level) {
+            const Utils::Price price =
+                side == Utils::Side::bid
+                    ? bid_touch - static_cast<Utils::Price>(level)
+                    : ask_touch + static_cast<Utils::Price>(level);
+            for (std::size_t i = 0; i < shape.orders; ++i) {
+                state.orders.push_back(std::allocate_shared<Order>(
+                    state.book->get_allocator<Order>(), side, price, 1.0,
+                    false, false, id++));
+            }
+        }
+    }
+}
+
+void Load(const Shape& shape) {
+    const std::size_t ops = 2 * shape.levels * shape.orders;
+    Measure<BookState>(
+        "load", shape, ops,
+        [&](BookState& state) { Snapshot(state, shape); },
+        [](BookState& state) {
+            for (const SharedOrderPtr& order : state.orders) {
+                state.book->insert(order);
+            }
+        });
+    Measure<BookState>(
+        "batch", shape, ops,
+        [&](BookState& state) { Snapshot(state, shape); },
+        [](BookState& state) {
+            state.book->insert_batch(state.orders.data(),
+                                     state.orders.size());
+        });
+}
+
+void Run(const Shape& shape) {
+    Passive(shape);
+    Cancel(shape);
+    Sweep(shape);
+    AllOrNothing(shape);
+    Cascade(shape);
+    Stops(shape);
+    Load(shape);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::printf("%-10s %7s %7s %9s %12s %12s\n", "workload", "levels",
+                "orders", "ops", "ns/op", "allocs/op");
+
+    if (argc > 1) {
+        Shape shape{std::strtoull(argv[1], nullptr, 10), 1, 10};
+        if (argc > 2) shape.orders = std::strtoull(argv[2], nullptr, 10);
+        if (argc > 3) shape.sweep = std::strtoull(argv[3], nullptr, 10);
+        if (shape.levels == 0 || shape.orders == 0 || shape.sweep == 0) {
+            std::fprintf(stderr, "levels, orders and sweep must be > 0\n");
+            return 1;
+        }
+        Run(shape);
+        return 0;
+    }
+
+    for (const std::size_t levels : {10, 100, 1000}) {
+        for (const std::size_t orders : {1, 10}) {
+            Run(Shape{levels, orders, 10});
+        }
+    }
+    return 0;
+}
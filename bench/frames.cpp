@@ -0,0 +1,104 @@
+/*
+ * Benchmark of the frame indexer against the framing loop of the handler
+ *
+ * Build from the repository root, e.g.
+ *   g++ -O3 -march=native -std=c++17 bench/frames.cpp -o bench_frames
+ *
+ * A synthetic stream of add, execute, cancel, delete and replace messages
+ * is framed by:
+ *  - Process, the framer of ITCHHandlerT with a handler consuming nothing
+ *  - FrameIndexer::Index alone, then followed by Validate
+ *  - FrameIndexer::Index followed by ProcessFrames
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../include/frames.hpp"
+#include "../include/handler.hpp"
+
+namespace {
+
+class NullHandler : public ITCHHandlerT<NullHandler> {};
+
+void PutBigEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// frames with the right length and type, zeroed fields
+std::vector<uint8_t> MakeStream(const std::size_t messages) {
+    static const char types[] = {'A', 'A', 'E', 'X', 'D', 'D', 'U', 'F'};
+    std::mt19937 random(42);
+    std::vector<uint8_t> stream;
+    stream.reserve(messages * 40);
+    for (std::size_t i = 0; i < messages; ++i) {
+        const char type = types[random() % sizeof(types)];
+        const uint32_t length =
+            MessageTypes::lengths.length[static_cast<uint8_t>(type)];
+        PutBigEndian(stream, length, 2);
+        stream.push_back(static_cast<uint8_t>(type));
+        stream.resize(stream.size() + length - 1);
+    }
+    return stream;
+}
+
+template <class Function>
+double Measure(const char* name, const std::size_t messages,
+               const std::size_t iterations, Function function) {
+    double best = 0;
+    for (std::size_t i = 0; i < iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto stop = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(
+                              stop - start).count() / messages;
+        if (i == 0 || ns < best) best = ns;
+    }
+    std::printf("%-28s %8.3f ns/msg\n", name, best);
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t messages =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const std::size_t iterations = 5;
+    const std::vector<uint8_t> stream = MakeStream(messages);
+
+    std::printf("%zu messages, %zu bytes\n", messages, stream.size());
+
+    NullHandler handler;
+    FrameIndexer indexer;
+    std::size_t invalid = 0;
+
+    Measure("Process", messages, iterations, [&] {
+        handler.ResetHandler();
+        handler.Process(stream.data(), stream.size());
+    });
+    Measure("Index", messages, iterations,
+            [&] { indexer.Index(stream.data(), stream.size()); });
+    Measure("Index + Validate", messages, iterations, [&] {
+        indexer.Index(stream.data(), stream.size());
+        invalid = indexer.Validate();
+    });
+    Measure("Index + ProcessFrames", messages, iterations, [&] {
+        handler.ResetHandler();
+        indexer.Index(stream.data(), stream.size());
+        handler.ProcessFrames(stream.data(), indexer.data(), indexer.size());
+    });
+
+    if (indexer.size() != messages || handler.messages() != messages ||
+        handler.errors() != 0 || invalid != 0) {
+        std::printf("frame count mismatch\n");
+        return 1;
+    }
+    return 0;
+}
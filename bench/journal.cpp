@@ -0,0 +1,157 @@
+/*
+ * Benchmark of the write-ahead order journal
+ *
+ * Build with `make bench_journal`, then run
+ *   ./bench_journal [commands] [journal path]
+ *
+ * A random mix of passive inserts, partial cancels, executions and
+ * cancels around a fixed mid price is applied to a book:
+ *  - without a journal
+ *  - with a journal, for a few group commit settings
+ * reporting the cost per command on the matching thread, the journal
+ * throughput, the number of commits and the commit latency, from the
+ * flush thread taking the first command of a group to the group being
+ * durable. Finally the journal is replayed into a new book, which must
+ * end up with the same orders.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../include/book.hpp"
+#include "../include/filesystem.hpp"
+#include "../include/journal.hpp"
+
+namespace {
+
+struct Action {
+    uint8_t type;
+    Utils::Side side;
+    Utils::Price price;
+    uint64_t id;
+};
+
+// orders rest on their side of a fixed mid price and never cross
+std::vector<Action> MakeActions(const std::size_t count) {
+    std::mt19937 random(11);
+    std::vector<Action> actions;
+    actions.reserve(count);
+    std::vector<uint64_t> live;
+    uint64_t id = 1;
+    for (std::size_t i = 0; i < count; ++i) {
+        const unsigned action = random() % 8;
+        if (live.size() < 64 || action < 4) {
+            const bool bid = random() % 2;
+            const Utils::Price distance = 1 + random() % 64;
+            actions.push_back(Action{0,
+                                     bid ? Utils::Side::bid : Utils::Side::ask,
+                                     bid ? 10000 - distance : 10000 + distance,
+                                     id});
+            live.push_back(id++);
+            continue;
+        }
+
+        const std::size_t k = random() % live.size();
+        const uint8_t type = action == 4 ? 1 : action == 5 ? 2 : 3;
+        actions.push_back(Action{type, Utils::Side::bid, 0, live[k]});
+        if (type == 3) {
+            live[k] = live.back();
+            live.pop_back();
+        }
+    }
+    return actions;
+}
+
+double Apply(Book& book, const std::vector<Action>& actions) {
+    const auto start = std::chrono::steady_clock::now();
+    for (const Action& action : actions) {
+        switch (action.type) {
+            case 0:
+                book.insert<Order>(action.side, action.price, 100.0, false,
+                                   false, action.id);
+                break;
+            case 1:
+                book.cancel(action.id, 10.0);
+                break;
+            case 2:
+                book.execute(action.id, 10.0);
+                break;
+            default:
+                book.remove(action.id);
+                break;
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+void Journaled(const std::vector<Action>& actions, const char* path,
+               const std::size_t group_bytes,
+               const std::chrono::microseconds interval) {
+    OrderJournal journal(1 << 16, group_bytes, interval);
+    if (!journal.Open(path, 1, true)) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        std::exit(1);
+    }
+
+    Book book;
+    book.set_journal(&journal);
+    const double seconds = Apply(book, actions);
+    journal.Close();
+
+    const OrderJournal::Metrics metrics = journal.get_metrics();
+    const LatencyHistogram& latency = metrics.commit_latency;
+    std::printf(
+        "group %6zu B %5lld us %8.1f ns/op %8.1f MB/s %7llu commits, "
+        "commit p50 %llu us, p99 %llu us, max %llu us\n",
+        group_bytes, static_cast<long long>(interval.count()),
+        seconds * 1e9 / actions.size(), metrics.bytes_per_second / 1e6,
+        static_cast<unsigned long long>(metrics.commits),
+        static_cast<unsigned long long>(latency.percentile(0.5) / 1000),
+        static_cast<unsigned long long>(latency.percentile(0.99) / 1000),
+        static_cast<unsigned long long>(latency.max() / 1000));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t count =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const char* path = argc > 2 ? argv[2] : "bench_journal.jrn";
+    const std::vector<Action> actions = MakeActions(count);
+
+    Book plain;
+    const double seconds = Apply(plain, actions);
+    std::printf("%-40s %8.1f ns/op\n", "no journal",
+                seconds * 1e9 / actions.size());
+
+    Journaled(actions, path, 4096, std::chrono::microseconds(100));
+    Journaled(actions, path, 1 << 16, std::chrono::microseconds(1000));
+    Journaled(actions, path, 1 << 20, std::chrono::microseconds(10000));
+
+    FileSystem::MappedFile file(path);
+    if (!file.Open()) {
+        std::fprintf(stderr, "cannot map %s\n", path);
+        return 1;
+    }
+    Book replayed;
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t replayed_count =
+        Journal::Replay(file.data(), file.size(), replayed);
+    const double replay = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+    std::printf("replay %zu commands, %zu bytes: %.1f ms, %zu orders%s\n",
+                replayed_count, file.size(), replay * 1e3,
+                replayed.get_order_count(),
+                replayed.get_order_count() == plain.get_order_count()
+                    ? ""
+                    : " (MISMATCH)");
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * Benchmark of the decoder / book pipeline against the inline replay
+ *
+ * Build from the repository root, e.g.
+ *   g++ -O3 -march=native -std=c++17 -pthread bench/pipeline.cpp \
+ *       include/manager.cpp include/book.cpp include/order.cpp \
+ *       -o bench_pipeline
+ *
+ * A synthetic stream of directory, add, execute, cancel and delete
+ * messages over a few hundred books is replayed:
+ *  - inline, through a single BookManager
+ *  - through BookPipeline, with both wait policies
+ * then the queue latency, from the decoder committing a record to the
+ * book thread picking it up, is sampled through a timestamped ring.
+ * Finally the books left by the replay are checkpointed and restored,
+ * restore time is compared with the inline replay time.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../include/manager.hpp"
+#include "../include/pipeline.hpp"
+#include "../include/ring.hpp"
+
+namespace {
+
+class Stream {
+   public:
+    std::vector<uint8_t> bytes;
+
+    void Directory(const uint16_t locate) {
+        Header(39, 'R', locate);
+        char symbol[9];
+        std::snprintf(symbol, sizeof(symbol), "S%-7u", locate);
+        bytes.insert(bytes.end(), symbol, symbol + 8);
+        bytes.resize(bytes.size() + 20, 0);
+    }
+
+    void Add(const uint16_t locate, const uint64_t reference, const char side,
+             const uint32_t shares, const uint32_t price) {
+        Header(36, 'A', locate);
+        Put(reference, 8);
+        bytes.push_back(static_cast<uint8_t>(side));
+        Put(shares, 4);
+        bytes.resize(bytes.size() + 8, ' ');
+        Put(price, 4);
+    }
+
+    void Execute(const uint16_t locate, const uint64_t reference,
+                 const uint32_t shares) {
+        Header(31, 'E', locate);
+        Put(reference, 8);
+        Put(shares, 4);
+        Put(0, 8);
+    }
+
+    void Cancel(const uint16_t locate, const uint64_t reference,
+                const uint32_t shares) {
+        Header(23, 'X', locate);
+        Put(reference, 8);
+        Put(shares, 4);
+    }
+
+    void Delete(const uint16_t locate, const uint64_t reference) {
+        Header(19, 'D', locate);
+        Put(reference, 8);
+    }
+
+   private:
+    void Put(const uint64_t value, const int size) {
+        for (int i = size - 1; i >= 0; --i) {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void Header(const uint16_t length, const char type,
+                const uint16_t locate) {
+        Put(length, 2);
+        bytes.push_back(static_cast<uint8_t>(type));
+        Put(locate, 2);
+        Put(0, 2);
+        Put(0, 6);
+    }
+};
+
+// resting orders stay on their side of a fixed mid price, so that no
+// add order crosses the book
+Stream MakeStream(const std::size_t messages, const uint16_t books) {
+    std::mt19937 random(7);
+    Stream stream;
+    for (uint16_t locate = 1; locate <= books; ++locate) {
+        stream.Directory(locate);
+    }
+
+    std::vector<std::vector<uint64_t>> live(books + 1);
+    uint64_t reference = 1;
+    for (std::size_t i = 0; i < messages; ++i) {
+        const uint16_t locate = 1 + random() % books;
+        std::vector<uint64_t>& orders = live[locate];
+        const unsigned action = random() % 8;
+        if (orders.size() < 16 || action < 4) {
+            const bool bid = random() % 2;
+            const uint32_t distance = 100 * (1 + random() % 64);
+            stream.Add(locate, reference, bid ? 'B' : 'S', 100,
+                       bid ? 1000000 - distance : 1000000 + distance);
+            orders.push_back(reference++);
+            continue;
+        }
+
+        const std::size_t k = random() % orders.size();
+        if (action == 4) {
+            stream.Execute(locate, orders[k], 10);
+        } else if (action == 5) {
+            stream.Cancel(locate, orders[k], 10);
+        } else {
+            stream.Delete(locate, orders[k]);
+            orders[k] = orders.back();
+            orders.pop_back();
+        }
+    }
+    return stream;
+}
+
+template <class Function>
+void Throughput(const char* name, const std::size_t messages,
+                Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const auto stop = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+    std::printf("%-24s %8.2f M msg/s\n", name, messages / seconds / 1e6);
+}
+
+struct TimedUpdate {
+    BookUpdate update;
+    int64_t committed;
+};
+
+inline int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <class Waiter>
+void Latency(const char* name, const std::vector<uint8_t>& bytes) {
+    SPSCRing<TimedUpdate, Waiter> ring(1 << 16);
+
+    struct Sink {
+        SPSCRing<TimedUpdate, Waiter>* ring;
+        TimedUpdate* current = nullptr;
+        std::size_t pending = 0;
+
+        BookUpdate& Next() {
+            current = &ring->Next();
+            return current->update;
+        }
+        void Commit() {
+            current->committed = Now();
+            if (++pending == 64) {
+                ring->Publish();
+                pending = 0;
+            }
+        }
+    };
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(bytes.size() / 24);
+    std::thread consumer([&] {
+        BookManager manager;
+        while (ring.Wait()) {
+            ring.Consume([&](const TimedUpdate& record) {
+                latencies.push_back(Now() - record.committed);
+                manager.Apply(record.update);
+            });
+        }
+    });
+
+    UpdateDecoder<Sink> decoder(Sink{&ring});
+    decoder.Process(bytes.data(), bytes.size());
+    ring.Close();
+    consumer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](const double p) {
+        return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+    };
+    std::printf(
+        "%-24s p50 %lld ns, p90 %lld ns, p99 %lld ns, p99.9 %lld ns, "
+        "max %lld ns\n",
+        name, static_cast<long long>(percentile(0.5)),
+        static_cast<long long>(percentile(0.9)),
+        static_cast<long long>(percentile(0.99)),
+        static_cast<long long>(percentile(0.999)),
+        static_cast<long long>(latencies.back()));
+}
+
+void Restore(const std::vector<uint8_t>& bytes) {
+    using Clock = std::chrono::steady_clock;
+
+    BookManager manager;
+    auto start = Clock::now();
+    manager.Process(bytes.data(), bytes.size());
+    const double replay = std::chrono::duration<double>(Clock::now() - start)
+                              .count();
+
+    std::vector<uint8_t> buffer;
+    start = Clock::now();
+    manager.checkpoint(buffer, Checkpoint::Position{bytes.size(), 0});
+    const double save = std::chrono::duration<double>(Clock::now() - start)
+                            .count();
+
+    BookManager restored;
+    start = Clock::now();
+    const std::size_t size = restored.restore(buffer.data(), buffer.size());
+    const double load = std::chrono::duration<double>(Clock::now() - start)
+                            .count();
+
+    std::printf(
+        "checkpoint %zu books, %zu orders, %zu bytes: replay %.1f ms, "
+        "save %.1f ms, restore %.1f ms%s\n",
+        restored.book_count(), restored.order_count(), buffer.size(),
+        replay * 1e3, save * 1e3, load * 1e3,
+        size == buffer.size() &&
+                restored.order_count() == manager.order_count()
+            ? ""
+            : " (MISMATCH)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t messages =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    const Stream stream = MakeStream(messages, 500);
+    const std::vector<uint8_t>& bytes = stream.bytes;
+
+    std::printf("%zu messages, %zu bytes, %u hardware threads\n", messages,
+                bytes.size(), std::thread::hardware_concurrency());
+
+    Throughput("inline", messages, [&] {
+        BookManager manager;
+        manager.Process(bytes.data(), bytes.size());
+    });
+    Throughput("pipeline (futex)", messages, [&] {
+        BookPipeline<Ring::FutexWait> pipeline;
+        pipeline.Process(bytes.data(), bytes.size());
+        pipeline.Flush();
+    });
+    Throughput("pipeline (spin)", messages, [&] {
+        BookPipeline<Ring::SpinWait> pipeline;
+        pipeline.Process(bytes.data(), bytes.size());
+        pipeline.Flush();
+    });
+
+    Latency<Ring::FutexWait>("queue latency (futex)", bytes);
+    Latency<Ring::SpinWait>("queue latency (spin)", bytes);
+
+    Restore(bytes);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Benchmark of the read-ahead file reader against the stdio loop and mmap
+ *
+ * Build with `make bench_reader`, then run
+ *   ./bench_reader [messages] [directory] [block KB] [depth]
+ *
+ * A synthetic stream from the Generator is written to a file in the
+ * directory, then read:
+ *  - with fread into an 8 KB buffer, the former stdin loop of main
+ *  - from a mapping of the file, faulted in as the handler walks it
+ *  - through AsyncReader, with its pread thread, io_uring, and io_uring
+ *    bypassing the page cache (O_DIRECT)
+ * once with a checksum of every cache line, the cost of the I/O alone,
+ * and once replayed through a BookManager.
+ * The file is dropped from the page cache before every run
+ * (POSIX_FADV_DONTNEED), so each one starts cold. Each run is repeated
+ * and the best time is kept.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../include/filesystem.hpp"
+#include "../include/generator.hpp"
+#include "../include/manager.hpp"
+
+namespace {
+
+// drop the clean pages of a file from the page cache
+void DropCache(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+// sums a byte of every cache line, so that every page is read, the sum
+// standing for the order count of a BookManager
+class Checksum {
+   public:
+    void Process(const void* buffer, const std::size_t size) {
+        const uint8_t* data = static_cast<const uint8_t*>(buffer);
+        for (std::size_t i = 0; i < size; i += 64) {
+            sum += data[i];
+        }
+    }
+    uint64_t order_count() const { return sum; }
+
+   private:
+    uint64_t sum = 0;
+};
+
+template <class Function>
+void Measure(const char* name, const std::string& path,
+             const std::size_t messages, const std::size_t bytes,
+             Function function) {
+    const std::size_t iterations = 3;
+    double best = 0;
+    uint64_t orders = 0;
+    for (std::size_t i = 0; i < iterations; ++i) {
+        DropCache(path);
+        const auto start = std::chrono::steady_clock::now();
+        orders = function();
+        const auto stop = std::chrono::steady_clock::now();
+        const double seconds =
+            std::chrono::duration<double>(stop - start).count();
+        if (i == 0 || seconds < best) best = seconds;
+    }
+    std::printf("%-24s %8.1f ns/msg %8.1f MB/s  (%llu)\n", name,
+                best * 1e9 / messages, bytes / best / 1e6,
+                static_cast<unsigned long long>(orders));
+}
+
+template <class Handler>
+uint64_t ReplayAsync(const std::string& path, const std::size_t block,
+                     const std::size_t depth, const bool direct,
+                     const bool uring) {
+    FileSystem::AsyncReader reader(FileSystem::Path(path), block, depth);
+    if (!reader.Open(direct, uring)) return 0;
+    Handler handler;
+    const void* data;
+    std::size_t size;
+    while (reader.Next(data, size)) {
+        handler.Process(data, size);
+    }
+    return handler.order_count();
+}
+
+template <class Handler>
+void Run(const char* title, const std::string& path,
+         const std::size_t messages, const std::size_t bytes,
+         const std::size_t block, const std::size_t depth) {
+    std::printf("%s\n", title);
+
+    Measure("fread 8 KB", path, messages, bytes, [&] {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        Handler handler;
+        uint8_t buffer[8192];
+        std::size_t size;
+        while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            handler.Process(buffer, size);
+        }
+        std::fclose(file);
+        return handler.order_count();
+    });
+
+    Measure("mmap", path, messages, bytes, [&] {
+        FileSystem::MappedFile file{FileSystem::Path(path)};
+        file.Open(false, true);
+        Handler handler;
+        handler.Process(file.data(), file.size());
+        return handler.order_count();
+    });
+
+    Measure("AsyncReader thread", path, messages, bytes, [&] {
+        return ReplayAsync<Handler>(path, block, depth, false, false);
+    });
+
+    Measure("AsyncReader io_uring", path, messages, bytes, [&] {
+        return ReplayAsync<Handler>(path, block, depth, false, true);
+    });
+
+    Measure("AsyncReader O_DIRECT", path, messages, bytes, [&] {
+        return ReplayAsync<Handler>(path, block, depth, true, true);
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t messages =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    const std::string directory = argc > 2 ? argv[2] : ".";
+    const std::size_t block =
+        (argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024) * 1024;
+    const std::size_t depth =
+        argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 4;
+    const std::string path = directory + "/bench_reader.itch";
+
+    std::size_t bytes = 0;
+    {
+        std::vector<uint8_t> stream;
+        GeneratorConfig config;
+        Generator generator(config);
+        generator.start(stream);
+        generator.generate(messages, stream);
+        generator.finish(stream);
+
+        FileSystem::FileWriter file{FileSystem::Path(path)};
+        if (!file.Open(true) || !file.Write(stream.data(), stream.size()) ||
+            !file.Sync()) {
+            std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+            return 1;
+        }
+        bytes = stream.size();
+    }
+    std::printf("%zu messages, %zu bytes, blocks of %zu KB, depth %zu\n",
+                messages, bytes, block / 1024, depth);
+
+    Run<Checksum>("read", path, messages, bytes, block, depth);
+    Run<BookManager>("replay", path, messages, bytes, block, depth);
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,343 @@
+#include "archive.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(LOB_WITH_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace FileSystem {
+
+namespace {
+
+// compressed bytes read at once
+const size_t input_size = 1 << 20;
+
+}  // namespace
+
+Compression DetectCompression(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+        return Compression::gzip;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 &&
+        bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return Compression::zstd;
+    }
+    return Compression::none;
+}
+
+bool ArchiveReader::Open() {
+    Close();
+
+    _fd = ::open(_path.c_str(), O_RDONLY);
+    if (_fd < 0) return false;
+    ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    _head.resize(4);
+    long head = 0;
+    while (head < 4) {
+        const ssize_t got = ::read(_fd, _head.data() + head, 4 - head);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        head += got;
+    }
+    _head.resize(head);
+    _compression = DetectCompression(_head.data(), _head.size());
+#if !defined(LOB_WITH_ZSTD)
+    if (_compression == Compression::zstd) {
+        Close();
+        return false;
+    }
+#endif
+
+    _blocks.clear();
+    _free.clear();
+    for (size_t i = 0; i < _block_count; ++i) {
+        _blocks.emplace_back(new char[_block_size]);
+        _free.push_back(i);
+    }
+    _sizes.assign(_block_count, 0);
+    _filled.clear();
+    _current = SIZE_MAX;
+    _done = _stop = _error = false;
+    _input = _head.size();
+    _output = 0;
+
+    _thread = std::thread([this] { Run(); });
+    return true;
+}
+
+void ArchiveReader::Close() {
+    if (_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _free_ready.notify_one();
+        _thread.join();
+    }
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+bool ArchiveReader::Next(const void*& data, size_t& size) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_current != SIZE_MAX) {
+        _free.push_back(_current);
+        _current = SIZE_MAX;
+        _free_ready.notify_one();
+    }
+
+    _filled_ready.wait(lock, [this] { return !_filled.empty() || _done; });
+    if (_filled.empty()) return false;
+
+    _current = _filled.front();
+    _filled.pop_front();
+    data = _blocks[_current].get();
+    size = _sizes[_current];
+    return true;
+}
+
+bool ArchiveReader::failed() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _error;
+}
+
+uint64_t ArchiveReader::compressed_size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _input;
+}
+
+uint64_t ArchiveReader::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _output;
+}
+
+void ArchiveReader::Run() {
+    bool ok = false;
+    switch (_compression) {
+        case Compression::none:
+            ok = Copy();
+            break;
+        case Compression::gzip:
+            ok = Inflate();
+            break;
+        case Compression::zstd:
+            ok = Decompress();
+            break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _error = !ok && !_stop;
+        _done = true;
+    }
+    _filled_ready.notify_one();
+}
+
+long ArchiveReader::ReadInput(void* buffer, size_t size) {
+    if (!_head.empty()) {
+        const size_t head = std::min(size, _head.size());
+        std::memcpy(buffer, _head.data(), head);
+        _head.erase(_head.begin(), _head.begin() + head);
+        return static_cast<long>(head);
+    }
+
+    for (;;) {
+        const ssize_t got = ::read(_fd, buffer, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got > 0) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _input += got;
+        }
+        return got;
+    }
+}
+
+char* ArchiveReader::Acquire(size_t& index) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _free_ready.wait(lock, [this] { return !_free.empty() || _stop; });
+    if (_stop) return nullptr;
+
+    index = _free.back();
+    _free.pop_back();
+    return _blocks[index].get();
+}
+
+void ArchiveReader::Publish(size_t index, size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _sizes[index] = size;
+        _filled.push_back(index);
+        _output += size;
+    }
+    _filled_ready.notify_one();
+}
+
+bool ArchiveReader::Copy() {
+    for (;;) {
+        size_t index;
+        char* block = Acquire(index);
+        if (block == nullptr) return false;
+
+        // fill the block, short reads are retried
+        size_t size = 0;
+        long got = 0;
+        while (size < _block_size &&
+               (got = ReadInput(block + size, _block_size - size)) > 0) {
+            size += got;
+        }
+        if (got < 0) return false;
+
+        if (size == 0) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _free.push_back(index);
+            return true;
+        }
+        Publish(index, size);
+        if (size < _block_size) return true;
+    }
+}
+
+bool ArchiveReader::Inflate() {
+    std::unique_ptr<uint8_t[]> input(new uint8_t[input_size]);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 32 enables the gzip header detection
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) return false;
+
+    bool ok = true;
+    bool member_end = false;
+    size_t index = 0;
+    char* block = nullptr;
+    for (;;) {
+        if (block == nullptr) {
+            block = Acquire(index);
+            if (block == nullptr) {
+                ok = false;
+                break;
+            }
+            stream.next_out = reinterpret_cast<Bytef*>(block);
+            stream.avail_out = static_cast<uInt>(_block_size);
+        }
+
+        if (stream.avail_in == 0) {
+            const long got = ReadInput(input.get(), input_size);
+            if (got < 0) {
+                ok = false;
+                break;
+            }
+            // the file must not end in the middle of a member
+            if (got == 0) {
+                ok = member_end;
+                break;
+            }
+            stream.next_in = input.get();
+            stream.avail_in = static_cast<uInt>(got);
+        }
+
+        // concatenated gzip members form a single stream
+        if (member_end) {
+            inflateReset(&stream);
+            member_end = false;
+        }
+
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            member_end = true;
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            ok = false;
+            break;
+        }
+
+        if (stream.avail_out == 0) {
+            Publish(index, _block_size);
+            block = nullptr;
+        }
+    }
+
+    if (block != nullptr) {
+        const size_t size = _block_size - stream.avail_out;
+        if (ok && size != 0) {
+            Publish(index, size);
+        } else {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _free.push_back(index);
+        }
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+bool ArchiveReader::Decompress() {
+#if defined(LOB_WITH_ZSTD)
+    std::unique_ptr<uint8_t[]> input(new uint8_t[input_size]);
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == nullptr) return false;
+    ZSTD_initDStream(stream);
+
+    bool ok = true;
+    // 0 once a frame is complete, frames may be concatenated
+    size_t hint = 1;
+    ZSTD_inBuffer in = {input.get(), 0, 0};
+    ZSTD_outBuffer out = {nullptr, 0, 0};
+    size_t index = 0;
+    for (;;) {
+        if (out.dst == nullptr) {
+            char* block = Acquire(index);
+            if (block == nullptr) {
+                ok = false;
+                break;
+            }
+            out = ZSTD_outBuffer{block, _block_size, 0};
+        }
+
+        if (in.pos == in.size) {
+            const long got = ReadInput(input.get(), input_size);
+            if (got < 0) {
+                ok = false;
+                break;
+            }
+            // the file must not end in the middle of a frame
+            if (got == 0) {
+                ok = hint == 0;
+                break;
+            }
+            in = ZSTD_inBuffer{input.get(), static_cast<size_t>(got), 0};
+        }
+
+        hint = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(hint)) {
+            ok = false;
+            break;
+        }
+
+        if (out.pos == out.size) {
+            Publish(index, out.pos);
+            out = ZSTD_outBuffer{nullptr, 0, 0};
+        }
+    }
+
+    if (out.dst != nullptr) {
+        if (ok && out.pos != 0) {
+            Publish(index, out.pos);
+        } else {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _free.push_back(index);
+        }
+    }
+    ZSTD_freeDStream(stream);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+}  // namespace FileSystem
@@ -0,0 +1,103 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "filesystem.hpp"
+
+namespace FileSystem {
+
+enum class Compression : uint8_t { none = 0, gzip = 1, zstd = 2 };
+
+// Detect the compression of a stream from its first bytes
+Compression DetectCompression(const void* data, size_t size);
+
+// ArchiveReader
+// It reads a compressed file, gzip or zstd as detected from its magic
+// bytes, or a plain one. A dedicated thread reads and decompresses the
+// file into a pool of large blocks while the consumer processes the
+// blocks already filled, so decompression overlaps parsing. The thread
+// waits for a free block once the pool is full.
+// zstd archives are only supported when built with LOB_WITH_ZSTD.
+// Not thread-safe: Open, Next and Close are called from one thread
+class ArchiveReader : public Path, public Reader {
+   public:
+    static const size_t DEFAULT_BLOCK = 4 << 20;
+    static const size_t DEFAULT_BLOCKS = 4;
+
+    ArchiveReader() = default;
+    ArchiveReader(const Path& path, size_t block_size = DEFAULT_BLOCK,
+                  size_t blocks = DEFAULT_BLOCKS)
+        : Path(path), _block_size(block_size), _block_count(blocks){};
+    ArchiveReader(const ArchiveReader&) = delete;
+    ~ArchiveReader() { Close(); }
+
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    // Open the file, detect its compression and start decompressing
+    // Returns false if the file cannot be opened or its compression is
+    // not supported
+    bool Open();
+    // Stop decompressing and close the file
+    void Close();
+
+    bool Next(const void*& data, size_t& size) override;
+    bool failed() const override;
+
+    bool IsOpen() const noexcept { return _thread.joinable(); }
+    Compression compression() const noexcept { return _compression; }
+    // bytes read from the file, decompressed bytes handed over
+    uint64_t compressed_size() const;
+    uint64_t size() const;
+
+   protected:
+    size_t _block_size = DEFAULT_BLOCK;
+    size_t _block_count = DEFAULT_BLOCKS;
+    Compression _compression = Compression::none;
+    int _fd = -1;
+
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    std::vector<size_t> _sizes;
+    // block handed to the consumer, returned to the pool on Next
+    size_t _current = SIZE_MAX;
+
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _filled_ready;
+    std::condition_variable _free_ready;
+    std::deque<size_t> _filled;
+    std::vector<size_t> _free;
+    bool _done = false;
+    bool _stop = false;
+    bool _error = false;
+    uint64_t _input = 0;
+    uint64_t _output = 0;
+
+    // first bytes of the file, read to detect the compression
+    std::vector<uint8_t> _head;
+
+    // decompression thread
+    void Run();
+    bool Copy();
+    bool Inflate();
+    bool Decompress();
+
+    // read up to size bytes of the file, the head first
+    // Returns the number of bytes read, -1 on error
+    long ReadInput(void* buffer, size_t size);
+    // get a free block, nullptr once stopped
+    char* Acquire(size_t& index);
+    // hand a filled block to the consumer
+    void Publish(size_t index, size_t size);
+};
+
+}  // namespace FileSystem
+
+#endif
@@ -1,10 +1,49 @@
 #include "book.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 #include <map>
+#include <stdexcept>
 
 #include "order.hpp"
 #include "utils.hpp"
 
+namespace {
+
+Utils::Price checked_tick_size(const Utils::Price tick_size) {
+    if (tick_size <= 0) {
+        throw std::invalid_argument("Book tick size must be positive");
+    }
+    return tick_size;
+}
+
+}  // namespace
+
+Book::Book(const Utils::Price tick_size, const std::size_t ladder_span)
+    : pool(std::make_shared<SlabPool>()),
+      bids(Utils::Side::bid, ladder_span),
+      asks(Utils::Side::ask, ladder_span),
+      bid_cumulative(Utils::Side::bid, ladder_span),
+      ask_cumulative(Utils::Side::ask, ladder_span),
+      tick_size(checked_tick_size(tick_size)) {}
+
+Utils::Price Book::get_tick_size() const { return tick_size; }
+
+Utils::Price Book::to_ticks(const double price) const {
+    return std::llround(price * Utils::price_scale / tick_size);
+}
+
+Utils::Price Book::itch_to_ticks(const uint32_t price) const {
+    return (static_cast<Utils::Price>(price) + tick_size / 2) / tick_size;
+}
+
+double Book::to_price(const Utils::Price ticks) const {
+    return static_cast<double>(ticks * tick_size) / Utils::price_scale;
+}
+
 void Book::begin_order_deferral() { ++order_deferral_depth; }
 
 void Book::end_order_deferral() {
@@ -13,46 +52,68 @@ void Book::end_order_deferral() {
     }
 
     while (!deferred.empty()) {
-        auto order_ptr = deferred.front();
-        deferred.pop();
-        insert(order_ptr);
+        insert(deferred.pop());
     }
 }
 
 void Book::execute_bid(ConstOrderPtr &order) {
     auto limit_iteration = asks.begin();
-    double order_price = order->price;
+    const Utils::Price order_price = order->price;
+    bool traded = false;
 
     while (limit_iteration != asks.end() &&
            limit_iteration->first <= order_price && order->quantity > 0.0) {
+        const Utils::Price price = limit_iteration->first;
         if (limit_iteration->second.trade(order) > 0.0) {
-            market_price = limit_iteration->first;
+            market_price = price;
+            traded = true;
         }
 
         if (limit_iteration->second.is_empty()) {
-            asks.erase(limit_iteration++);
+            limit_iteration = asks.erase(limit_iteration);
         } else {
             ++limit_iteration;
         }
+        update_depth(Utils::Side::ask, price);
     }
 
-    auto trigger_limit_iteration = ask_triggers.begin();
+    // the market price only moves when the order trades
+    if (traded) {
+        trigger_asks();
+    }
+}
 
-    while (trigger_limit_iteration != ask_triggers.end() &&
-           trigger_limit_iteration->first <= market_price) {
-        trigger_limit_iteration->second.trigger_all();
-        ++trigger_limit_iteration;
+void Book::trigger_asks() {
+    if (market_price < next_ask_trigger) {
+        return;
     }
 
-    ask_triggers.erase(ask_triggers.begin(), trigger_limit_iteration);
+    while (!ask_triggers.empty() &&
+           ask_triggers.begin()->first <= market_price) {
+        TriggerLimit fired;
+        fired.triggers.swap(ask_triggers.begin()->second.triggers);
+        ask_triggers.erase(ask_triggers.begin());
+        update_trigger_thresholds();
+        fired.trigger_all();
+    }
 }
 
 bool Book::ask_is_fillable(ConstOrderPtr &order) const {
+    const Utils::Price order_price = order->price;
+    const CumulativeDepth::Level reachable =
+        bid_cumulative.cumulative(order_price);
+    if (reachable.quantity >= order->quantity) {
+        return true;
+    }
+    if (reachable.total < order->quantity) {
+        return false;
+    }
+
+    // all-or-nothing bids decide whether the order fills
     auto limit_iterator = bids.begin();
     double quantity_remaining = order->quantity;
-    const double order_price = order->price;
 
-    while (limit_iterator != asks.end() &&
+    while (limit_iterator != bids.end() &&
            limit_iterator->first >= order_price && quantity_remaining > 0.0) {
         const double limit_quantity = limit_iterator->second.quantity;
         const double all_or_nothing_quantity =
@@ -66,7 +127,7 @@ bool Book::ask_is_fillable(ConstOrderPtr &order) const {
             return true;
         } else {
             // expensive computation
-            quantity_remaining -=
+            quantity_remaining =
                 limit_iterator->second.simulate_trade(quantity_remaining);
         }
 
@@ -76,50 +137,80 @@ bool Book::ask_is_fillable(ConstOrderPtr &order) const {
     return quantity_remaining <= 0.0;
 }
 
-void Book::execute_queued_ask(ConstOrderPtr &order) {
-    const double quantity = order->quantity;
+void Book::execute_queued_ask(OrderLimit &limit, ConstOrderPtr &order) {
+    limit.erase(order.get());
+    unindex_order(order.get());
+    order->queued = false;
+    order->queue_reference.reset();
     execute_ask(order);
-    order->limit_iterator->second.quantity -= quantity;
+    order->book = nullptr;
 }
 
-void Book::check_asks_all_or_nothing(const double price) {
-    auto limit_iter = asks.lower_bound(price);
-    while (limit_iter != asks.end()) {
-        auto &limit = limit_iter->second;
-        auto order_iter = limit.all_or_nothing_iterators.begin();
+void Book::check_asks_all_or_nothing(const Utils::Price price) {
+    // only asks at the price or lower trade with the bids it adds to
+    const CumulativeDepth::Rank last = ask_cumulative.to_rank(price);
+    CumulativeDepth::Rank rank =
+        std::numeric_limits<CumulativeDepth::Rank>::min();
+    double smallest = 0.0;
+
+    while (ask_cumulative.next_all_or_nothing(rank, rank, smallest) &&
+           rank <= last) {
+        const Utils::Price limit_price = ask_cumulative.to_price(rank++);
+        if (smallest > bid_cumulative.volume(limit_price)) {
+            continue;
+        }
 
-        while (order_iter != limit.all_or_nothing_iterators.end()) {
-            auto order = **order_iter;
+        OrderLimit &limit = *asks.get(limit_price);
+        Order *order_object = limit.all_or_nothing_head;
+        bool executed = false;
+
+        while (order_object != nullptr) {
+            Order *next = order_object->all_or_nothing_next;
+            const SharedOrderPtr order = order_object->queue_reference;
             if (ask_is_fillable(order)) {
-                execute_queued_ask(order);
-            } else {
-                ++order_iter;
+                execute_queued_ask(limit, order);
+                executed = true;
             }
+            order_object = next;
         }
 
-        if (limit_iter->second.is_empty()) {
-            asks.erase(limit_iter++);
-        } else {
-            ++limit_iter;
+        if (limit.is_empty()) {
+            asks.erase(limit_price);
+        }
+        if (executed) {
+            update_depth(Utils::Side::ask, limit_price);
         }
     }
 }
 
 void Book::queue_bid_order(ConstOrderPtr &order) {
-    const auto limit_iterator = bids.emplace(order->price, OrderLimit()).first;
-    const auto order_iterator = limit_iterator->second.insert(order);
-
-    order->limit_iterator = limit_iterator;
-    order->order_iterator = order_iterator;
+    bids.emplace(order->price).insert(order.get());
+    order->queue_reference = order;
     order->queued = true;
-    check_asks_all_or_nothing(order->price);
+    if (order->id != 0) {
+        order_index.insert(order->id, order.get());
+    }
+    update_depth(Utils::Side::bid, order->price);
+    // queued before the all-or-nothing asks it releases fill it
+    report(ExecutionReport::queued, *order, order->quantity);
     order->on_queue();
+    check_asks_all_or_nothing(order->price);
 }
 
 bool Book::bid_is_fillable(ConstOrderPtr &order) const {
+    const Utils::Price order_price = order->price;
+    const CumulativeDepth::Level reachable =
+        ask_cumulative.cumulative(order_price);
+    if (reachable.quantity >= order->quantity) {
+        return true;
+    }
+    if (reachable.total < order->quantity) {
+        return false;
+    }
+
+    // all-or-nothing asks decide whether the order fills
     auto limit_iterator = asks.begin();
     double quantity_remaining = order->quantity;
-    const double order_price = order->price;
 
     while (limit_iterator != asks.end() &&
            limit_iterator->first <= order_price && quantity_remaining > 0.0) {
@@ -153,6 +244,7 @@ void Book::insert_all_or_nothing_bid(ConstOrderPtr &order) {
     }
 
     if (order->immediate_or_cancel) {
+        report(ExecutionReport::canceled, *order, order->quantity);
         order->on_canceled();
         order->book = nullptr;
         return;
@@ -167,6 +259,7 @@ void Book::insert_bid(ConstOrderPtr &order) {
 
     if (order->immediate_or_cancel) {
         if (order->quantity > 0.0) {
+            report(ExecutionReport::canceled, *order, order->quantity);
             order->on_canceled();
         }
         order->book = nullptr;
@@ -182,72 +275,110 @@ void Book::insert_bid(ConstOrderPtr &order) {
 
 void Book::execute_ask(ConstOrderPtr &order) {
     auto limit_iterator = bids.begin();
-    double order_price = order->price;
+    const Utils::Price order_price = order->price;
+    bool traded = false;
 
     while (limit_iterator != bids.end() &&
            limit_iterator->first >= order_price && order->quantity > 0.0) {
+        const Utils::Price price = limit_iterator->first;
         if (limit_iterator->second.trade(order) > 0.0) {
-            market_price = limit_iterator->first;
+            market_price = price;
+            traded = true;
         }
 
         if (limit_iterator->second.is_empty()) {
-            bids.erase(limit_iterator++);
+            limit_iterator = bids.erase(limit_iterator);
         } else {
             ++limit_iterator;
         }
+        update_depth(Utils::Side::bid, price);
+    }
+
+    if (traded) {
+        trigger_bids();
     }
+}
 
-    auto trigger_limit_iterator = bid_triggers.begin();
+void Book::trigger_bids() {
+    if (market_price > next_bid_trigger) {
+        return;
+    }
 
-    while (trigger_limit_iterator != bid_triggers.end() &&
-           trigger_limit_iterator->first >= market_price) {
-        trigger_limit_iterator->second.trigger_all();
-        ++trigger_limit_iterator;
+    while (!bid_triggers.empty() &&
+           bid_triggers.begin()->first >= market_price) {
+        TriggerLimit fired;
+        fired.triggers.swap(bid_triggers.begin()->second.triggers);
+        bid_triggers.erase(bid_triggers.begin());
+        update_trigger_thresholds();
+        fired.trigger_all();
     }
+}
 
-    bid_triggers.erase(bid_triggers.begin(), trigger_limit_iterator);
+void Book::update_trigger_thresholds() {
+    next_bid_trigger = bid_triggers.empty() ? Utils::negative_price
+                                            : bid_triggers.begin()->first;
+    next_ask_trigger = ask_triggers.empty() ? Utils::max_price
+                                            : ask_triggers.begin()->first;
 }
 
-void Book::execute_queued_bid(ConstOrderPtr &order) {
-    const double quantity = order->quantity;
+void Book::execute_queued_bid(OrderLimit &limit, ConstOrderPtr &order) {
+    limit.erase(order.get());
+    unindex_order(order.get());
+    order->queued = false;
+    order->queue_reference.reset();
     execute_bid(order);
-    order->limit_iterator->second.all_or_nothing_quantity -= quantity;
+    order->book = nullptr;
 }
 
-void Book::check_bids_all_or_nothing(const double price) {
-    auto limit_iterator = bids.lower_bound(price);
+void Book::check_bids_all_or_nothing(const Utils::Price price) {
+    // only bids at the price or higher trade with the asks it adds to
+    const CumulativeDepth::Rank last = bid_cumulative.to_rank(price);
+    CumulativeDepth::Rank rank =
+        std::numeric_limits<CumulativeDepth::Rank>::min();
+    double smallest = 0.0;
+
+    while (bid_cumulative.next_all_or_nothing(rank, rank, smallest) &&
+           rank <= last) {
+        const Utils::Price limit_price = bid_cumulative.to_price(rank++);
+        if (smallest > ask_cumulative.volume(limit_price)) {
+            continue;
+        }
 
-    while (limit_iterator != bids.end()) {
-        auto &limit_object = limit_iterator->second;
-        auto order_iterator = limit_object.all_or_nothing_iterators.begin();
+        OrderLimit &limit_object = *bids.get(limit_price);
+        Order *order = limit_object.all_or_nothing_head;
+        bool executed = false;
 
-        while (order_iterator != limit_object.all_or_nothing_iterators.end()) {
-            auto order_object = **order_iterator;
+        while (order != nullptr) {
+            Order *next = order->all_or_nothing_next;
+            const SharedOrderPtr order_object = order->queue_reference;
             if (bid_is_fillable(order_object)) {
-                execute_queued_bid(order_object);
-                limit_object.erase(*(order_iterator++));
-            } else {
-                ++order_iterator;
+                execute_queued_bid(limit_object, order_object);
+                executed = true;
             }
+            order = next;
         }
 
-        if (limit_iterator->second.is_empty()) {
-            bids.erase(limit_iterator++);
-        } else {
-            ++limit_iterator;
+        if (limit_object.is_empty()) {
+            bids.erase(limit_price);
+        }
+        if (executed) {
+            update_depth(Utils::Side::bid, limit_price);
         }
     }
 }
 
 void Book::queue_ask_order(ConstOrderPtr &order) {
-    const auto limit_iterator = asks.emplace(order->price, OrderLimit()).first;
-    const auto order_iterator = limit_iterator->second.insert(order);
-
-    order->limit_iterator = limit_iterator;
-    order->order_iterator = order_iterator;
+    asks.emplace(order->price).insert(order.get());
+    order->queue_reference = order;
     order->queued = true;
-    check_bids_all_or_nothing(order->price);
+    if (order->id != 0) {
+        order_index.insert(order->id, order.get());
+    }
+    update_depth(Utils::Side::ask, order->price);
+    // queued before the all-or-nothing bids it releases fill it
+    report(ExecutionReport::queued, *order, order->quantity);
     order->on_queue();
+    check_bids_all_or_nothing(order->price);
 }
 
 void Book::insert_all_or_nothing_ask(ConstOrderPtr &order) {
@@ -258,6 +389,7 @@ void Book::insert_all_or_nothing_ask(ConstOrderPtr &order) {
     }
 
     if (order->immediate_or_cancel) {
+        report(ExecutionReport::canceled, *order, order->quantity);
         order->on_canceled();
         order->book = nullptr;
         return;
@@ -272,6 +404,7 @@ void Book::insert_ask(ConstOrderPtr &order) {
 
     if (order->immediate_or_cancel) {
         if (order->quantity > 0.0) {
+            report(ExecutionReport::canceled, *order, order->quantity);
             order->on_canceled();
         }
 
@@ -287,24 +420,42 @@ void Book::insert_ask(ConstOrderPtr &order) {
 }
 
 void Book::insert(ConstOrderPtr order) {
-    // check if order is valid
     if (order_deferral_depth > 0) {
         deferred.push(order);
         return;
     }
-    // begin_order_deferral();
 
+    accept_order(order);
+}
+
+void Book::accept_order(ConstOrderPtr &order) {
+    // check if order is valid
     if (order->quantity <= 0.0) {
+        report(ExecutionReport::rejected, *order, order->quantity);
         order->on_rejected();
         return;
     }
 
     if (order->queued) {
+        report(ExecutionReport::rejected, *order, order->quantity);
+        order->on_rejected();
+        return;
+    }
+
+    // reference numbers identify a single resting order
+    if (order->id != 0 && order_index.find(order->id) != nullptr) {
+        report(ExecutionReport::rejected, *order, order->quantity);
         order->on_rejected();
         return;
     }
     // order is valid
+    journal_command(Journal::Command::insert, *order, order->quantity);
+    if (order->all_or_nothing) {
+        enable_cumulative();
+    }
+    begin_order_deferral();
     order->book = this;
+    report(ExecutionReport::accepted, *order, order->quantity);
     order->on_accepted();
 
     if (order->side == Utils::Side::bid) {
@@ -324,50 +475,647 @@ void Book::insert(ConstOrderPtr order) {
     end_order_deferral();
 }
 
-double Book::get_bid_price() const {
-    const auto iter = bids.begin();
-    return iter != bids.end() ? iter->first : Utils::min_price;
+void Book::insert(ConstTriggerPtr trigger) {
+    if (trigger->queued) {
+        trigger->on_rejected();
+        return;
+    }
+
+    begin_order_deferral();
+    trigger->book = this;
+    trigger->on_accepted();
+
+    if (trigger->side == Utils::Side::bid) {
+        queue_bid_trigger(trigger);
+    } else {
+        queue_ask_trigger(trigger);
+    }
+
+    end_order_deferral();
 }
 
-double Book::get_ask_price() const {
-    const auto iter = asks.begin();
-    return iter != asks.end() ? iter->first : Utils::max_price;
+void Book::insert(const Insertable &insertable) {
+    if (insertable.is_order()) {
+        insert(*insertable.get_order());
+    } else {
+        insert(*insertable.get_trigger());
+    }
 }
 
-double Book::get_market_price() const { return market_price; }
+void Book::insert_batch(const SharedOrderPtr *orders,
+                        const std::size_t count) {
+    order_index.reserve(order_index.size() + count);
 
-std::map<double, OrderLimit>::iterator Book::bid_limits_begin() {
-    return bids.begin();
+    // the deferral is held over the batch, orders deferred by the
+    // handlers are inserted as soon as the order deferring them is done
+    begin_order_deferral();
+    for (std::size_t i = 0; i < count; ++i) {
+        accept_order(orders[i]);
+        drain_deferred();
+    }
+    end_order_deferral();
 }
 
-std::map<double, OrderLimit>::iterator Book::bid_limits_end() {
-    return bids.end();
+void Book::insert_batch(const Insertable *insertables,
+                        const std::size_t count) {
+    order_index.reserve(order_index.size() + count);
+
+    begin_order_deferral();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (insertables[i].is_order()) {
+            accept_order(*insertables[i].get_order());
+        } else {
+            insert(*insertables[i].get_trigger());
+        }
+        drain_deferred();
+    }
+    end_order_deferral();
 }
 
-std::map<double, OrderLimit>::iterator Book::ask_limits_begin() {
-    return asks.begin();
+SharedOrderPtr Book::append_order(const Utils::Side side,
+                                  const Utils::Price price,
+                                  const double quantity, const uint64_t id,
+                                  const bool all_or_nothing) {
+    const SharedOrderPtr order = std::allocate_shared<Order>(
+        PoolAllocator<Order>(pool), side, price, quantity, false,
+        all_or_nothing, id);
+
+    if (quantity <= 0.0 || (id != 0 && order_index.find(id) != nullptr)) {
+        report(ExecutionReport::rejected, *order, quantity);
+        order->on_rejected();
+        return nullptr;
+    }
+
+    journal_command(Journal::Command::append, *order, quantity);
+    if (all_or_nothing) {
+        enable_cumulative();
+    }
+    order->book = this;
+    report(ExecutionReport::accepted, *order, quantity);
+    order->on_accepted();
+
+    // queued as queue_bid_order / queue_ask_order do, without checking
+    // the all-or-nothing orders of the other side
+    (side == Utils::Side::bid ? bids : asks)
+        .emplace(price)
+        .insert(order.get());
+    order->queue_reference = order;
+    order->queued = true;
+    if (id != 0) {
+        order_index.insert(id, order.get());
+    }
+    update_depth(side, price);
+    report(ExecutionReport::queued, *order, quantity);
+    order->on_queue();
+    return order;
 }
 
-std::map<double, OrderLimit>::iterator Book::ask_limits_end() {
-    return asks.end();
+void Book::drain_deferred() {
+    while (!deferred.empty()) {
+        accept_order(deferred.pop());
+    }
+}
+
+void Book::queue_bid_trigger(ConstTriggerPtr trigger) {
+    // bid triggers respond to falling prices
+    if (market_price != Utils::negative_price &&
+        trigger->price >= market_price) {
+        report_trigger(*trigger);
+        trigger->on_triggered();
+        trigger->book = nullptr;
+        return;
+    }
+
+    trigger->queue_position = bid_triggers[trigger->price].insert(trigger);
+    trigger->queued = true;
+    update_trigger_thresholds();
+    trigger->on_queued();
+}
+
+void Book::queue_ask_trigger(ConstTriggerPtr trigger) {
+    // ask triggers respond to rising prices
+    if (market_price != Utils::negative_price &&
+        trigger->price <= market_price) {
+        report_trigger(*trigger);
+        trigger->on_triggered();
+        trigger->book = nullptr;
+        return;
+    }
+
+    trigger->queue_position = ask_triggers[trigger->price].insert(trigger);
+    trigger->queued = true;
+    update_trigger_thresholds();
+    trigger->on_queued();
+}
+
+void Book::erase_trigger(Trigger *trigger) {
+    if (trigger->side == Utils::Side::bid) {
+        const auto limit = bid_triggers.find(trigger->price);
+        limit->second.erase(trigger);
+        if (limit->second.is_empty()) {
+            bid_triggers.erase(limit);
+        }
+    } else {
+        const auto limit = ask_triggers.find(trigger->price);
+        limit->second.erase(trigger);
+        if (limit->second.is_empty()) {
+            ask_triggers.erase(limit);
+        }
+    }
+    update_trigger_thresholds();
+}
+
+OrderLimit *Book::limit_of(const Order *order) {
+    return order->side == Utils::Side::bid ? bids.get(order->price)
+                                           : asks.get(order->price);
+}
+
+void Book::erase_order(Order *order) {
+    auto &limits = order->side == Utils::Side::bid ? bids : asks;
+    const auto limit_iterator = limits.find(order->price);
+
+    limit_iterator->second.erase(order);
+    if (limit_iterator->second.is_empty()) {
+        limits.erase(limit_iterator);
+    }
+    update_depth(order->side, order->price);
+    unindex_order(order);
+
+    order->queued = false;
+    order->book = nullptr;
+    order->queue_reference.reset();
+}
+
+void Book::unindex_order(const Order *order) {
+    if (order->id != 0) {
+        order_index.erase(order->id);
+    }
+}
+
+CumulativeDepth::Level Book::cumulative_level(const OrderLimit &limit) {
+    return CumulativeDepth::Level{
+        limit.quantity, limit.quantity + limit.all_or_nothing_quantity};
+}
+
+void Book::enable_cumulative() const {
+    if (cumulative_enabled) {
+        return;
+    }
+
+    cumulative_enabled = true;
+    for (auto iter = bids.begin(); iter != bids.end(); ++iter) {
+        bid_cumulative.set(iter->first, cumulative_level(iter->second));
+    }
+    for (auto iter = asks.begin(); iter != asks.end(); ++iter) {
+        ask_cumulative.set(iter->first, cumulative_level(iter->second));
+    }
 }
 
-std::map<double, OrderLimit>::iterator Book::bid_limit_at_price(
-    const double price) {
+void Book::index_all_or_nothing(const Order *order) {
+    auto &cumulative =
+        order->side == Utils::Side::bid ? bid_cumulative : ask_cumulative;
+    cumulative.insert_all_or_nothing(order->price, order->quantity);
+}
+
+void Book::unindex_all_or_nothing(const Order *order) {
+    auto &cumulative =
+        order->side == Utils::Side::bid ? bid_cumulative : ask_cumulative;
+    cumulative.erase_all_or_nothing(order->price, order->quantity);
+}
+
+void Book::record_depth(const DepthDelta::Action action,
+                        const Utils::Side side, const std::size_t index,
+                        const DepthLevel &level) {
+    if (record_depth_deltas) {
+        depth_deltas.push_back(
+            DepthDelta{action, side, static_cast<uint8_t>(index), level});
+    }
+}
+
+void Book::update_depth(const Utils::Side side, const Utils::Price price) {
+    Depth &depth = side == Utils::Side::bid ? bid_depth : ask_depth;
+    auto &cumulative =
+        side == Utils::Side::bid ? bid_cumulative : ask_cumulative;
+    auto &limits = side == Utils::Side::bid ? bids : asks;
+
+    const OrderLimit *limit = limits.get(price);
+    if (cumulative_enabled) {
+        cumulative.set(price, limit != nullptr ? cumulative_level(*limit)
+                                               : CumulativeDepth::Level());
+    }
+
+    // levels beyond a full view leave it untouched
+    const std::size_t index = depth.find(price);
+    if (index == Depth::max_levels) {
+        return;
+    }
+
+    if (limit == nullptr || limit->is_empty()) {
+        if (!depth.at(index, price)) {
+            return;
+        }
+
+        const DepthLevel removed = depth[index];
+        const bool refill = depth.full();
+        depth.erase(index);
+        record_depth(DepthDelta::remove, side, index, removed);
+
+        // the next level below the view moves in at the bottom
+        if (refill) {
+            auto next = limits.begin();
+            if (!depth.empty()) {
+                next = limits.lower_bound(depth[depth.size() - 1].price);
+                ++next;
+            }
+            if (next != limits.end()) {
+                const OrderLimit &below = next->second;
+                const DepthLevel level{
+                    next->first,
+                    below.quantity + below.all_or_nothing_quantity,
+                    below.count};
+                depth.insert(depth.size(), level);
+                record_depth(DepthDelta::add, side, depth.size() - 1, level);
+            }
+        }
+        return;
+    }
+
+    const DepthLevel level{price,
+                           limit->quantity + limit->all_or_nothing_quantity,
+                           limit->count};
+    if (!depth.at(index, price)) {
+        depth.insert(index, level);
+        record_depth(DepthDelta::add, side, index, level);
+    } else if (depth[index] != level) {
+        depth.set(index, level);
+        record_depth(DepthDelta::update, side, index, level);
+    }
+}
+
+std::size_t Book::checkpoint(std::vector<uint8_t> &buffer,
+                             const Checkpoint::Position &position) const {
+    const std::size_t start = buffer.size();
+    std::size_t triggers = 0;
+    for (const auto &level : bid_triggers) {
+        triggers += level.second.trigger_count();
+    }
+    for (const auto &level : ask_triggers) {
+        triggers += level.second.trigger_count();
+    }
+
+    Checkpoint::BookHeader header{};
+    std::memcpy(header.magic, Checkpoint::book_magic, sizeof(header.magic));
+    header.version = Checkpoint::version;
+    header.tick_size = tick_size;
+    header.market_price = market_price;
+    header.position = position;
+    header.triggers = triggers;
+    buffer.reserve(start + sizeof(header) +
+                   order_index.size() * sizeof(Checkpoint::OrderRecord) +
+                   triggers * sizeof(Checkpoint::TriggerRecord));
+    Checkpoint::Append(buffer, header);
+
+    uint64_t orders = 0;
+    for (const auto *limits : {&bids, &asks}) {
+        for (auto iter = limits->begin(); iter != limits->end(); ++iter) {
+            for (const Order *order = iter->second.head; order != nullptr;
+                 order = order->next) {
+                Checkpoint::OrderRecord record{};
+                record.id = order->id;
+                record.price = order->price;
+                record.quantity = order->quantity;
+                record.side = static_cast<uint8_t>(order->side);
+                record.all_or_nothing = order->all_or_nothing;
+                Checkpoint::Append(buffer, record);
+                ++orders;
+            }
+        }
+    }
+    // the order count is only known once the levels are walked
+    std::memcpy(
+        buffer.data() + start + offsetof(Checkpoint::BookHeader, orders),
+        &orders, sizeof(orders));
+
+    const auto append_triggers = [&buffer](const auto &levels) {
+        for (const auto &level : levels) {
+            for (const SharedTriggerPtr &trigger : level.second.triggers) {
+                Checkpoint::TriggerRecord record{};
+                record.price = trigger->price;
+                record.side = static_cast<uint8_t>(trigger->side);
+                Checkpoint::Append(buffer, record);
+            }
+        }
+    };
+    append_triggers(bid_triggers);
+    append_triggers(ask_triggers);
+
+    return buffer.size() - start;
+}
+
+std::size_t Book::restore(
+    const void *data, const std::size_t size, Checkpoint::Position *position,
+    const std::function<SharedTriggerPtr(Utils::Side, Utils::Price)>
+        &make_trigger) {
+    std::size_t offset = 0;
+    Checkpoint::BookHeader header;
+    if (!Checkpoint::Read(data, size, offset, header) ||
+        std::memcmp(header.magic, Checkpoint::book_magic,
+                    sizeof(header.magic)) != 0 ||
+        header.version != Checkpoint::version ||
+        header.tick_size != tick_size) {
+        return 0;
+    }
+
+    // the counts are checked against the size before the book is reset
+    const std::size_t available = size - offset;
+    const std::size_t order_bytes =
+        header.orders * sizeof(Checkpoint::OrderRecord);
+    if (header.orders > available / sizeof(Checkpoint::OrderRecord) ||
+        header.triggers > (available - order_bytes) /
+                              sizeof(Checkpoint::TriggerRecord)) {
+        return 0;
+    }
+
+    reset_session();
+    market_price = header.market_price;
+    order_index.reserve(header.orders);
+    if (position != nullptr) {
+        *position = header.position;
+    }
+
+    // orders are appended to their levels in time priority, the depth of
+    // a level is brought up to date once its last order is in
+    bool all_or_nothing = false;
+    Utils::Side side = Utils::Side::bid;
+    Utils::Price price = 0;
+    OrderLimit *limit = nullptr;
+    for (uint64_t i = 0; i < header.orders; ++i) {
+        Checkpoint::OrderRecord record;
+        Checkpoint::Read(data, size, offset, record);
+
+        const Utils::Side record_side = static_cast<Utils::Side>(record.side);
+        if (limit == nullptr || record_side != side || record.price != price) {
+            if (limit != nullptr) {
+                update_depth(side, price);
+            }
+            side = record_side;
+            price = record.price;
+            limit = &(side == Utils::Side::bid ? bids : asks).emplace(price);
+        }
+
+        const SharedOrderPtr order = std::allocate_shared<Order>(
+            PoolAllocator<Order>(pool), side, price, record.quantity, false,
+            record.all_or_nothing != 0, record.id);
+        order->book = this;
+        order->queued = true;
+        order->queue_reference = order;
+        limit->insert(order.get());
+        if (order->id != 0) {
+            order_index.insert(order->id, order.get());
+        }
+        all_or_nothing |= order->all_or_nothing;
+    }
+    if (limit != nullptr) {
+        update_depth(side, price);
+    }
+    if (all_or_nothing) {
+        enable_cumulative();
+    }
+
+    for (uint64_t i = 0; i < header.triggers; ++i) {
+        Checkpoint::TriggerRecord record;
+        Checkpoint::Read(data, size, offset, record);
+
+        const Utils::Side trigger_side = static_cast<Utils::Side>(record.side);
+        const SharedTriggerPtr trigger =
+            make_trigger ? make_trigger(trigger_side, record.price)
+                         : std::allocate_shared<Trigger>(
+                               PoolAllocator<Trigger>(pool), trigger_side,
+                               record.price);
+        auto &levels = trigger_side == Utils::Side::bid
+                           ? bid_triggers[record.price]
+                           : ask_triggers[record.price];
+        trigger->queue_position = levels.insert(trigger);
+        trigger->queued = true;
+        trigger->book = this;
+    }
+    update_trigger_thresholds();
+
+    return offset;
+}
+
+void Book::reserve_orders(const std::size_t expected) {
+    order_index.reserve(expected);
+}
+
+SharedOrderPtr Book::find_order(const uint64_t id) const {
+    const Order *order = order_index.find(id);
+    return order != nullptr ? order->queue_reference : nullptr;
+}
+
+bool Book::execute(const uint64_t id, const double quantity) {
+    Order *order = order_index.find(id);
+    if (order == nullptr) {
+        return false;
+    }
+    execute_resting(order, quantity, order->price, true);
+    return true;
+}
+
+bool Book::execute(const uint64_t id, const double quantity,
+                   const Utils::Price price, const bool printable) {
+    Order *order = order_index.find(id);
+    if (order == nullptr) {
+        return false;
+    }
+    execute_resting(order, quantity, price, printable);
+    return true;
+}
+
+void Book::execute_resting(Order *order, const double quantity,
+                           const Utils::Price price, const bool printable) {
+    const SharedOrderPtr order_ptr = order->queue_reference;
+    if (journal != nullptr) {
+        journal->append(Journal::Command::execute, order->side,
+                        printable ? 0 : Journal::Command::non_printable,
+                        order->id, price, quantity);
+    }
+    begin_order_deferral();
+    if (printable) {
+        market_price = price;
+    }
+    if (record_reports) {
+        reports.push_back(ExecutionReport{
+            ExecutionReport::fill,
+            order->side == Utils::Side::bid ? Utils::Side::ask
+                                            : Utils::Side::bid,
+            0, order->id, price, std::min(quantity, order->quantity)});
+    }
+
+    if (quantity >= order->quantity) {
+        erase_order(order);
+        order->quantity = 0.0;
+    } else {
+        order->resize(order->quantity - quantity);
+    }
+
+    if (printable && order->side == Utils::Side::bid) {
+        trigger_bids();
+    } else if (printable) {
+        trigger_asks();
+    }
+
+    end_order_deferral();
+}
+
+bool Book::cancel(const uint64_t id, const double quantity) {
+    Order *order = order_index.find(id);
+    if (order == nullptr) {
+        return false;
+    }
+
+    if (quantity >= order->quantity) {
+        return order->cancel();
+    }
+
+    journal_command(Journal::Command::reduce, *order, quantity);
+    report(ExecutionReport::canceled, *order, quantity);
+    order->resize(order->quantity - quantity);
+    return true;
+}
+
+bool Book::remove(const uint64_t id) {
+    Order *order = order_index.find(id);
+    return order != nullptr && order->cancel();
+}
+
+SharedOrderPtr Book::replace(const uint64_t id, const uint64_t new_id,
+                             const Utils::Price price, const double quantity,
+                             const bool passive) {
+    Order *order = order_index.find(id);
+    if (order == nullptr) {
+        return nullptr;
+    }
+
+    // the replacement loses time priority and takes the side and
+    // all-or-nothing flag of the original order
+    const Utils::Side side = order->side;
+    const bool all_or_nothing = order->all_or_nothing;
+    const SharedOrderPtr order_ptr = order->queue_reference;
+    journal_command(Journal::Command::cancel, *order, order->quantity);
+    report(ExecutionReport::canceled, *order, order->quantity);
+    erase_order(order);
+
+    if (passive) {
+        return append_order(side, price, quantity, new_id, all_or_nothing);
+    }
+    return insert<Order>(side, price, quantity, false, all_or_nothing, new_id);
+}
+
+std::size_t Book::get_order_count() const { return order_index.size(); }
+
+std::size_t Book::get_memory_usage() const {
+    return sizeof(Book) + bids.get_memory_usage() + asks.get_memory_usage() +
+           bid_cumulative.get_memory_usage() +
+           ask_cumulative.get_memory_usage() +
+           order_index.get_memory_usage() + pool->get_reserved();
+}
+
+Utils::Price Book::get_bid_price() const {
+    return bids.empty() ? Utils::min_price : bids.best_price();
+}
+
+Utils::Price Book::get_ask_price() const {
+    return asks.empty() ? Utils::max_price : asks.best_price();
+}
+
+Utils::Price Book::get_market_price() const { return market_price; }
+
+double Book::get_bid_volume(const Utils::Price price) const {
+    enable_cumulative();
+    return bid_cumulative.volume(price);
+}
+
+double Book::get_ask_volume(const Utils::Price price) const {
+    enable_cumulative();
+    return ask_cumulative.volume(price);
+}
+
+Book::LimitIterator Book::bid_limits_begin() { return bids.begin(); }
+
+Book::LimitIterator Book::bid_limits_end() { return bids.end(); }
+
+Book::LimitIterator Book::ask_limits_begin() { return asks.begin(); }
+
+Book::LimitIterator Book::ask_limits_end() { return asks.end(); }
+
+Book::LimitIterator Book::bid_limit_at_price(const Utils::Price price) {
     return bids.find(price);
 }
 
-std::map<double, OrderLimit>::iterator Book::ask_limit_at_price(
-    const double price) {
+Book::LimitIterator Book::ask_limit_at_price(const Utils::Price price) {
     return asks.find(price);
 }
 
+const Depth &Book::get_bid_depth() const { return bid_depth; }
+
+const Depth &Book::get_ask_depth() const { return ask_depth; }
+
+void Book::enable_depth_deltas(const bool enabled) {
+    record_depth_deltas = enabled;
+}
+
+const std::vector<DepthDelta> &Book::get_depth_deltas() const {
+    return depth_deltas;
+}
+
+void Book::clear_depth_deltas() { depth_deltas.clear(); }
+
+void Book::enable_execution_reports(const bool enabled,
+                                    const std::size_t capacity) {
+    record_reports = enabled;
+    if (enabled) {
+        reports.reserve(capacity);
+    }
+}
+
+const std::vector<ExecutionReport> &Book::get_execution_reports() const {
+    return reports;
+}
+
+void Book::clear_execution_reports() { reports.clear(); }
+
+void Book::set_journal(OrderJournal *journal) { this->journal = journal; }
+
 // TODO ask / big orders begin / end to be implemented!
 
-Book::~Book() {
+void Book::teardown() {
+    order_index.clear();
+    // queued orders may still be referenced outside the book, each one
+    // is released rather than dropped with the pool
     bids.clear();
     asks.clear();
 
     bid_triggers.clear();
     ask_triggers.clear();
+    update_trigger_thresholds();
+    bid_cumulative.clear();
+    ask_cumulative.clear();
+    cumulative_enabled = false;
+    bid_depth.clear();
+    ask_depth.clear();
 }
+
+void Book::reset_session() {
+    // the pool is only rewound once no pooled object is alive anymore
+    teardown();
+    deferred.clear();
+    depth_deltas.clear();
+    reports.clear();
+    if (pool->get_live() == 0) {
+        pool->reset();
+    }
+    market_price = Utils::negative_price;
+}
+
+Book::~Book() { teardown(); }
@@ -5,17 +5,20 @@
 #include <map>
 #include <memory>
 #include <ostream>
-#include <queue>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "checkpoint.hpp"
+#include "cumulative.hpp"
+#include "deferred.hpp"
+#include "depth.hpp"
+#include "journal.hpp"
+#include "ladder.hpp"
 #include "order.hpp"
-
-template <class T, class... Args>
-std::shared_ptr<T> insert(Args &&... args) {
-    auto ptr = std::make_shared<T>(std::forward<Args>(args)...);
-    insert(ptr);
-    return ptr;
-}
+#include "order_index.hpp"
+#include "pool.hpp"
+#include "report.hpp"
 
 /*
  * @brief operator ostream object to handle orders from stream
@@ -28,6 +31,14 @@ std::ostream &operator<<(std::ostream &os, const Book &book);
  */
 class Book {
    private:
+    /*
+     * Orders and triggers created through insert<T> are allocated from
+     * the slab pool of the book. Every pooled object shares the
+     * ownership of the pool through its allocator, so that handles may
+     * outlive the book.
+     */
+    std::shared_ptr<SlabPool> pool;
+
     /*
      * During execution event handlers like "on_trade" are
      * called to insert additional orders. The orders are
@@ -35,16 +46,50 @@ class Book {
      * completed, the additional ordera executed.
      */
     std::size_t order_deferral_depth = 0;
-    std::queue<SharedOrderPtr> deferred;
+    DeferredQueue deferred;
+
+    // price levels are kept in tick-indexed ladders around the touch
+    PriceLadder<OrderLimit> bids;
+    PriceLadder<OrderLimit> asks;
+
+    std::map<Utils::Price, TriggerLimit, std::greater<Utils::Price>>
+        bid_triggers;
+    std::map<Utils::Price, TriggerLimit, std::less<Utils::Price>> ask_triggers;
+
+    // nearest queued trigger price of each side, an execution that does
+    // not reach it costs a single comparison
+    Utils::Price next_bid_trigger = Utils::negative_price;
+    Utils::Price next_ask_trigger = Utils::max_price;
 
-    std::map<double, OrderLimit, std::greater<double>> bids;
-    std::map<double, OrderLimit, std::less<double>> asks;
+    // cumulative quantities of each side, along with its resting
+    // all-or-nothing orders, maintained as levels change. They are built
+    // on first use, books that never see an all-or-nothing order or a
+    // volume query do not pay for their upkeep.
+    mutable bool cumulative_enabled = false;
+    mutable CumulativeDepth bid_cumulative;
+    mutable CumulativeDepth ask_cumulative;
 
-    std::map<double, TriggerLimit, std::greater<double>> bid_triggers;
-    std::map<double, TriggerLimit, std::less<double>> ask_triggers;
+    // best levels of each side, maintained as levels change
+    Depth bid_depth{Utils::Side::bid};
+    Depth ask_depth{Utils::Side::ask};
+    bool record_depth_deltas = false;
+    std::vector<DepthDelta> depth_deltas;
+
+    // execution reports since the last clear, off by default
+    bool record_reports = false;
+    std::vector<ExecutionReport> reports;
+
+    // write-ahead journal of the commands of the book, none by default
+    OrderJournal *journal = nullptr;
+
+    // resting orders by reference number, for ITCH-style messages
+    OrderIndex order_index;
+
+    // tick size in units of 1 / Utils::price_scale
+    const Utils::Price tick_size;
 
     // initialize market price with negative values
-    double market_price = Utils::negative_price;
+    Utils::Price market_price = Utils::negative_price;
 
     /*
      * @brief When called, subsequent orders will be deferred
@@ -59,6 +104,18 @@ class Book {
      */
     inline void end_order_deferral();
 
+    /*
+     * @brief validate and insert an order, orders deferred meanwhile are
+     * left queued when a deferral is already in progress
+     */
+    void accept_order(ConstOrderPtr &order);
+
+    /*
+     * @brief insert the deferred orders in turn, including the ones
+     * deferred while inserting them
+     */
+    void drain_deferred();
+
     inline void insert_bid(ConstOrderPtr &order);
     inline void insert_ask(ConstOrderPtr &order);
 
@@ -70,6 +127,9 @@ class Book {
      * This check is performec before all-or-nothing order
      * are executed.
      *
+     * The cumulative index answers unless resting all-or-nothing
+     * orders decide, only then the levels are walked.
+     *
      * @param order, the all-or-nothing bid order to be executed
      * @return true if the order is completely fillable
      * @return false if the order is partially fillable
@@ -81,6 +141,9 @@ class Book {
      * This check is performec before all-or-nothing order
      * are executed.
      *
+     * The cumulative index answers unless resting all-or-nothing
+     * orders decide, only then the levels are walked.
+     *
      * @param order, the all-or-nothing ask order to be executed
      * @return true if the order is completely fillable
      * @return false if the order is partially fillable
@@ -90,109 +153,485 @@ class Book {
     inline void execute_bid(ConstOrderPtr &order);
     inline void execute_ask(ConstOrderPtr &order);
 
-    inline void execute_queued_bid(ConstOrderPtr &order);
-    inline void execute_queued_ask(ConstOrderPtr &order);
+    /*
+     * @brief execute a queued all-or-nothing order found fillable,
+     * unlinking it from its price level first.
+     */
+    inline void execute_queued_bid(OrderLimit &limit, ConstOrderPtr &order);
+    inline void execute_queued_ask(OrderLimit &limit, ConstOrderPtr &order);
+
+    /*
+     * @brief get the price level a queued order rests in
+     */
+    OrderLimit *limit_of(const Order *order);
+
+    /*
+     * @brief remove a queued order from its price level, erasing the
+     * level once empty. Releases the reference held by the book.
+     */
+    void erase_order(Order *order);
+    void unindex_order(const Order *order);
+
+    /*
+     * @brief build the cumulative index of both sides from their levels
+     * unless it is already maintained
+     */
+    void enable_cumulative() const;
+    static CumulativeDepth::Level cumulative_level(const OrderLimit &limit);
+
+    /*
+     * @brief register a queued all-or-nothing order with the cumulative
+     * index of its side, or forget it. The order must carry the quantity
+     * it was registered with.
+     */
+    void index_all_or_nothing(const Order *order);
+    void unindex_all_or_nothing(const Order *order);
+
+    /*
+     * @brief bring the depth and cumulative index of a side in line with
+     * the level at price after it changed, was created or was erased
+     */
+    void update_depth(const Utils::Side side, const Utils::Price price);
+    inline void record_depth(const DepthDelta::Action action,
+                             const Utils::Side side, const std::size_t index,
+                             const DepthLevel &level);
+
+    /*
+     * @brief append an execution report when recording is enabled
+     */
+    inline void report(const ExecutionReport::Type type, const Order &order,
+                       const double quantity) {
+        if (record_reports) {
+            reports.push_back(ExecutionReport{type, order.side, order.id, 0,
+                                              order.price, quantity});
+        }
+    }
+    inline void report_fill(const Order &taker, const uint64_t maker_id,
+                            const Utils::Price price, const double quantity) {
+        if (record_reports) {
+            reports.push_back(ExecutionReport{ExecutionReport::fill,
+                                              taker.side, taker.id, maker_id,
+                                              price, quantity});
+        }
+    }
+    inline void report_trigger(const Trigger &trigger) {
+        if (record_reports) {
+            reports.push_back(ExecutionReport{ExecutionReport::triggered,
+                                              trigger.side, 0, 0,
+                                              trigger.price, 0.0});
+        }
+    }
+
+    /*
+     * @brief append a command to the journal when one is set
+     */
+    inline void journal_command(const Journal::Command::Type type,
+                                const Order &order, const double quantity) {
+        if (journal != nullptr) {
+            const uint8_t flags =
+                (order.immediate_or_cancel
+                     ? Journal::Command::immediate_or_cancel
+                     : 0) |
+                (order.all_or_nothing ? Journal::Command::all_or_nothing : 0);
+            journal->append(type, order.side, flags, order.id, order.price,
+                            quantity);
+        }
+    }
+
+    /*
+     * @brief fire the triggers reached by the market price, ask
+     * triggers respond to rising prices and bid triggers to falling ones.
+     * Each level is dequeued before it fires, the handlers may queue
+     * new triggers.
+     */
+    inline void trigger_asks();
+    inline void trigger_bids();
+
+    // refresh the nearest trigger prices after the trigger levels changed
+    inline void update_trigger_thresholds();
 
     inline void queue_bid_order(ConstOrderPtr &order);
     inline void queue_ask_order(ConstOrderPtr &order);
 
-    inline void queue_bid_trigger(ConstTriggerPtr trigger);
-    inline void queue_ask_trigger(ConstTriggerPtr trigger);
+    /*
+     * @brief execute quantity of a resting order at price, see execute()
+     */
+    inline void execute_resting(Order *order, const double quantity,
+                                const Utils::Price price,
+                                const bool printable);
+
+    /*
+     * @brief queue a trigger at its price, or fire it at once when the
+     * market price has already reached it
+     */
+    void queue_bid_trigger(ConstTriggerPtr trigger);
+    void queue_ask_trigger(ConstTriggerPtr trigger);
+
+    /*
+     * @brief remove a queued trigger from its level, erasing the level
+     * once empty
+     */
+    void erase_trigger(Trigger *trigger);
 
     /*
      * @brief check if any all-or-nothing bids at the specified
-     * price or lower are executable. This function is called
-     * if the quantity of queued order is increased.
+     * price or higher are executable. This function is called
+     * if the quantity of queued asks is increased. Levels whose
+     * smallest all-or-nothing order exceeds the ask volume at
+     * their price are skipped without being visited.
      *
-     * @param price, the price from which queued all-or-nothing
+     * @param price, the price up to which queued all-or-nothing
      * will be checked.
      */
-    inline void check_bids_all_or_nothing(const double price);
+    inline void check_bids_all_or_nothing(const Utils::Price price);
 
     /*
      * @brief check if any all-or-nothing asks at the specified
-     * price or ask are executable. This function is called
-     * if the quantity of queued order is increased.
+     * price or lower are executable. This function is called
+     * if the quantity of queued bids is increased. Levels whose
+     * smallest all-or-nothing order exceeds the bid volume at
+     * their price are skipped without being visited.
      *
-     * @param price, the price from which queued all-or-nothing
+     * @param price, the price up to which queued all-or-nothing
      * will be checked.
      */
-    inline void check_asks_all_or_nothing(const double price);
+    inline void check_asks_all_or_nothing(const Utils::Price price);
 
    public:
+    using LimitIterator = PriceLadder<OrderLimit>::iterator;
+
+    /*
+     * @brief Constructor
+     *
+     * @param tick_size, the price increment of the book in units of
+     * 1 / Utils::price_scale. The default matches ITCH fixed-point prices.
+     * @param ladder_span, number of ticks around the touch each side keeps
+     * in its direct-indexed ladder. Levels outside fall back to a map.
+     * @throw std::invalid_argument if tick_size is not positive
+     */
+    explicit Book(const Utils::Price tick_size = 1,
+                  const std::size_t ladder_span = 4096);
+
+    Utils::Price get_tick_size() const;
+
+    /*
+     * @brief convert a decimal price into ticks of this book, rounding
+     * to the nearest tick. Conversions happen only at the API edge.
+     */
+    Utils::Price to_ticks(const double price) const;
+
+    /*
+     * @brief convert an ITCH fixed-point price (four implied decimals)
+     * into ticks of this book, rounding a price off the tick to the
+     * nearest tick, halves up, as to_ticks does.
+     */
+    Utils::Price itch_to_ticks(const uint32_t price) const;
+
+    /*
+     * @brief convert a price in ticks back to a decimal price.
+     */
+    double to_price(const Utils::Price ticks) const;
+
+    /*
+     * @brief construct an order or trigger in the slab pool of the book
+     * and insert it. The pool lives as long as any object allocated
+     * from it, the object may outlive the book.
+     *
+     * @return the shared pointer to the new object
+     */
     template <class T, class... Args>
-    inline std::shared_ptr<T> insert(Args &&... args);
+    std::shared_ptr<T> insert(Args &&... args);
+
+    /*
+     * @brief get an allocator over the slab pool of the book, to
+     * construct objects with std::allocate_shared before inserting them
+     */
+    template <class T>
+    inline PoolAllocator<T> get_allocator() {
+        return PoolAllocator<T>(pool);
+    }
+
+    /*
+     * @brief get the slab pool, exposing the live and high-water
+     * object counters
+     */
+    inline const SlabPool &get_pool() const { return *pool; }
+
+    /*
+     * @brief end-of-session teardown. Releases every order and trigger
+     * and rewinds the slab pool in bulk unless some of them are still
+     * referenced outside the book. Those stay valid, no longer queued.
+     */
+    void reset_session();
+
+    /*
+     * @brief append a binary checkpoint of the book to buffer: resting
+     * orders in time priority, queued triggers and the market price,
+     * along with the stream position it corresponds to
+     * (see checkpoint.hpp)
+     *
+     * @return the size of the checkpoint in bytes
+     */
+    std::size_t checkpoint(std::vector<uint8_t> &buffer,
+                           const Checkpoint::Position &position = {}) const;
+
+    /*
+     * @brief replace the state of the book by a checkpoint, e.g. mapped
+     * from a file. Orders are appended to their levels directly, without
+     * going through insert, and no handler is called. Orders are
+     * restored as Order objects in the slab pool, triggers as Trigger
+     * objects unless make_trigger creates them. The orders and triggers
+     * of the book before the restore are released as reset_session()
+     * does: handles to them stay valid, but no longer queued, and the
+     * restored orders are new objects.
+     *
+     * @param position, set to the stream position of the checkpoint
+     * @return the size of the checkpoint, 0 if it is invalid or has
+     * another tick size. The book is left untouched then.
+     */
+    std::size_t restore(
+        const void *data, const std::size_t size,
+        Checkpoint::Position *position = nullptr,
+        const std::function<SharedTriggerPtr(Utils::Side, Utils::Price)>
+            &make_trigger = nullptr);
 
     /*
      * @brief Inserts an order/trigger into the book. Marketable orders
      * will be executed. Partially filled orders will be queued
-     * (or cancelled if marked as immediate-or-cancel)
+     * (or cancelled if marked as immediate-or-cancel). An order carrying
+     * the reference number of a resting order is rejected.
      *
      * @param order / trigger to be inserted
      */
-    inline void insert(std::shared_ptr<Order> order);
-    inline void insert(std::shared_ptr<Trigger> trigger);
+    void insert(std::shared_ptr<Order> order);
+    void insert(std::shared_ptr<Trigger> trigger);
+
+    void insert(const Insertable &insertable);
+
+    /*
+     * @brief Inserts orders/triggers in sequence, with the same outcome as
+     * inserting them one by one: orders inserted by the event handlers of
+     * one are executed before the next one is. The reference index is
+     * sized once for the whole batch, e.g. when loading a snapshot.
+     *
+     * @param orders / insertables, the first of count to be inserted
+     */
+    void insert_batch(const SharedOrderPtr *orders, const std::size_t count);
+    void insert_batch(const Insertable *insertables, const std::size_t count);
+
+    /*
+     * @brief queue an order at the back of its level without matching
+     * it, as a market data feed (ITCH 'A'/'F'/'U') reports an order
+     * resting on the exchange book. Locked or crossed levels, e.g. before
+     * the opening cross, are kept as they are. Not to be called from the
+     * event handlers of an order being executed.
+     *
+     * @return the order, nullptr if it is rejected: no quantity or the
+     * reference number of a resting order
+     */
+    SharedOrderPtr append_order(const Utils::Side side,
+                                const Utils::Price price,
+                                const double quantity, const uint64_t id,
+                                const bool all_or_nothing = false);
+
+    /*
+     * @brief pre-size the order reference index for an expected number
+     * of resting orders, so that it never grows during a session
+     */
+    void reserve_orders(const std::size_t expected);
+
+    /*
+     * @brief get a resting order by reference number
+     *
+     * @return the order or nullptr if no order rests with this reference
+     */
+    SharedOrderPtr find_order(const uint64_t id) const;
+
+    /*
+     * @brief execute quantity of a resting order against a counterparty
+     * outside the book at its price (ITCH 'E'). Updates the market price
+     * and fires reached triggers, the order is removed once fully
+     * executed.
+     *
+     * @return false if no order rests with this reference
+     */
+    bool execute(const uint64_t id, const double quantity);
+
+    /*
+     * @brief execute quantity of a resting order at another price than
+     * its own (ITCH 'C'). A printable execution sets the market price to
+     * price and fires reached triggers, a non-printable one leaves both
+     * alone.
+     *
+     * @return false if no order rests with this reference
+     */
+    bool execute(const uint64_t id, const double quantity,
+                 const Utils::Price price, const bool printable);
+
+    /*
+     * @brief cancel quantity of a resting order (ITCH 'X'). The order is
+     * canceled once no quantity is left.
+     *
+     * @return false if no order rests with this reference
+     */
+    bool cancel(const uint64_t id, const double quantity);
+
+    /*
+     * @brief cancel a resting order (ITCH 'D')
+     *
+     * @return false if no order rests with this reference
+     */
+    bool remove(const uint64_t id);
 
-    inline void insert(const Insertable &insertable);
+    /*
+     * @brief replace a resting order by a new one (ITCH 'U'). The new
+     * order keeps the side but loses the time priority.
+     *
+     * @param passive, queue the new order without matching it (see
+     * append_order)
+     * @return the new order or nullptr if no order rests with id, or a
+     * passive one is rejected
+     */
+    SharedOrderPtr replace(const uint64_t id, const uint64_t new_id,
+                           const Utils::Price price, const double quantity,
+                           const bool passive = false);
+
+    /*
+     * @brief get the number of resting orders indexed by reference
+     */
+    std::size_t get_order_count() const;
+
+    /*
+     * @brief get the approximate memory held by the book in bytes:
+     * ladders, order index and slab pool
+     */
+    std::size_t get_memory_usage() const;
 
     /*
      * @brief Get the best bid price
      *
-     * @return double
+     * @return Utils::Price in ticks
      */
-    inline double get_bid_price() const;
+    Utils::Price get_bid_price() const;
     /*
      * @brief Get the best ask price
      *
-     * @return double
+     * @return Utils::Price in ticks
      */
-    inline double get_ask_price() const;
+    Utils::Price get_ask_price() const;
     /*
      * @brief Get the price and which the last trade ocurred
      *
-     * @return double the current market price
+     * @return Utils::Price the current market price in ticks
      */
-    inline double get_market_price() const;
+    Utils::Price get_market_price() const;
+
+    /*
+     * @brief get the quantity resting on a side at price or better,
+     * all-or-nothing orders included, i.e. the volume available to an
+     * order on the other side limited at price. O(log n).
+     *
+     * @return the bid quantity at price or higher / the ask quantity at
+     * price or lower
+     */
+    double get_bid_volume(const Utils::Price price) const;
+    double get_ask_volume(const Utils::Price price) const;
 
     /*
      * @brief get an iterator to the end of bids
      *
-     * @return std::map<double, OrderLimit>::iterator bid
-     * price level end iterator
+     * @return LimitIterator bid price level begin iterator
      */
-    inline std::map<double, OrderLimit>::iterator bid_limits_begin();
+    LimitIterator bid_limits_begin();
     /*
      * @brief get an iterator to the first ask price level
      *
-     * @return std::map<double, OrderLimit>::iterator ask
-     * begin iterator
+     * @return LimitIterator ask price level begin iterator
      */
-    inline std::map<double, OrderLimit>::iterator ask_limits_begin();
+    LimitIterator ask_limits_begin();
 
     /*
      * @brief get an iterator to the end of the bids
      *
-     * @return std::map<double, OrderLimit>::iterator bid price
-     * level and iterator
+     * @return LimitIterator bid price level end iterator
      */
-    inline std::map<double, OrderLimit>::iterator bid_limits_end();
+    LimitIterator bid_limits_end();
     /*
      * @brief get an iterator to the end of the asks
      *
-     * @return std::map<double, OrderLimit>::iterator ask price
-     * level and iterator
+     * @return LimitIterator ask price level end iterator
+     */
+    LimitIterator ask_limits_end();
+    LimitIterator bid_limit_at_price(const Utils::Price price);
+    LimitIterator ask_limit_at_price(const Utils::Price price);
+
+    /*
+     * @brief get the best Depth::max_levels levels of a side, maintained
+     * incrementally, reading them is O(1)
+     */
+    const Depth &get_bid_depth() const;
+    const Depth &get_ask_depth() const;
+
+    /*
+     * @brief record the changes of the depth of both sides, off by default
+     */
+    void enable_depth_deltas(const bool enabled);
+
+    /*
+     * @brief get the depth changes recorded since the last clear, in order
+     */
+    const std::vector<DepthDelta> &get_depth_deltas() const;
+    void clear_depth_deltas();
+
+    /*
+     * @brief record execution reports of the orders and triggers of the
+     * book, off by default. The virtual handlers are still called, each
+     * report is appended before its handler runs.
+     *
+     * @param capacity, number of reports preallocated
+     */
+    void enable_execution_reports(const bool enabled,
+                                  const std::size_t capacity = 1024);
+
+    /*
+     * @brief get the execution reports recorded since the last clear, in
+     * order. Consumers drain them after an insertion or a batch.
+     */
+    const std::vector<ExecutionReport> &get_execution_reports() const;
+    void clear_execution_reports();
+
+    /*
+     * @brief journal the commands the book accepts from now on: inserted
+     * orders, cancels, executions and changes of queued orders (see
+     * journal.hpp). The journal must outlive the book or be unset,
+     * nullptr stops journaling.
      */
-    inline std::map<double, OrderLimit>::iterator ask_limits_end();
-    inline std::map<double, OrderLimit>::iterator bid_limit_at_price(
-        const double price);
-    inline std::map<double, OrderLimit>::iterator ask_limit_at_price(
-        const double price);
+    void set_journal(OrderJournal *journal);
 
     // destructor
     ~Book();
 
     friend Order;
+    friend OrderLimit;
     friend Trigger;
+    friend TriggerLimit;
+
+   private:
+    // drop levels and triggers, releasing the queued orders one by one
+    void teardown();
 };
 
+template <class T, class... Args>
+std::shared_ptr<T> Book::insert(Args &&... args) {
+    auto ptr = std::allocate_shared<T>(PoolAllocator<T>(pool),
+                                       std::forward<Args>(args)...);
+    insert(ptr);
+    return ptr;
+}
+
+template <class T, class... Args>
+std::shared_ptr<T> insert(Book &book, Args &&... args) {
+    return book.template insert<T>(std::forward<Args>(args)...);
+}
+
 #endif
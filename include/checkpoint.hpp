@@ -0,0 +1,121 @@
+/*
+ * Checkpoint header defines the binary checkpoint format of books:
+ *  - Position, the place in the ITCH stream a checkpoint corresponds to
+ *  - BookHeader, followed by the resting orders and the queued triggers
+ *    of a book (see Book::checkpoint)
+ *  - ManagerHeader, followed by one BookEntry and book checkpoint per
+ *    book of a BookManager (see BookManager::checkpoint)
+ *
+ * Records are fixed-size and 8-byte aligned, in host byte order, so a
+ * checkpoint written to a file can be restored straight from a mapping
+ * of it (see FileSystem::MappedFile). Orders are stored side by side,
+ * from the best level to the worst and in time priority within a level,
+ * so that restoring appends them to their levels in order.
+ *
+ * The version is bumped whenever a record changes, checkpoints of other
+ * versions are refused.
+ */
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace Checkpoint {
+
+const uint32_t version = 1;
+const char book_magic[8] = {'L', 'O', 'B', 'B', 'O', 'O', 'K', '\0'};
+const char manager_magic[8] = {'L', 'O', 'B', 'M', 'G', 'R', '\0', '\0'};
+
+struct Position {
+    // offset in the ITCH stream of the first message not applied yet
+    uint64_t offset = 0;
+    // number of messages applied
+    uint64_t sequence = 0;
+};
+
+struct BookHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    Utils::Price tick_size;
+    Utils::Price market_price;
+    Position position;
+    uint64_t orders;
+    uint64_t triggers;
+};
+
+struct OrderRecord {
+    uint64_t id;
+    Utils::Price price;
+    double quantity;
+    uint8_t side;
+    uint8_t all_or_nothing;
+    uint8_t reserved[6];
+};
+
+struct TriggerRecord {
+    Utils::Price price;
+    uint8_t side;
+    uint8_t reserved[7];
+};
+
+struct ManagerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t books;
+    Position position;
+};
+
+struct BookEntry {
+    uint16_t locate;
+    // space padded symbol as in the ITCH directory message
+    char symbol[8];
+    uint8_t reserved[6];
+    // size of the book checkpoint following the entry
+    uint64_t size;
+};
+
+static_assert(sizeof(BookHeader) == 64, "BookHeader is 64 bytes");
+static_assert(sizeof(OrderRecord) == 32, "OrderRecord is 32 bytes");
+static_assert(sizeof(TriggerRecord) == 16, "TriggerRecord is 16 bytes");
+static_assert(sizeof(ManagerHeader) == 40, "ManagerHeader is 40 bytes");
+static_assert(sizeof(BookEntry) == 24, "BookEntry is 24 bytes");
+
+/*
+ * @brief append a record to a buffer
+ */
+template <class Record>
+inline void Append(std::vector<uint8_t> &buffer, const Record &record) {
+    const std::size_t size = buffer.size();
+    buffer.resize(size + sizeof(Record));
+    std::memcpy(buffer.data() + size, &record, sizeof(Record));
+}
+
+/*
+ * @brief read the record at offset of a buffer of size bytes and move
+ * the offset past it
+ *
+ * @return false if the buffer is too short
+ */
+template <class Record>
+inline bool Read(const void *data, const std::size_t size,
+                 std::size_t &offset, Record &record) {
+    if (offset > size || size - offset < sizeof(Record)) {
+        return false;
+    }
+    std::memcpy(&record, static_cast<const uint8_t *>(data) + offset,
+                sizeof(Record));
+    offset += sizeof(Record);
+    return true;
+}
+
+}  // namespace Checkpoint
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * CumulativeDepth header defines the cumulative quantity index of one
+ * book side.
+ *
+ * Level quantities are kept in a Fenwick tree over a window of `span`
+ * consecutive ranks, so that the quantity resting at a price or better is
+ * a prefix sum in O(log span). Each node holds both the quantity that can
+ * be filled partially and the total including all-or-nothing orders.
+ * Levels worse than the window are kept in an overflow map, as in the
+ * price ladder. The window is rebuilt when a better price arrives or when
+ * it runs empty.
+ *
+ * The index also holds the resting all-or-nothing orders of the side,
+ * ordered by rank and quantity, so that the smallest all-or-nothing order
+ * of a level is found without visiting the level.
+ *
+ * Ranks increase from the best to the worst price on both sides
+ * (rank = -price for bids, price for asks).
+ *
+ * Not thread-safe
+ */
+
+#ifndef CUMULATIVE_HPP
+#define CUMULATIVE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+class CumulativeDepth {
+   public:
+    using Rank = Utils::Price;
+
+    struct Level {
+        // quantity of the orders that can be filled partially
+        double quantity = 0.0;
+        // all-or-nothing quantity included
+        double total = 0.0;
+
+        inline bool empty() const { return total == 0.0; }
+    };
+
+    /*
+     * @brief Constructor
+     *
+     * @param side, the book side ordering the levels
+     * @param span, number of ticks covered by the window, rounded up to a
+     * power of two and at least 64
+     */
+    explicit CumulativeDepth(const Utils::Side side,
+                             const std::size_t span = 4096)
+        : side(side) {
+        std::size_t size = 64;
+        while (size < span) {
+            size <<= 1;
+        }
+        this->span = size;
+    }
+
+    inline Rank to_rank(const Utils::Price price) const {
+        return side == Utils::Side::bid ? -price : price;
+    }
+    inline Utils::Price to_price(const Rank rank) const {
+        return side == Utils::Side::bid ? -rank : rank;
+    }
+
+    /*
+     * @brief set the quantities of the level at price, an empty level
+     * is dropped
+     */
+    void set(const Utils::Price price, const Level &level) {
+        const Rank rank = to_rank(price);
+
+        if (window_levels == 0 && overflow.empty()) {
+            if (level.empty()) {
+                return;
+            }
+            if (values.empty()) {
+                values.resize(span);
+                tree.resize(span);
+            }
+            base = rank - headroom();
+        } else if (rank < base) {
+            if (level.empty()) {
+                return;
+            }
+            rebase(rank - headroom());
+        }
+
+        if (rank >= window_end() && !level.empty()) {
+            // recentre when the touch has drifted far enough to cover it
+            const Rank best = best_window_rank();
+            if (rank - best < static_cast<Rank>(span)) {
+                const Rank preferred = best - headroom();
+                const Rank needed = rank - static_cast<Rank>(span) + 1;
+                rebase(preferred > needed ? preferred : needed);
+            }
+        }
+
+        if (rank >= window_end()) {
+            if (level.empty()) {
+                overflow.erase(rank);
+            } else {
+                overflow[rank] = level;
+            }
+            return;
+        }
+
+        const std::size_t index = static_cast<std::size_t>(rank - base);
+        Level &value = values[index];
+        if (value.empty() && !level.empty()) {
+            ++window_levels;
+        } else if (!value.empty() && level.empty()) {
+            --window_levels;
+        }
+        add(index, level.quantity - value.quantity, level.total - value.total);
+        value = level;
+
+        if (window_levels == 0) {
+            // keep the best levels in the window
+            if (overflow.empty()) {
+                clear_window();
+            } else {
+                rebase(overflow.begin()->first - headroom());
+            }
+        }
+    }
+
+    /*
+     * @brief get the quantities resting at price or better
+     */
+    Level cumulative(const Utils::Price price) const {
+        const Rank rank = to_rank(price);
+        Level sum;
+        if ((window_levels == 0 && overflow.empty()) || rank < base) {
+            return sum;
+        }
+
+        const Rank last = rank < window_end() ? rank : window_end() - 1;
+        for (std::size_t i = static_cast<std::size_t>(last - base) + 1; i > 0;
+             i &= i - 1) {
+            sum.quantity += tree[i - 1].quantity;
+            sum.total += tree[i - 1].total;
+        }
+
+        for (auto iter = overflow.begin();
+             iter != overflow.end() && iter->first <= rank; ++iter) {
+            sum.quantity += iter->second.quantity;
+            sum.total += iter->second.total;
+        }
+        return sum;
+    }
+
+    /*
+     * @brief get the total quantity, all-or-nothing included, resting at
+     * price or better
+     */
+    inline double volume(const Utils::Price price) const {
+        return cumulative(price).total;
+    }
+
+    /*
+     * @brief register or forget a resting all-or-nothing order
+     */
+    inline void insert_all_or_nothing(const Utils::Price price,
+                                      const double quantity) {
+        all_or_nothing.emplace(to_rank(price), quantity);
+    }
+
+    inline void erase_all_or_nothing(const Utils::Price price,
+                                     const double quantity) {
+        const auto iter = all_or_nothing.find({to_rank(price), quantity});
+        if (iter != all_or_nothing.end()) {
+            all_or_nothing.erase(iter);
+        }
+    }
+
+    /*
+     * @brief find the first level holding all-or-nothing orders at rank
+     * first or worse, along with the smallest of these orders
+     *
+     * @return false if there is none
+     */
+    inline bool next_all_or_nothing(const Rank first, Rank &rank,
+                                    double &quantity) const {
+        const auto iter = all_or_nothing.lower_bound(
+            {first, -std::numeric_limits<double>::infinity()});
+        if (iter == all_or_nothing.end()) {
+            return false;
+        }
+        rank = iter->first;
+        quantity = iter->second;
+        return true;
+    }
+
+    inline std::size_t all_or_nothing_count() const {
+        return all_or_nothing.size();
+    }
+
+    // approximate heap memory held by the index, in bytes
+    inline std::size_t get_memory_usage() const {
+        // a red-black tree node carries 4 words on top of its value
+        return (values.capacity() + tree.capacity()) * sizeof(Level) +
+               overflow.size() * (sizeof(std::pair<Rank, Level>) + 32) +
+               all_or_nothing.size() * (sizeof(std::pair<Rank, double>) + 32);
+    }
+
+    void clear() {
+        clear_window();
+        overflow.clear();
+        all_or_nothing.clear();
+    }
+
+   private:
+    Utils::Side side;
+    std::size_t span;
+
+    // first rank covered by the window, the window is [base, base + span)
+    Rank base = 0;
+    std::size_t window_levels = 0;
+
+    // levels and fenwick nodes of the window, allocated on first use
+    std::vector<Level> values;
+    std::vector<Level> tree;
+
+    // levels worse than the window, keyed by rank
+    std::map<Rank, Level> overflow;
+
+    // resting all-or-nothing orders by rank, then quantity
+    std::multiset<std::pair<Rank, double>> all_or_nothing;
+
+    inline Rank window_end() const { return base + static_cast<Rank>(span); }
+
+    // headroom left in front of the best level when recentring
+    inline Rank headroom() const { return static_cast<Rank>(span / 4); }
+
+    // the window must hold a level
+    inline Rank best_window_rank() const {
+        std::size_t index = 0;
+        while (values[index].empty()) {
+            ++index;
+        }
+        return base + static_cast<Rank>(index);
+    }
+
+    inline void add(std::size_t index, const double quantity,
+                    const double total) {
+        for (; index < span; index |= index + 1) {
+            tree[index].quantity += quantity;
+            tree[index].total += total;
+        }
+    }
+
+    void clear_window() {
+        std::fill(values.begin(), values.end(), Level());
+        std::fill(tree.begin(), tree.end(), Level());
+        window_levels = 0;
+    }
+
+    /*
+     * @brief move the window to start at new_base, every level must be at
+     * or after new_base. The tree is rebuilt in O(span), which also drops
+     * the rounding accumulated by the updates.
+     */
+    void rebase(const Rank new_base) {
+        const Rank new_end = new_base + static_cast<Rank>(span);
+
+        std::vector<Level> moved(span);
+        for (std::size_t i = 0; i < span; ++i) {
+            if (values[i].empty()) {
+                continue;
+            }
+            const Rank rank = base + static_cast<Rank>(i);
+            if (rank < new_end) {
+                moved[static_cast<std::size_t>(rank - new_base)] = values[i];
+            } else {
+                overflow[rank] = values[i];
+            }
+        }
+
+        base = new_base;
+        window_levels = 0;
+        auto iter = overflow.begin();
+        while (iter != overflow.end() && iter->first < new_end) {
+            moved[static_cast<std::size_t>(iter->first - new_base)] =
+                iter->second;
+            iter = overflow.erase(iter);
+        }
+
+        values.swap(moved);
+        for (std::size_t i = 0; i < span; ++i) {
+            tree[i] = values[i];
+            window_levels += values[i].empty() ? 0 : 1;
+        }
+        for (std::size_t i = 0; i < span; ++i) {
+            const std::size_t parent = i | (i + 1);
+            if (parent < span) {
+                tree[parent].quantity += tree[i].quantity;
+                tree[parent].total += tree[i].total;
+            }
+        }
+    }
+};
+
+#endif
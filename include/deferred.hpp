@@ -0,0 +1,86 @@
+/*
+ * DeferredQueue header defines the FIFO of orders inserted by event
+ * handlers while the book is busy executing another order.
+ *
+ * Orders are kept in a power-of-two ring of shared pointers allocated
+ * once, so deferring and draining orders never allocates. The ring only
+ * grows when a cascade defers more orders than it holds, it is then
+ * bounded by the deepest cascade seen.
+ *
+ * Not thread-safe
+ */
+
+#ifndef DEFERRED_HPP
+#define DEFERRED_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class Order;
+
+class DeferredQueue {
+   private:
+    std::vector<std::shared_ptr<Order>> ring;
+    std::size_t mask;
+    std::size_t head = 0;
+    std::size_t count = 0;
+
+    void grow() {
+        std::vector<std::shared_ptr<Order>> larger(ring.size() * 2);
+        for (std::size_t i = 0; i < count; ++i) {
+            larger[i] = std::move(ring[(head + i) & mask]);
+        }
+        ring.swap(larger);
+        mask = ring.size() - 1;
+        head = 0;
+    }
+
+   public:
+    /*
+     * @brief Constructor
+     *
+     * @param capacity, number of orders held before the ring grows,
+     * rounded up to a power of two
+     */
+    explicit DeferredQueue(const std::size_t capacity = 64) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        ring.resize(size);
+        mask = size - 1;
+    }
+
+    inline bool empty() const { return count == 0; }
+    inline std::size_t size() const { return count; }
+    inline std::size_t capacity() const { return ring.size(); }
+
+    inline void push(const std::shared_ptr<Order> &order) {
+        if (count == ring.size()) {
+            grow();
+        }
+        ring[(head + count) & mask] = order;
+        ++count;
+    }
+
+    /*
+     * @brief remove the oldest order, the queue must not be empty
+     */
+    inline std::shared_ptr<Order> pop() {
+        std::shared_ptr<Order> order = std::move(ring[head]);
+        head = (head + 1) & mask;
+        --count;
+        return order;
+    }
+
+    void clear() {
+        while (count != 0) {
+            pop();
+        }
+        head = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Depth header defines the aggregated (L2) view of a book side:
+ *  - DepthLevel, price, quantity and number of orders of a level
+ *  - DepthDelta, change of the level at an index of the view
+ *  - Depth, the best levels of one side in a contiguous array
+ *
+ * The book keeps one Depth per side up to date as levels change, so that
+ * reading the top of the book never walks the ladder. Deltas follow the
+ * usual market-by-price conventions:
+ *  - add, the level is inserted at index, the levels from index on move
+ *    one index down and a level pushed beyond max_levels is dropped
+ *    without a delta of its own
+ *  - update, quantity or order count of the level at index changed
+ *  - remove, the level at index is removed, the levels below move one
+ *    index up. The level entering the view at the bottom, if any, follows
+ *    as an add.
+ *
+ * Not thread-safe
+ */
+
+#ifndef DEPTH_HPP
+#define DEPTH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils.hpp"
+
+struct DepthLevel {
+    Utils::Price price;
+    // all-or-nothing quantity included
+    double quantity;
+    std::size_t orders;
+
+    inline bool operator==(const DepthLevel &other) const {
+        return price == other.price && quantity == other.quantity &&
+               orders == other.orders;
+    }
+    inline bool operator!=(const DepthLevel &other) const {
+        return !(*this == other);
+    }
+};
+
+struct DepthDelta {
+    enum Action : uint8_t { add = 0, update = 1, remove = 2 };
+
+    Action action;
+    Utils::Side side;
+    uint8_t index;
+    // the level removed for remove actions
+    DepthLevel level;
+};
+
+class Depth {
+   public:
+    static const std::size_t max_levels = 10;
+
+    explicit Depth(const Utils::Side side) : side(side) {}
+
+    inline Utils::Side get_side() const { return side; }
+    inline std::size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline bool full() const { return count == max_levels; }
+
+    // levels from the best one, index < size()
+    inline const DepthLevel &operator[](const std::size_t index) const {
+        return levels[index];
+    }
+    inline const DepthLevel *begin() const { return levels.data(); }
+    inline const DepthLevel *end() const { return levels.data() + count; }
+
+    /*
+     * @brief get the index of the level at price, or the index a level at
+     * this price would be inserted at
+     */
+    inline std::size_t find(const Utils::Price price) const {
+        std::size_t index = 0;
+        if (side == Utils::Side::bid) {
+            while (index < count && levels[index].price > price) ++index;
+        } else {
+            while (index < count && levels[index].price < price) ++index;
+        }
+        return index;
+    }
+
+    // whether the level at index is the level at price
+    inline bool at(const std::size_t index, const Utils::Price price) const {
+        return index < count && levels[index].price == price;
+    }
+
+    // insert at index < max_levels, dropping the worst level when full
+    inline void insert(const std::size_t index, const DepthLevel &level) {
+        const std::size_t last = full() ? max_levels - 1 : count++;
+        for (std::size_t i = last; i > index; --i) {
+            levels[i] = levels[i - 1];
+        }
+        levels[index] = level;
+    }
+
+    inline void set(const std::size_t index, const DepthLevel &level) {
+        levels[index] = level;
+    }
+
+    inline void erase(const std::size_t index) {
+        for (std::size_t i = index + 1; i < count; ++i) {
+            levels[i - 1] = levels[i];
+        }
+        --count;
+    }
+
+    inline void clear() { count = 0; }
+
+   private:
+    std::array<DepthLevel, max_levels> levels;
+    std::size_t count = 0;
+    const Utils::Side side;
+};
+
+#endif
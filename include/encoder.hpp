@@ -0,0 +1,383 @@
+/*
+ * NASDAQ ITCH 5.0 encoder
+ *
+ * Encoder appends length-prefixed messages to a byte buffer, the framing
+ * read by ITCHHandlerT::Process. Every message type of MessageTypes has a
+ * method of the same name, without the Message suffix, taking the common
+ * Header then the fields in the order of the specification. Fields are
+ * written at the offsets the views read them from, alpha fields are left
+ * justified and padded with spaces.
+ *
+ * Each method returns the view of the encoded message, valid until the
+ * buffer is next modified.
+ */
+
+#ifndef ENCODER_HPP
+#define ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "messages.hpp"
+#include "utils.hpp"
+
+namespace MessageTypes {
+
+struct Header {
+    uint16_t locate = 0;
+    uint16_t tracking = 0;
+    // nanoseconds since midnight, 48 bits
+    uint64_t timestamp = 0;
+};
+
+class Encoder {
+   public:
+    explicit Encoder(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    inline std::vector<uint8_t>& data() { return buffer; }
+
+    inline SystemEventMessage SystemEvent(const Header& header,
+                                          const char event_code) {
+        uint8_t* message = Begin<SystemEventMessage>(header);
+        Char(message, 11, event_code);
+        return SystemEventMessage(message);
+    }
+
+    inline StockDirectoryMessage StockDirectory(
+        const Header& header, const std::string_view stock,
+        const char market_category, const char financial_status_indicator,
+        const uint32_t round_lot_size, const char round_lots_only,
+        const char issue_classification, const std::string_view issue_sub_type,
+        const char authenticity, const char short_sale_threshold_indicator,
+        const char ipo_flag, const char luld_reference_price_tier,
+        const char etp_flag, const uint32_t etp_leverage_factor,
+        const char inverse_indicator) {
+        uint8_t* message = Begin<StockDirectoryMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, market_category);
+        Char(message, 20, financial_status_indicator);
+        U32(message, 21, round_lot_size);
+        Char(message, 25, round_lots_only);
+        Char(message, 26, issue_classification);
+        Alpha(message, 27, 2, issue_sub_type);
+        Char(message, 29, authenticity);
+        Char(message, 30, short_sale_threshold_indicator);
+        Char(message, 31, ipo_flag);
+        Char(message, 32, luld_reference_price_tier);
+        Char(message, 33, etp_flag);
+        U32(message, 34, etp_leverage_factor);
+        Char(message, 38, inverse_indicator);
+        return StockDirectoryMessage(message);
+    }
+
+    inline StockTradingActionMessage StockTradingAction(
+        const Header& header, const std::string_view stock,
+        const char trading_state, const char reserved,
+        const std::string_view reason) {
+        uint8_t* message = Begin<StockTradingActionMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, trading_state);
+        Char(message, 20, reserved);
+        Alpha(message, 21, 4, reason);
+        return StockTradingActionMessage(message);
+    }
+
+    inline RegSHOMessage RegSHO(const Header& header,
+                                const std::string_view stock,
+                                const char reg_sho_action) {
+        uint8_t* message = Begin<RegSHOMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, reg_sho_action);
+        return RegSHOMessage(message);
+    }
+
+    inline MarketParticipantPositionMessage MarketParticipantPosition(
+        const Header& header, const std::string_view mpid,
+        const std::string_view stock, const char primary_market_maker,
+        const char market_maker_mode, const char market_participant_state) {
+        uint8_t* message = Begin<MarketParticipantPositionMessage>(header);
+        Alpha(message, 11, 4, mpid);
+        Alpha(message, 15, 8, stock);
+        Char(message, 23, primary_market_maker);
+        Char(message, 24, market_maker_mode);
+        Char(message, 25, market_participant_state);
+        return MarketParticipantPositionMessage(message);
+    }
+
+    inline MWCBDeclineLevelMessage MWCBDeclineLevel(const Header& header,
+                                                    const uint64_t level1,
+                                                    const uint64_t level2,
+                                                    const uint64_t level3) {
+        uint8_t* message = Begin<MWCBDeclineLevelMessage>(header);
+        U64(message, 11, level1);
+        U64(message, 19, level2);
+        U64(message, 27, level3);
+        return MWCBDeclineLevelMessage(message);
+    }
+
+    inline MWCBStatusMessage MWCBStatus(const Header& header,
+                                        const char breached_level) {
+        uint8_t* message = Begin<MWCBStatusMessage>(header);
+        Char(message, 11, breached_level);
+        return MWCBStatusMessage(message);
+    }
+
+    inline IPOQuotingPeriodUpdateMessage IPOQuotingPeriodUpdate(
+        const Header& header, const std::string_view stock,
+        const uint32_t release_time, const char release_qualifier,
+        const uint32_t ipo_price) {
+        uint8_t* message = Begin<IPOQuotingPeriodUpdateMessage>(header);
+        Alpha(message, 11, 8, stock);
+        U32(message, 19, release_time);
+        Char(message, 23, release_qualifier);
+        U32(message, 24, ipo_price);
+        return IPOQuotingPeriodUpdateMessage(message);
+    }
+
+    inline LULDAuctionCollarMessage LULDAuctionCollar(
+        const Header& header, const std::string_view stock,
+        const uint32_t reference_price, const uint32_t upper_price,
+        const uint32_t lower_price, const uint32_t extension) {
+        uint8_t* message = Begin<LULDAuctionCollarMessage>(header);
+        Alpha(message, 11, 8, stock);
+        U32(message, 19, reference_price);
+        U32(message, 23, upper_price);
+        U32(message, 27, lower_price);
+        U32(message, 31, extension);
+        return LULDAuctionCollarMessage(message);
+    }
+
+    inline OperationalHaltMessage OperationalHalt(
+        const Header& header, const std::string_view stock,
+        const char market_code, const char operational_halt_action) {
+        uint8_t* message = Begin<OperationalHaltMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, market_code);
+        Char(message, 20, operational_halt_action);
+        return OperationalHaltMessage(message);
+    }
+
+    inline AddOrderMesssage AddOrder(const Header& header,
+                                     const uint64_t reference,
+                                     const char buy_sell_indicator,
+                                     const uint32_t shares,
+                                     const std::string_view stock,
+                                     const uint32_t price) {
+        uint8_t* message = Begin<AddOrderMesssage>(header);
+        AddOrderFields(message, reference, buy_sell_indicator, shares, stock,
+                       price);
+        return AddOrderMesssage(message);
+    }
+
+    inline AddOrderMPIDAttributionMessage AddOrderMPIDAttribution(
+        const Header& header, const uint64_t reference,
+        const char buy_sell_indicator, const uint32_t shares,
+        const std::string_view stock, const uint32_t price,
+        const std::string_view attribution) {
+        uint8_t* message = Begin<AddOrderMPIDAttributionMessage>(header);
+        AddOrderFields(message, reference, buy_sell_indicator, shares, stock,
+                       price);
+        Alpha(message, 36, 4, attribution);
+        return AddOrderMPIDAttributionMessage(message);
+    }
+
+    inline OrderExecutedMessage OrderExecuted(const Header& header,
+                                              const uint64_t reference,
+                                              const uint32_t executed_shares,
+                                              const uint64_t match_number) {
+        uint8_t* message = Begin<OrderExecutedMessage>(header);
+        U64(message, 11, reference);
+        U32(message, 19, executed_shares);
+        U64(message, 23, match_number);
+        return OrderExecutedMessage(message);
+    }
+
+    inline OrderExecutedWithPriceMessage OrderExecutedWithPrice(
+        const Header& header, const uint64_t reference,
+        const uint32_t executed_shares, const uint64_t match_number,
+        const char printable, const uint32_t execution_price) {
+        uint8_t* message = Begin<OrderExecutedWithPriceMessage>(header);
+        U64(message, 11, reference);
+        U32(message, 19, executed_shares);
+        U64(message, 23, match_number);
+        Char(message, 31, printable);
+        U32(message, 32, execution_price);
+        return OrderExecutedWithPriceMessage(message);
+    }
+
+    inline OrderCancelMessage OrderCancel(const Header& header,
+                                          const uint64_t reference,
+                                          const uint32_t canceled_shares) {
+        uint8_t* message = Begin<OrderCancelMessage>(header);
+        U64(message, 11, reference);
+        U32(message, 19, canceled_shares);
+        return OrderCancelMessage(message);
+    }
+
+    inline OrderDeleteMessage OrderDelete(const Header& header,
+                                          const uint64_t reference) {
+        uint8_t* message = Begin<OrderDeleteMessage>(header);
+        U64(message, 11, reference);
+        return OrderDeleteMessage(message);
+    }
+
+    inline OrderReplaceMessage OrderReplace(const Header& header,
+                                            const uint64_t original_reference,
+                                            const uint64_t new_reference,
+                                            const uint32_t shares,
+                                            const uint32_t price) {
+        uint8_t* message = Begin<OrderReplaceMessage>(header);
+        U64(message, 11, original_reference);
+        U64(message, 19, new_reference);
+        U32(message, 27, shares);
+        U32(message, 31, price);
+        return OrderReplaceMessage(message);
+    }
+
+    inline TradeMessage Trade(const Header& header, const uint64_t reference,
+                              const char buy_sell_indicator,
+                              const uint32_t shares,
+                              const std::string_view stock,
+                              const uint32_t price,
+                              const uint64_t match_number) {
+        uint8_t* message = Begin<TradeMessage>(header);
+        AddOrderFields(message, reference, buy_sell_indicator, shares, stock,
+                       price);
+        U64(message, 36, match_number);
+        return TradeMessage(message);
+    }
+
+    inline CrossTradeMessage CrossTrade(const Header& header,
+                                        const uint64_t shares,
+                                        const std::string_view stock,
+                                        const uint32_t cross_price,
+                                        const uint64_t match_number,
+                                        const char cross_type) {
+        uint8_t* message = Begin<CrossTradeMessage>(header);
+        U64(message, 11, shares);
+        Alpha(message, 19, 8, stock);
+        U32(message, 27, cross_price);
+        U64(message, 31, match_number);
+        Char(message, 39, cross_type);
+        return CrossTradeMessage(message);
+    }
+
+    inline BrokenTradeMessage BrokenTrade(const Header& header,
+                                          const uint64_t match_number) {
+        uint8_t* message = Begin<BrokenTradeMessage>(header);
+        U64(message, 11, match_number);
+        return BrokenTradeMessage(message);
+    }
+
+    inline NOIIMessage NOII(const Header& header, const uint64_t paired_shares,
+                            const uint64_t imbalance_shares,
+                            const char imbalance_direction,
+                            const std::string_view stock,
+                            const uint32_t far_price,
+                            const uint32_t near_price,
+                            const uint32_t current_reference_price,
+                            const char cross_type,
+                            const char price_variation_indicator) {
+        uint8_t* message = Begin<NOIIMessage>(header);
+        U64(message, 11, paired_shares);
+        U64(message, 19, imbalance_shares);
+        Char(message, 27, imbalance_direction);
+        Alpha(message, 28, 8, stock);
+        U32(message, 36, far_price);
+        U32(message, 40, near_price);
+        U32(message, 44, current_reference_price);
+        Char(message, 48, cross_type);
+        Char(message, 49, price_variation_indicator);
+        return NOIIMessage(message);
+    }
+
+    inline RPIIMessage RPII(const Header& header, const std::string_view stock,
+                            const char interest_flag) {
+        uint8_t* message = Begin<RPIIMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, interest_flag);
+        return RPIIMessage(message);
+    }
+
+    inline DirectListingWithCapitalRaiseMessage DirectListingWithCapitalRaise(
+        const Header& header, const std::string_view stock,
+        const char open_eligibility_status,
+        const uint32_t minimum_allowable_price,
+        const uint32_t maximum_allowable_price,
+        const uint32_t near_execution_price,
+        const uint64_t near_execution_time,
+        const uint32_t lower_price_range_collar,
+        const uint32_t upper_price_range_collar) {
+        uint8_t* message = Begin<DirectListingWithCapitalRaiseMessage>(header);
+        Alpha(message, 11, 8, stock);
+        Char(message, 19, open_eligibility_status);
+        U32(message, 20, minimum_allowable_price);
+        U32(message, 24, maximum_allowable_price);
+        U32(message, 28, near_execution_price);
+        U64(message, 32, near_execution_time);
+        U32(message, 40, lower_price_range_collar);
+        U32(message, 44, upper_price_range_collar);
+        return DirectListingWithCapitalRaiseMessage(message);
+    }
+
+   private:
+    std::vector<uint8_t>& buffer;
+
+    // append the length prefix and the header, the body left zeroed
+    template <class Message>
+    inline uint8_t* Begin(const Header& header) {
+        const std::size_t offset = buffer.size();
+        buffer.resize(offset + 2 + Message::length);
+        uint8_t* frame = buffer.data() + offset;
+        Utils::StoreBigEndian16(frame, Message::length);
+
+        uint8_t* message = frame + 2;
+        message[0] = static_cast<uint8_t>(Message::type);
+        Utils::StoreBigEndian16(message + 1, header.locate);
+        Utils::StoreBigEndian16(message + 3, header.tracking);
+        Utils::StoreBigEndian48(message + 5, header.timestamp);
+        return message;
+    }
+
+    static inline void Char(uint8_t* message, const std::size_t offset,
+                            const char value) {
+        message[offset] = static_cast<uint8_t>(value);
+    }
+    static inline void U32(uint8_t* message, const std::size_t offset,
+                           const uint32_t value) {
+        Utils::StoreBigEndian32(message + offset, value);
+    }
+    static inline void U64(uint8_t* message, const std::size_t offset,
+                           const uint64_t value) {
+        Utils::StoreBigEndian64(message + offset, value);
+    }
+    // truncated to size, padded with spaces
+    static inline void Alpha(uint8_t* message, const std::size_t offset,
+                             const std::size_t size,
+                             const std::string_view value) {
+        const std::size_t count = value.size() < size ? value.size() : size;
+        std::memcpy(message + offset, value.data(), count);
+        std::memset(message + offset + count, ' ', size - count);
+    }
+
+    // fields shared by 'A', 'F' and 'P'
+    static inline void AddOrderFields(uint8_t* message,
+                                      const uint64_t reference,
+                                      const char buy_sell_indicator,
+                                      const uint32_t shares,
+                                      const std::string_view stock,
+                                      const uint32_t price) {
+        U64(message, 11, reference);
+        Char(message, 19, buy_sell_indicator);
+        U32(message, 20, shares);
+        Alpha(message, 24, 8, stock);
+        U32(message, 32, price);
+    }
+};
+
+}  // namespace MessageTypes
+
+#endif
@@ -0,0 +1,549 @@
+#include "filesystem.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define FILESYSTEM_IO_URING 1
+#endif
+
+namespace FileSystem {
+
+MappedFile::MappedFile(MappedFile&& file) noexcept
+    : Path(std::move(file)),
+      _data(file._data),
+      _size(file._size),
+      _fd(file._fd) {
+    file._data = nullptr;
+    file._size = 0;
+    file._fd = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& file) noexcept {
+    if (this != &file) {
+        Close();
+        Path::operator=(std::move(file));
+        _data = file._data;
+        _size = file._size;
+        _fd = file._fd;
+        file._data = nullptr;
+        file._size = 0;
+        file._fd = -1;
+    }
+    return *this;
+}
+
+bool MappedFile::Open(bool populate, bool sequential) {
+    Close();
+
+    _fd = ::open(_path.c_str(), O_RDONLY);
+    if (_fd < 0) return false;
+
+    struct stat status;
+    if (::fstat(_fd, &status) != 0 || status.st_size == 0) {
+        Close();
+        return false;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (populate) flags |= MAP_POPULATE;
+#endif
+
+    void* data = ::mmap(nullptr, status.st_size, PROT_READ, flags, _fd, 0);
+    if (data == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    if (sequential) ::madvise(data, status.st_size, MADV_SEQUENTIAL);
+
+    _data = data;
+    _size = status.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (_data != nullptr) ::munmap(const_cast<void*>(_data), _size);
+    if (_fd >= 0) ::close(_fd);
+    _data = nullptr;
+    _size = 0;
+    _fd = -1;
+}
+
+FileWriter::FileWriter(FileWriter&& file) noexcept
+    : Path(std::move(file)),
+      _buffer(std::move(file._buffer)),
+      _pending(file._pending),
+      _size(file._size),
+      _fd(file._fd) {
+    file._pending = 0;
+    file._size = 0;
+    file._fd = -1;
+}
+
+FileWriter& FileWriter::operator=(FileWriter&& file) noexcept {
+    if (this != &file) {
+        Close();
+        Path::operator=(std::move(file));
+        _buffer = std::move(file._buffer);
+        _pending = file._pending;
+        _size = file._size;
+        _fd = file._fd;
+        file._pending = 0;
+        file._size = 0;
+        file._fd = -1;
+    }
+    return *this;
+}
+
+bool FileWriter::Open(bool truncate) {
+    Close();
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND;
+    if (truncate) flags |= O_TRUNC;
+    _fd = ::open(_path.c_str(), flags, 0644);
+    if (_fd < 0) return false;
+
+    struct stat status;
+    if (::fstat(_fd, &status) != 0) {
+        Close();
+        return false;
+    }
+
+    if (_buffer.empty()) _buffer.resize(DEFAULT_BUFFER);
+    _pending = 0;
+    _size = status.st_size;
+    return true;
+}
+
+void FileWriter::Close() {
+    if (_fd >= 0) {
+        Sync();
+        ::close(_fd);
+    }
+    _pending = 0;
+    _size = 0;
+    _fd = -1;
+}
+
+bool FileWriter::Write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    _size += size;
+    while (size > 0) {
+        if (_pending == _buffer.size() && !Flush()) return false;
+
+        // records larger than the buffer skip it
+        if (_pending == 0 && size >= _buffer.size()) {
+            const ssize_t written = ::write(_fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            bytes += written;
+            size -= written;
+            continue;
+        }
+
+        const size_t chunk = std::min(size, _buffer.size() - _pending);
+        std::memcpy(_buffer.data() + _pending, bytes, chunk);
+        _pending += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool FileWriter::Flush() {
+    size_t offset = 0;
+    while (offset < _pending) {
+        const ssize_t written =
+            ::write(_fd, _buffer.data() + offset, _pending - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            // keep the bytes not written for a later attempt
+            std::memmove(_buffer.data(), _buffer.data() + offset,
+                         _pending - offset);
+            _pending -= offset;
+            return false;
+        }
+        offset += written;
+    }
+    _pending = 0;
+    return true;
+}
+
+bool FileWriter::Sync() {
+    if (!Flush()) return false;
+#if defined(__linux__)
+    return ::fdatasync(_fd) == 0;
+#else
+    return ::fsync(_fd) == 0;
+#endif
+}
+
+#if defined(FILESYSTEM_IO_URING)
+
+// io_uring through raw syscalls, reads only
+// The submission queue holds as many entries as there are slots, so a
+// slot always finds a free entry: it has at most one read in flight.
+struct AsyncReader::Uring {
+    int fd = -1;
+    void* sq_ring = MAP_FAILED;
+    size_t sq_size = 0;
+    void* cq_ring = MAP_FAILED;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // vector of the read in flight of every slot
+    std::vector<iovec> vectors;
+
+    ~Uring() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+        if (cq_ring != MAP_FAILED) ::munmap(cq_ring, cq_size);
+        if (sq_ring != MAP_FAILED) ::munmap(sq_ring, sq_size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool Setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ring = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cq_ring = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes = static_cast<io_uring_sqe*>(
+            ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED ||
+            sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        vectors.resize(entries);
+        return true;
+    }
+
+    int Enter(unsigned submit, unsigned wait) {
+        for (;;) {
+            const long result =
+                ::syscall(__NR_io_uring_enter, fd, submit, wait,
+                          wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (result < 0 && errno == EINTR) continue;
+            return static_cast<int>(result);
+        }
+    }
+
+    // queue and submit the read of a slot
+    bool Read(unsigned slot, int file, void* data, size_t size,
+              uint64_t offset) {
+        vectors[slot] = iovec{data, size};
+
+        const unsigned tail = *sq_tail;
+        const unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(&vectors[slot]);
+        sqe.len = 1;
+        sqe.user_data = slot;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        return Enter(1, 0) == 1;
+    }
+
+    // take a completion, if any
+    bool Pop(unsigned& slot, int& result) {
+        const unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+        slot = static_cast<unsigned>(cqe.user_data);
+        result = cqe.res;
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+
+#else
+
+struct AsyncReader::Uring {
+    bool Setup(unsigned) { return false; }
+    bool Read(unsigned, int, void*, size_t, uint64_t) { return false; }
+    bool Pop(unsigned&, int&) { return false; }
+    int Enter(unsigned, unsigned) { return -1; }
+};
+
+#endif
+
+AsyncReader::AsyncReader(const Path& path, size_t block_size, size_t depth)
+    : Path(path),
+      _block_size((std::max<size_t>(block_size, 1) + ALIGNMENT - 1) /
+                  ALIGNMENT * ALIGNMENT),
+      _depth(std::max<size_t>(depth, 1)) {}
+
+bool AsyncReader::Open(bool direct, bool uring) {
+    Close();
+
+#if defined(O_DIRECT)
+    // O_DIRECT is refused by some file systems, e.g. tmpfs
+    if (direct) _fd = ::open(_path.c_str(), O_RDONLY | O_DIRECT);
+#endif
+    if (_fd < 0) _fd = ::open(_path.c_str(), O_RDONLY);
+    if (_fd < 0) return false;
+
+    struct stat status;
+    if (::fstat(_fd, &status) != 0) {
+        Close();
+        return false;
+    }
+    _size = status.st_size;
+    _blocks = (_size + _block_size - 1) / _block_size;
+    ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    void* buffers = nullptr;
+    if (::posix_memalign(&buffers, ALIGNMENT, _block_size * _depth) != 0) {
+        Close();
+        return false;
+    }
+    _buffers = static_cast<char*>(buffers);
+    _slots.assign(_depth, Slot());
+    for (size_t i = 0; i < _depth; ++i) {
+        _slots[i].data = _buffers + i * _block_size;
+        _slots[i].block = i;
+    }
+    _next = _released = 0;
+    _error = _stop = false;
+
+    if (uring) {
+        _uring = new Uring();
+        if (_uring->Setup(static_cast<unsigned>(_depth))) {
+            _backend = Backend::io_uring;
+        } else {
+            delete _uring;
+            _uring = nullptr;
+        }
+    }
+
+    if (_backend == Backend::io_uring) {
+        for (size_t i = 0; i < _depth && i < _blocks; ++i) {
+            if (!Submit(i)) {
+                _error = true;
+                break;
+            }
+        }
+    } else {
+        _backend = Backend::thread;
+        _thread = std::thread([this] { Run(); });
+    }
+    return true;
+}
+
+void AsyncReader::Close() {
+    if (_uring != nullptr) {
+        // the kernel writes into the buffers until the reads complete
+        unsigned slot;
+        int result;
+        while (_inflight > 0) {
+            if (_uring->Pop(slot, result)) {
+                --_inflight;
+            } else if (_uring->Enter(0, 1) < 0) {
+                break;
+            }
+        }
+        delete _uring;
+        _uring = nullptr;
+    }
+    if (_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _free_ready.notify_one();
+        _thread.join();
+    }
+
+    std::free(_buffers);
+    _buffers = nullptr;
+    _slots.clear();
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _size = _blocks = 0;
+    _inflight = 0;
+    _backend = Backend::none;
+}
+
+bool AsyncReader::Next(const void*& data, size_t& size) {
+    if (_fd < 0) return false;
+
+    // the block handed over last is done with, its slot reads the block
+    // depth blocks later
+    if (_released < _next) {
+        const size_t index = _released % _depth;
+        Slot& slot = _slots[index];
+        if (_backend == Backend::io_uring) {
+            slot.block = _released + _depth;
+            slot.filled = 0;
+            slot.ready = false;
+            ++_released;
+            if (slot.block < _blocks && !Submit(index)) _error = true;
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                slot.ready = false;
+                ++_released;
+            }
+            _free_ready.notify_one();
+        }
+    }
+
+    if (_next >= _blocks) return false;
+
+    Slot& slot = _slots[_next % _depth];
+    if (_backend == Backend::io_uring) {
+        if (_error || !Complete(_next % _depth)) {
+            _error = true;
+            return false;
+        }
+    } else {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _read_ready.wait(lock, [&] { return slot.ready || _error; });
+        if (!slot.ready) return false;
+    }
+
+    data = slot.data;
+    size = slot.filled;
+    ++_next;
+    return true;
+}
+
+bool AsyncReader::failed() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _error;
+}
+
+size_t AsyncReader::BlockSize(uint64_t block) const {
+    return static_cast<size_t>(
+        std::min<uint64_t>(_block_size, _size - block * _block_size));
+}
+
+bool AsyncReader::Submit(size_t slot) {
+    Slot& read = _slots[slot];
+    // the whole buffer is asked for, O_DIRECT reads whole aligned blocks
+    if (!_uring->Read(static_cast<unsigned>(slot), _fd,
+                      read.data + read.filled, _block_size - read.filled,
+                      read.block * _block_size + read.filled)) {
+        return false;
+    }
+    ++_inflight;
+    return true;
+}
+
+bool AsyncReader::Complete(size_t slot) {
+    while (!_slots[slot].ready) {
+        unsigned index;
+        int result;
+        if (!_uring->Pop(index, result)) {
+            if (_inflight == 0 || _uring->Enter(0, 1) < 0) return false;
+            continue;
+        }
+        --_inflight;
+
+        Slot& read = _slots[index];
+        if (result == -EINTR || result == -EAGAIN) {
+            if (!Submit(index)) return false;
+            continue;
+        }
+        // an error, or the file ended before the block
+        if (result <= 0) return false;
+
+        read.filled += result;
+        if (read.filled >= BlockSize(read.block)) {
+            read.filled = BlockSize(read.block);
+            read.ready = true;
+        } else if (!Submit(index)) {
+            // short read, the rest of the block is read again
+            return false;
+        }
+    }
+    return true;
+}
+
+void AsyncReader::Run() {
+    for (uint64_t block = 0; block < _blocks; ++block) {
+        Slot& slot = _slots[block % _depth];
+        {
+            // the slot is free once the consumer released the block read
+            // depth blocks before
+            std::unique_lock<std::mutex> lock(_mutex);
+            _free_ready.wait(lock, [&] {
+                return block < _released + _depth || _stop;
+            });
+            if (_stop) return;
+        }
+
+        const size_t size = BlockSize(block);
+        size_t filled = 0;
+        while (filled < size) {
+            const ssize_t got =
+                ::pread(_fd, slot.data + filled, _block_size - filled,
+                        block * _block_size + filled);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) break;
+            filled += got;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (filled < size) {
+                _error = true;
+            } else {
+                slot.block = block;
+                slot.filled = size;
+                slot.ready = true;
+            }
+        }
+        _read_ready.notify_one();
+        if (filled < size) return;
+    }
+}
+
+}  // namespace FileSystem
@@ -1,10 +1,14 @@
 #ifndef FILESYSTEM_HPP
 #define FILESYSTEM_HPP
 
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 namespace FileSystem {
@@ -42,6 +46,9 @@ class Path {
     Path& operator=(const Path&) = default;
     Path& operator=(Path&&) = default;
 
+    // Get the path string
+    const std::string& string() const noexcept { return _path; }
+
     // Check if the path is not empty
     // explicit operator bool() const noexcept { return !empty(); }
 };
@@ -65,6 +72,191 @@ class File : public Path {
     File& operator=(const File&& file) noexcept;
 };
 
+// Reader
+// It hands a stream over as consecutive blocks, so that a consumer (e.g.
+// ITCHHandler::Process) reads them in place. A block stays valid until
+// the next call.
+class Reader {
+   public:
+    virtual ~Reader() = default;
+
+    // Get the next block of the stream
+    // Returns false at the end of the stream or once reading failed
+    virtual bool Next(const void*& data, size_t& size) = 0;
+    // Check if reading failed before the end of the stream
+    virtual bool failed() const = 0;
+};
+
+// MappedFile
+// It maps a whole file read-only into memory, so that the content can be
+// handed to a consumer (e.g. ITCHHandler::Process) in place, without any
+// copy or read syscall. Page faults are the only per-byte cost.
+// Not thread-safe
+class MappedFile : public Path {
+   protected:
+    const void* _data = nullptr;
+    size_t _size = 0;
+    int _fd = -1;
+
+   public:
+    MappedFile() = default;
+    MappedFile(const Path& path) : Path(path){};
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& file) noexcept;
+    ~MappedFile() { Close(); }
+
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& file) noexcept;
+
+    // Map the file
+    //  - populate, fault every page in up front (MAP_POPULATE)
+    //  - sequential, hint the kernel to read ahead aggressively
+    // Returns false if the file cannot be opened or mapped
+    bool Open(bool populate = false, bool sequential = true);
+    // Unmap the file
+    void Close();
+
+    bool IsOpen() const noexcept { return _data != nullptr; }
+    const void* data() const noexcept { return _data; }
+    size_t size() const noexcept { return _size; }
+};
+
+// AsyncReader
+// It reads a file as consecutive blocks with up to depth reads in flight,
+// so that the disk fills the next blocks while the consumer processes the
+// current one. Blocks are read into aligned buffers and handed over in
+// file order, a buffer is read again once the consumer moves on.
+// Reads are queued to io_uring when the kernel provides it, otherwise a
+// background thread reads the blocks ahead with pread.
+// Not thread-safe: Open, Next and Close are called from one thread
+class AsyncReader : public Path, public Reader {
+   public:
+    enum class Backend : uint8_t { none, io_uring, thread };
+
+    static const size_t DEFAULT_BLOCK = 1 << 20;
+    static const size_t DEFAULT_DEPTH = 4;
+    // buffer and block alignment, as O_DIRECT requires
+    static const size_t ALIGNMENT = 4096;
+
+    AsyncReader() = default;
+    // block_size is rounded up to ALIGNMENT
+    AsyncReader(const Path& path, size_t block_size = DEFAULT_BLOCK,
+                size_t depth = DEFAULT_DEPTH);
+    AsyncReader(const AsyncReader&) = delete;
+    ~AsyncReader() { Close(); }
+
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Open the file and start reading the first blocks
+    //  - direct, bypass the page cache (O_DIRECT) where supported
+    //  - uring, queue the reads to io_uring if available
+    // Returns false if the file cannot be opened
+    bool Open(bool direct = false, bool uring = true);
+    // Wait for the reads in flight and close the file
+    void Close();
+
+    bool Next(const void*& data, size_t& size) override;
+    bool failed() const override;
+
+    bool IsOpen() const noexcept { return _fd >= 0; }
+    Backend backend() const noexcept { return _backend; }
+    size_t block_size() const noexcept { return _block_size; }
+    size_t depth() const noexcept { return _depth; }
+    // size of the file
+    uint64_t size() const noexcept { return _size; }
+
+   protected:
+    struct Uring;
+
+    struct Slot {
+        char* data = nullptr;
+        // block read into the buffer and bytes of it read so far
+        uint64_t block = 0;
+        size_t filled = 0;
+        bool ready = false;
+    };
+
+    size_t _block_size = DEFAULT_BLOCK;
+    size_t _depth = DEFAULT_DEPTH;
+    Backend _backend = Backend::none;
+    int _fd = -1;
+    uint64_t _size = 0;
+    uint64_t _blocks = 0;
+
+    std::vector<Slot> _slots;
+    char* _buffers = nullptr;
+    // next block handed to the consumer, blocks released by it
+    uint64_t _next = 0;
+    uint64_t _released = 0;
+    bool _error = false;
+
+    // io_uring backend, reads in flight
+    Uring* _uring = nullptr;
+    size_t _inflight = 0;
+
+    // thread backend, _slots ready flags and the counters are shared
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _read_ready;
+    std::condition_variable _free_ready;
+    bool _stop = false;
+
+    // bytes of a block in the file
+    size_t BlockSize(uint64_t block) const;
+    // queue the read of the rest of a slot's block to io_uring
+    bool Submit(size_t slot);
+    // wait for a slot's block to be read through io_uring
+    bool Complete(size_t slot);
+    // body of the reading thread
+    void Run();
+};
+
+// FileWriter
+// It appends to a file through a user-space buffer, so that small records
+// cost a copy and the write syscall is paid once per buffer. Sync() makes
+// everything written so far durable (fdatasync).
+// Not thread-safe
+class FileWriter : public Path {
+   public:
+    static const size_t DEFAULT_BUFFER = 1 << 16;
+
+   protected:
+    std::vector<char> _buffer;
+    size_t _pending = 0;
+    size_t _size = 0;
+    int _fd = -1;
+
+   public:
+    FileWriter() = default;
+    FileWriter(const Path& path, size_t buffer = DEFAULT_BUFFER)
+        : Path(path), _buffer(buffer){};
+    FileWriter(const FileWriter&) = delete;
+    FileWriter(FileWriter&& file) noexcept;
+    ~FileWriter() { Close(); }
+
+    FileWriter& operator=(const FileWriter&) = delete;
+    FileWriter& operator=(FileWriter&& file) noexcept;
+
+    // Open the file for writing, creating it if needed
+    //  - truncate, drop the previous content rather than append to it
+    // Returns false if the file cannot be opened
+    bool Open(bool truncate = false);
+    // Flush, sync and close the file
+    void Close();
+
+    // Buffer size bytes, the buffer is written out once full
+    // Returns false if a write to the file failed
+    bool Write(const void* data, size_t size);
+    // Write the buffered bytes to the file
+    bool Flush();
+    // Flush, then wait until the file content reaches the disk
+    bool Sync();
+
+    bool IsOpen() const noexcept { return _fd >= 0; }
+    // size of the file including the buffered bytes
+    size_t size() const noexcept { return _size; }
+};
+
 }  // namespace FileSystem
 
 #endif
@@ -0,0 +1,150 @@
+/*
+ * FrameIndexer scans a block of length-prefixed ITCH messages ahead of
+ * the handlers and emits one (offset, length, type) descriptor per
+ * complete frame, so later stages can group messages by type, prefetch,
+ * or partition a block across threads without walking it again.
+ *
+ * Frame boundaries form a serial chain (every offset depends on the
+ * previous length), so the scan itself stays scalar: a single unaligned
+ * 32-bit load and byte swap yields both the length prefix and the type
+ * of a frame. Validating lengths against the expected length of each type
+ * is independent per frame and runs 8 descriptors at a time on AVX2,
+ * with a scalar fallback.
+ *
+ * Not thread-safe
+ */
+
+#ifndef FRAMES_HPP
+#define FRAMES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "messages.hpp"
+#include "utils.hpp"
+
+struct Frame {
+    // offset of the message from the block start, length prefix excluded
+    uint32_t offset;
+    uint16_t length;
+    uint8_t type;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(Frame) == 8, "Frame descriptors are packed by 8 bytes");
+
+class FrameIndexer {
+   public:
+    // largest block indexed at once, offsets are 32 bits
+    static const std::size_t max_block = std::numeric_limits<uint32_t>::max();
+
+    FrameIndexer() = default;
+    FrameIndexer(const FrameIndexer& indexer) = delete;
+
+    /*
+     * @brief index the complete frames of a block, replacing the previous
+     * descriptors. Frames of length 0 carry no message and are skipped.
+     *
+     * @return the number of bytes consumed, i.e. the offset of the frame
+     * left incomplete at the end of the block
+     */
+    inline std::size_t Index(const void* buffer, std::size_t size) {
+        const uint8_t* data = static_cast<const uint8_t*>(buffer);
+        if (size > max_block) size = max_block;
+
+        _frames.clear();
+        // ITCH frames average more than 24 bytes
+        _frames.reserve(size / 24 + 1);
+
+        std::size_t offset = 0;
+        while (size - offset >= 4) {
+            // length prefix in the 2 high bytes, type in the third one
+            const uint32_t header = Utils::LoadBigEndian32(data + offset);
+            const std::size_t length = header >> 16;
+            if (offset + 2 + length > size) return offset;
+
+            if (length != 0) {
+                _frames.push_back({static_cast<uint32_t>(offset + 2),
+                                   static_cast<uint16_t>(length),
+                                   static_cast<uint8_t>(header >> 8), 0});
+            }
+            offset += 2 + length;
+        }
+
+        // frames shorter than the 4 bytes load at the end of the block
+        while (size - offset >= 2) {
+            const std::size_t length = Utils::LoadBigEndian16(data + offset);
+            if (offset + 2 + length > size) break;
+
+            if (length != 0) {
+                _frames.push_back({static_cast<uint32_t>(offset + 2),
+                                   static_cast<uint16_t>(length),
+                                   data[offset + 2], 0});
+            }
+            offset += 2 + length;
+        }
+        return offset;
+    }
+
+    /*
+     * @return the number of frames whose length differs from the expected
+     * length of their type. Types unknown to the decoder are not counted.
+     */
+    inline std::size_t Validate() const {
+        const Frame* frames = _frames.data();
+        const std::size_t count = _frames.size();
+        const uint32_t* expected = MessageTypes::lengths.length;
+
+        std::size_t invalid = 0;
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i low16 = _mm256_set1_epi32(0xffff);
+        const __m256i low8 = _mm256_set1_epi32(0xff);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8) {
+            const __m256 first = _mm256_loadu_ps(
+                reinterpret_cast<const float*>(frames + i));
+            const __m256 second = _mm256_loadu_ps(
+                reinterpret_cast<const float*>(frames + i + 4));
+            // keep the odd 32-bit lanes, length | type << 16, of the
+            // 8 descriptors (their order does not matter here)
+            const __m256i meta = _mm256_castps_si256(
+                _mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+
+            const __m256i length = _mm256_and_si256(meta, low16);
+            const __m256i type =
+                _mm256_and_si256(_mm256_srli_epi32(meta, 16), low8);
+            const __m256i target = _mm256_i32gather_epi32(
+                reinterpret_cast<const int*>(expected), type, 4);
+
+            const __m256i unknown = _mm256_cmpeq_epi32(target, zero);
+            const __m256i match = _mm256_cmpeq_epi32(length, target);
+            const int valid = _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_or_si256(unknown, match)));
+            invalid += 8 - __builtin_popcount(valid);
+        }
+#endif
+        for (; i < count; ++i) {
+            const uint32_t target = expected[frames[i].type];
+            invalid += target != 0 && target != frames[i].length;
+        }
+        return invalid;
+    }
+
+    inline const Frame* data() const { return _frames.data(); }
+    inline std::size_t size() const { return _frames.size(); }
+    inline const Frame& operator[](const std::size_t i) const {
+        return _frames[i];
+    }
+
+   private:
+    std::vector<Frame> _frames;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// mid prices are kept away from 0 so that bids always fit below asks
+static const int64_t min_mid = 64;
+
+Generator::Generator(const GeneratorConfig &config)
+    : config(config),
+      state(config.seed),
+      popularity(config.symbols),
+      symbols(config.symbols + 1),
+      timestamp(config.start_time) {
+    double sum = 0;
+    for (std::size_t i = 0; i < config.symbols; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), config.zipf);
+        popularity[i] = sum;
+    }
+    for (double &weight : popularity) {
+        weight /= sum;
+    }
+
+    const double ratios[5] = {config.add_ratio, config.cancel_ratio,
+                              config.delete_ratio, config.execute_ratio,
+                              config.replace_ratio};
+    double total = 0;
+    for (std::size_t i = 0; i < 5; ++i) {
+        total += ratios[i];
+        thresholds[i] = total;
+    }
+    for (double &threshold : thresholds) {
+        threshold /= total;
+    }
+
+    const int64_t mid = std::max<int64_t>(config.start_price / config.tick,
+                                          min_mid);
+    for (std::size_t locate = 1; locate < symbols.size(); ++locate) {
+        symbols[locate].name = symbol_name(locate);
+        symbols[locate].mid = mid;
+    }
+}
+
+std::string Generator::symbol_name(std::size_t locate) {
+    std::string name;
+    while (locate != 0) {
+        --locate;
+        name.insert(name.begin(), static_cast<char>('A' + locate % 26));
+        locate /= 26;
+    }
+    return name;
+}
+
+void Generator::start(std::vector<uint8_t> &out) {
+    MessageTypes::Encoder encoder(out);
+    encoder.SystemEvent(next_header(0), 'O');
+    for (std::size_t locate = 1; locate < symbols.size(); ++locate) {
+        encoder.StockDirectory(next_header(static_cast<uint16_t>(locate)),
+                               symbols[locate].name, 'Q', 'N', config.lot,
+                               'N', 'C', "Z", 'P', 'N', 'N', '1', 'N', 0,
+                               'N');
+    }
+}
+
+void Generator::finish(std::vector<uint8_t> &out) {
+    MessageTypes::Encoder encoder(out);
+    encoder.SystemEvent(next_header(0), 'C');
+}
+
+void Generator::generate(const std::size_t count, std::vector<uint8_t> &out) {
+    MessageTypes::Encoder encoder(out);
+    const int64_t max_mid = (UINT32_MAX / config.tick) / 2;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint16_t locate = static_cast<uint16_t>(pick_symbol());
+        Symbol &symbol = symbols[locate];
+
+        if (uniform() < config.walk) {
+            symbol.mid += below(2) != 0 ? 1 : -1;
+            symbol.mid = std::min(std::max(symbol.mid, min_mid), max_mid);
+        }
+
+        switch (pick_action(symbol)) {
+            case add:
+                emit_add(encoder, locate);
+                break;
+            case cancel:
+                emit_cancel(encoder, locate);
+                break;
+            case remove:
+                emit_delete(encoder, locate);
+                break;
+            case execute:
+                emit_execute(encoder, locate);
+                break;
+            case replace:
+                emit_replace(encoder, locate);
+                break;
+        }
+    }
+}
+
+MessageTypes::Header Generator::next_header(const uint16_t locate) {
+    ++count;
+    timestamp += 1 + below(2 * config.interval);
+
+    MessageTypes::Header header;
+    header.locate = locate;
+    header.timestamp = timestamp;
+    return header;
+}
+
+std::size_t Generator::pick_symbol() {
+    const auto found =
+        std::upper_bound(popularity.begin(), popularity.end(), uniform());
+    const std::size_t index = std::min<std::size_t>(
+        found - popularity.begin(), popularity.size() - 1);
+    return index + 1;
+}
+
+Generator::Action Generator::pick_action(const Symbol &symbol) {
+    if (symbol.resting.empty()) return add;
+
+    const double value = uniform();
+    std::size_t action = 0;
+    while (action < 4 && value >= thresholds[action]) {
+        ++action;
+    }
+    if (action == add && symbol.resting.size() >= config.depth) {
+        return remove;
+    }
+    return static_cast<Action>(action);
+}
+
+uint32_t Generator::pick_shares() {
+    // mostly round lots, a few large orders
+    const uint64_t lots = below(8) != 0 ? 1 + below(5) : 1 + below(50);
+    return static_cast<uint32_t>(lots * config.lot);
+}
+
+uint32_t Generator::pick_price(const Symbol &symbol, const char side) {
+    // geometric number of ticks with the configured mean
+    const double p = 1.0 / (1.0 + config.levels);
+    const int64_t distance = static_cast<int64_t>(
+        std::floor(std::log1p(-uniform()) / std::log1p(-p)));
+
+    int64_t ticks;
+    if (side == 'B') {
+        ticks = std::max<int64_t>(symbol.mid - distance, 1);
+        if (!symbol.asks.empty()) {
+            const int64_t ask = symbol.asks.begin()->first / config.tick;
+            ticks = std::min(ticks, ask - 1);
+        }
+    } else {
+        ticks = symbol.mid + 1 + distance;
+        if (!symbol.bids.empty()) {
+            const int64_t bid = symbol.bids.rbegin()->first / config.tick;
+            ticks = std::max(ticks, bid + 1);
+        }
+        ticks = std::min<int64_t>(ticks, UINT32_MAX / config.tick);
+    }
+    return static_cast<uint32_t>(ticks * config.tick);
+}
+
+void Generator::insert(const uint16_t locate, const Resting &order) {
+    Symbol &symbol = symbols[locate];
+    Levels &levels = order.side == 'B' ? symbol.bids : symbol.asks;
+    levels[order.price].push_back(order.reference);
+
+    slots[order.reference] = {locate,
+                              static_cast<uint32_t>(symbol.resting.size())};
+    symbol.resting.push_back(order);
+}
+
+void Generator::erase(const uint16_t locate, const std::size_t position) {
+    Symbol &symbol = symbols[locate];
+    const Resting order = symbol.resting[position];
+
+    Levels &levels = order.side == 'B' ? symbol.bids : symbol.asks;
+    auto level = levels.find(order.price);
+    auto &queue = level->second;
+    queue.erase(std::find(queue.begin(), queue.end(), order.reference));
+    if (queue.empty()) levels.erase(level);
+
+    slots.erase(order.reference);
+    if (position + 1 != symbol.resting.size()) {
+        symbol.resting[position] = symbol.resting.back();
+        slots[symbol.resting[position].reference].second =
+            static_cast<uint32_t>(position);
+    }
+    symbol.resting.pop_back();
+}
+
+void Generator::emit_add(MessageTypes::Encoder &encoder,
+                         const uint16_t locate) {
+    Symbol &symbol = symbols[locate];
+    Resting order;
+    order.reference = next_reference++;
+    order.side = below(2) != 0 ? 'S' : 'B';
+    order.price = pick_price(symbol, order.side);
+    order.shares = pick_shares();
+
+    const MessageTypes::Header header = next_header(locate);
+    if (uniform() < config.attribution_ratio) {
+        encoder.AddOrderMPIDAttribution(header, order.reference, order.side,
+                                        order.shares, symbol.name,
+                                        order.price, "GNRT");
+    } else {
+        encoder.AddOrder(header, order.reference, order.side, order.shares,
+                         symbol.name, order.price);
+    }
+    insert(locate, order);
+}
+
+void Generator::emit_cancel(MessageTypes::Encoder &encoder,
+                            const uint16_t locate) {
+    Symbol &symbol = symbols[locate];
+    const std::size_t position = below(symbol.resting.size());
+    Resting &order = symbol.resting[position];
+
+    // a single lot left is deleted instead
+    const uint32_t lots = order.shares / config.lot;
+    if (lots < 2) {
+        encoder.OrderDelete(next_header(locate), order.reference);
+        erase(locate, position);
+        return;
+    }
+
+    const uint32_t canceled =
+        static_cast<uint32_t>(1 + below(lots - 1)) * config.lot;
+    encoder.OrderCancel(next_header(locate), order.reference, canceled);
+    order.shares -= canceled;
+}
+
+void Generator::emit_delete(MessageTypes::Encoder &encoder,
+                            const uint16_t locate) {
+    Symbol &symbol = symbols[locate];
+    const std::size_t position = below(symbol.resting.size());
+    encoder.OrderDelete(next_header(locate),
+                        symbol.resting[position].reference);
+    erase(locate, position);
+}
+
+void Generator::emit_execute(MessageTypes::Encoder &encoder,
+                             const uint16_t locate) {
+    Symbol &symbol = symbols[locate];
+    bool bid = below(2) != 0;
+    if (bid && symbol.bids.empty()) bid = false;
+    if (!bid && symbol.asks.empty()) bid = true;
+
+    // front of the best level
+    const uint64_t reference = bid ? symbol.bids.rbegin()->second.front()
+                                   : symbol.asks.begin()->second.front();
+    const std::size_t position = slots[reference].second;
+    Resting &order = symbol.resting[position];
+
+    const uint32_t executed = std::min<uint32_t>(
+        order.shares, static_cast<uint32_t>(1 + below(4)) * config.lot);
+    encoder.OrderExecuted(next_header(locate), reference, executed,
+                          next_match++);
+    if (executed == order.shares) {
+        erase(locate, position);
+    } else {
+        order.shares -= executed;
+    }
+}
+
+void Generator::emit_replace(MessageTypes::Encoder &encoder,
+                             const uint16_t locate) {
+    Symbol &symbol = symbols[locate];
+    const std::size_t position = below(symbol.resting.size());
+    Resting order = symbol.resting[position];
+    const uint64_t reference = order.reference;
+    erase(locate, position);
+
+    order.reference = next_reference++;
+    order.price = pick_price(symbol, order.side);
+    order.shares = pick_shares();
+    encoder.OrderReplace(next_header(locate), reference, order.reference,
+                         order.shares, order.price);
+    insert(locate, order);
+}
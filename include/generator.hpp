@@ -0,0 +1,173 @@
+/*
+ * Generator writes a synthetic NASDAQ ITCH 5.0 order flow, for load
+ * testing without capture files.
+ *
+ * The stream opens with a start of messages System Event and one Stock
+ * Directory message per symbol, StockLocate codes 1 to symbols, followed
+ * by add ('A', 'F'), execute ('E'), cancel ('X'), delete ('D') and
+ * replace ('U') messages, and closes with an end of messages event:
+ *  - symbols are drawn from a Zipf distribution, the first ones busiest
+ *  - message types are drawn from the configured ratios, adds turning
+ *    into deletes once a symbol has depth resting orders and every other
+ *    type into an add while it has none
+ *  - every symbol has a mid price following a random walk, new orders
+ *    rest a geometric number of ticks away from it and never cross the
+ *    opposite side, so replaying the stream executes nothing implicitly
+ *  - executions take the order at the front of the best level, every
+ *    message refers to a resting order with enough shares
+ *
+ * The output only depends on the configuration, seed included: random
+ * numbers come from a splitmix64 sequence rather than the standard
+ * library distributions, which differ between implementations.
+ *
+ * Memory is proportional to the resting orders, not to the number of
+ * messages, so streams of any size are generated in chunks.
+ */
+
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "encoder.hpp"
+
+struct GeneratorConfig {
+    uint64_t seed = 1;
+    // StockLocate codes 1 to symbols, at most 65535
+    std::size_t symbols = 100;
+    // Zipf exponent of the symbol popularity, 0 for uniform
+    double zipf = 1.0;
+
+    // relative frequencies of the order messages
+    double add_ratio = 0.45;
+    double cancel_ratio = 0.10;
+    double delete_ratio = 0.30;
+    double execute_ratio = 0.10;
+    double replace_ratio = 0.05;
+    // fraction of the adds sent as 'F' with an attribution
+    double attribution_ratio = 0.05;
+
+    // most resting orders per symbol
+    std::size_t depth = 200;
+    // mean distance of new orders from the mid price, in ticks
+    double levels = 4.0;
+    // probability of the mid price moving one tick per message
+    double walk = 0.05;
+
+    // prices with 4 implied decimals
+    uint32_t tick = 100;
+    uint32_t start_price = 1000000;
+    uint32_t lot = 100;
+
+    // nanoseconds since midnight, 9:30 by default
+    uint64_t start_time = 34200ull * 1000000000ull;
+    // mean interval between messages in nanoseconds
+    uint64_t interval = 1000;
+};
+
+class Generator {
+   public:
+    explicit Generator(const GeneratorConfig &config);
+    Generator(const Generator &generator) = delete;
+    Generator &operator=(const Generator &generator) = delete;
+
+    // append the start of messages event and the stock directory
+    void start(std::vector<uint8_t> &out);
+
+    // append count order messages
+    void generate(const std::size_t count, std::vector<uint8_t> &out);
+
+    // append the end of messages event
+    void finish(std::vector<uint8_t> &out);
+
+    // messages appended so far
+    inline std::size_t messages() const { return count; }
+
+    // resting orders over every symbol
+    inline std::size_t order_count() const { return slots.size(); }
+
+    /*
+     * @brief name of the symbol of a StockLocate code, upper case letters
+     * counting in base 26 from "A"
+     */
+    static std::string symbol_name(const std::size_t locate);
+
+   private:
+    struct Resting {
+        uint64_t reference;
+        uint32_t price;
+        uint32_t shares;
+        char side;
+    };
+
+    using Levels = std::map<uint32_t, std::vector<uint64_t>>;
+
+    struct Symbol {
+        std::string name;
+        // mid price in ticks
+        int64_t mid;
+        Levels bids;
+        Levels asks;
+        // resting orders in no particular order, to pick one at random
+        std::vector<Resting> resting;
+    };
+
+    enum Action : uint8_t { add, cancel, remove, execute, replace };
+
+    const GeneratorConfig config;
+    uint64_t state;
+
+    // cumulative Zipf weights of the symbols, normalized
+    std::vector<double> popularity;
+    // cumulative message ratios, normalized
+    double thresholds[5];
+
+    std::vector<Symbol> symbols;
+    // StockLocate code and position in Symbol::resting of every order
+    std::unordered_map<uint64_t, std::pair<uint16_t, uint32_t>> slots;
+
+    uint64_t timestamp;
+    uint64_t next_reference = 1;
+    uint64_t next_match = 1;
+    std::size_t count = 0;
+
+    // splitmix64
+    inline uint64_t draw() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    // uniform in [0, 1)
+    inline double uniform() { return (draw() >> 11) * 0x1.0p-53; }
+    // uniform in [0, n)
+    inline uint64_t below(const uint64_t n) {
+        return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(draw()) * n) >> 64);
+    }
+
+    MessageTypes::Header next_header(const uint16_t locate);
+    std::size_t pick_symbol();
+    Action pick_action(const Symbol &symbol);
+    uint32_t pick_shares();
+    // price of a new order, not crossing the opposite side
+    uint32_t pick_price(const Symbol &symbol, const char side);
+
+    void insert(const uint16_t locate, const Resting &order);
+    // remove the order at a position of Symbol::resting
+    void erase(const uint16_t locate, const std::size_t position);
+
+    void emit_add(MessageTypes::Encoder &encoder, const uint16_t locate);
+    void emit_cancel(MessageTypes::Encoder &encoder, const uint16_t locate);
+    void emit_delete(MessageTypes::Encoder &encoder, const uint16_t locate);
+    void emit_execute(MessageTypes::Encoder &encoder, const uint16_t locate);
+    void emit_replace(MessageTypes::Encoder &encoder, const uint16_t locate);
+};
+
+#endif
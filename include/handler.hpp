@@ -5,119 +5,318 @@
  * Protocol examples can be found in:
  * https://emi.nasdaq.com/ITCH/Nasdaq%20ITCH/
  *
+ * ITCHHandlerT<Derived> dispatches statically (CRTP): every message type
+ * is decoded into a view (see messages.hpp) and passed to the
+ * Derived::onMessage overload accepting it, so the consumer code is
+ * inlined into the parse loop. A message type no overload accepts is
+ * skipped at compile time. Overloads may be private or protected if the
+ * consumer befriends ITCHHandlerT<Derived>.
+ *
+ * ITCHHandler is the dynamic adapter, with one virtual onMessage per
+ * message type.
+ *
  * Not thread-safe
  */
 
+#ifndef HANDLER_HPP
+#define HANDLER_HPP
+
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-namespace MessageTypes {
-struct SystemEventMessage {
-    char Type;
-    uint16_t StockLocate;
-    uint16_t TrackingNumber;
-    uint64_t Timestamp;
-    char EventCode;
-};
+#include "frames.hpp"
+#include "messages.hpp"
+#include "utils.hpp"
 
-struct StockDirectoryMessage {
-    char Type;
-    uint16_t StockLocate;
-    uint16_t TrackingNumber;
-    uint64_t Timestamp;
-    char Stock[8];
-    char MarketCategory;
-    char FinancialStatusIndicator;
-};
+template <class Derived>
+class ITCHHandlerT {
+   public:
+    ITCHHandlerT() { ResetHandler(); }
+    ITCHHandlerT(const ITCHHandlerT& ithandler) = delete;
+
+    bool Process(const void* buffer, std::size_t size);
+    bool ProcessMessage(const void* buffer, std::size_t size);
+    // process the frames of a block indexed by a FrameIndexer, the block
+    // must not start in the middle of a frame given to Process
+    bool ProcessFrames(const void* buffer, const Frame* frames,
+                       std::size_t count);
+    void ResetHandler();
+
+    // number of messages processed and of messages failing to process
+    std::size_t messages() const { return _messages; }
+    std::size_t errors() const { return _errors; }
 
-struct StockTradingActionMessage {
-    char Type;
-    uint16_t StockLocate;
-    uint16_t TrackingNumber;
-    uint64_t Timestamp;
-    char Stock[8];
-    char TradingState;
-    char Reserved;
-    char Reason;
+   protected:
+    ~ITCHHandlerT() = default;
+
+   private:
+    // whether Derived has an onMessage overload accepting Message, the
+    // Handler parameter defers the check until Derived is complete
+    template <class Message, class Handler = Derived>
+    static auto Handles(int)
+        -> decltype(std::declval<Handler&>().onMessage(
+                        std::declval<const Message&>()),
+                    std::true_type());
+    template <class Message>
+    static std::false_type Handles(...);
+
+    template <class Message>
+    inline bool Decode(const uint8_t* data, const std::size_t size) {
+        if (size != Message::length) return false;
+        if constexpr (decltype(Handles<Message>(0))::value) {
+            return static_cast<Derived*>(this)->onMessage(Message(data));
+        } else {
+            return true;
+        }
+    }
+
+    std::vector<std::uint8_t> _cache;
+    size_t _size;
+    size_t _messages;
+    size_t _errors;
 };
 
-struct MarketParticipantPositionMessage {};
-struct AddOrderMesssage {};
-struct OrderExecutedMessage {};
-struct OrderExecutedWithPriceMessage {};
-struct OrderCancelMessage {};
-struct OrderDeleteMessage {};
+template <class Derived>
+void ITCHHandlerT<Derived>::ResetHandler() {
+    _size = 0;
+    _messages = 0;
+    _errors = 0;
+    _cache.clear();
+}
 
-}  // namespace MessageTypes
+template <class Derived>
+inline bool ITCHHandlerT<Derived>::ProcessMessage(const void* buffer,
+                                                  std::size_t size) {
+    // message empty
+    if (size == 0) return false;
+    const uint8_t* data = (const uint8_t*)buffer;
 
-class ITCHHandler {
-   public:
-    ITCHHandler() { ResetHandler(); }
-    ITCHHandler(const ITCHHandler& ithandler) = delete;
+    using namespace MessageTypes;
+    // dense switch over the type byte, compiled into a jump table
+    switch (*data) {
+        case SystemEventMessage::type:
+            return Decode<SystemEventMessage>(data, size);
+        case StockDirectoryMessage::type:
+            return Decode<StockDirectoryMessage>(data, size);
+        case StockTradingActionMessage::type:
+            return Decode<StockTradingActionMessage>(data, size);
+        case RegSHOMessage::type:
+            return Decode<RegSHOMessage>(data, size);
+        case MarketParticipantPositionMessage::type:
+            return Decode<MarketParticipantPositionMessage>(data, size);
+        case MWCBDeclineLevelMessage::type:
+            return Decode<MWCBDeclineLevelMessage>(data, size);
+        case MWCBStatusMessage::type:
+            return Decode<MWCBStatusMessage>(data, size);
+        case IPOQuotingPeriodUpdateMessage::type:
+            return Decode<IPOQuotingPeriodUpdateMessage>(data, size);
+        case LULDAuctionCollarMessage::type:
+            return Decode<LULDAuctionCollarMessage>(data, size);
+        case OperationalHaltMessage::type:
+            return Decode<OperationalHaltMessage>(data, size);
+        case AddOrderMesssage::type:
+            return Decode<AddOrderMesssage>(data, size);
+        case AddOrderMPIDAttributionMessage::type:
+            return Decode<AddOrderMPIDAttributionMessage>(data, size);
+        case OrderExecutedMessage::type:
+            return Decode<OrderExecutedMessage>(data, size);
+        case OrderExecutedWithPriceMessage::type:
+            return Decode<OrderExecutedWithPriceMessage>(data, size);
+        case OrderCancelMessage::type:
+            return Decode<OrderCancelMessage>(data, size);
+        case OrderDeleteMessage::type:
+            return Decode<OrderDeleteMessage>(data, size);
+        case OrderReplaceMessage::type:
+            return Decode<OrderReplaceMessage>(data, size);
+        case TradeMessage::type:
+            return Decode<TradeMessage>(data, size);
+        case CrossTradeMessage::type:
+            return Decode<CrossTradeMessage>(data, size);
+        case BrokenTradeMessage::type:
+            return Decode<BrokenTradeMessage>(data, size);
+        case NOIIMessage::type:
+            return Decode<NOIIMessage>(data, size);
+        case RPIIMessage::type:
+            return Decode<RPIIMessage>(data, size);
+        case DirectListingWithCapitalRaiseMessage::type:
+            return Decode<DirectListingWithCapitalRaiseMessage>(data, size);
+        default:
+            // messages not consumed by the handler are skipped
+            return true;
+    }
+}
+
+template <class Derived>
+bool ITCHHandlerT<Derived>::ProcessFrames(const void* buffer,
+                                          const Frame* frames,
+                                          std::size_t count) {
+    const uint8_t* data = (const uint8_t*)buffer;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!ProcessMessage(&data[frames[i].offset], frames[i].length)) {
+            ++_errors;
+        }
+    }
+    _messages += count;
+    return true;
+}
+
+template <class Derived>
+bool ITCHHandlerT<Derived>::Process(const void* buffer, std::size_t size) {
+    size_t index = 0;
+    const uint8_t* data = (const uint8_t*)buffer;
+
+    while (index < size) {
+        if (_size == 0) {
+            size_t remaining = size - index;
+            // collect message size into cache
+            if (((_cache.size() == 0) && remaining < 3) ||
+                (_cache.size() == 1)) {
+                _cache.push_back(data[index++]);
+                continue;
+            }
+
+            // read a new message size
+            uint16_t message_size;
+            if (_cache.empty()) {
+                // read message size directly from the input buffer
+                index += Utils::ReadMessage(&data[index], message_size);
+            } else {
+                // read message size from chache
+                Utils::ReadMessage(_cache.data(), message_size);
+                // clear cache
+                _cache.clear();
+            }
+
+            _size = message_size;
+        }
 
+        // read new message
+        if (_size > 0) {
+            size_t remaining = size - index;
+            // complete or place message into cache
+            if (!_cache.empty()) {
+                size_t tail = _size - _cache.size();
+                if (tail > remaining) tail = remaining;
+                _cache.insert(_cache.end(), &data[index], &data[index + tail]);
+                index += tail;
+
+                if (_cache.size() < _size) continue;
+            } else if (_size > remaining) {
+                _cache.reserve(_size);
+                _cache.insert(_cache.end(), &data[index],
+                              &data[index + remaining]);
+                index += remaining;
+                continue;
+            }
+
+            // process a complete message from the cache or in place
+            bool processed;
+            if (!_cache.empty()) {
+                processed = ProcessMessage(_cache.data(), _size);
+                _cache.clear();
+            } else {
+                processed = ProcessMessage(&data[index], _size);
+                index += _size;
+            }
+
+            ++_messages;
+            if (!processed) ++_errors;
+            _size = 0;
+        }
+    }
+
+    return true;
+}
+
+class ITCHHandler : public ITCHHandlerT<ITCHHandler> {
+   public:
+    ITCHHandler() = default;
     virtual ~ITCHHandler() = default;
-    bool Process(void* buffer, std::size_t size);
-    bool ProcessMessage(void* buffer, std::size_t size);
-    void ResetHandler();
 
    protected:
+    friend class ITCHHandlerT<ITCHHandler>;
+
     // message handlers
-    virtual bool onMessage(const MessageTypes::SystemEventMessage& message) {
+    virtual bool onMessage(const MessageTypes::SystemEventMessage&) {
         return true;
     }
-    virtual bool onMessage(const MessageTypes::StockDirectoryMessage& message) {
+    virtual bool onMessage(const MessageTypes::StockDirectoryMessage&) {
         return true;
     }
-    virtual bool onMessage(
-        const MessageTypes::StockTradingActionMessage& message) {
+    virtual bool onMessage(const MessageTypes::StockTradingActionMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::RegSHOMessage&) {
         return true;
     }
     virtual bool onMessage(
-        const MessageTypes::MarketParticipantPositionMessage& message) {
+        const MessageTypes::MarketParticipantPositionMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::MWCBDeclineLevelMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::MWCBStatusMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::IPOQuotingPeriodUpdateMessage&) {
         return true;
     }
-    virtual bool onMessage(const MessageTypes::AddOrderMesssage& message) {
+    virtual bool onMessage(const MessageTypes::LULDAuctionCollarMessage&) {
         return true;
     }
-    virtual bool onMessage(const MessageTypes::OrderExecutedMessage& message) {
+    virtual bool onMessage(const MessageTypes::OperationalHaltMessage&) {
         return true;
     }
+    virtual bool onMessage(const MessageTypes::AddOrderMesssage&) {
+        return true;
+    }
+    // without an override, 'F' is handled as a plain 'A'
     virtual bool onMessage(
-        const MessageTypes::OrderExecutedWithPriceMessage& message) {
+        const MessageTypes::AddOrderMPIDAttributionMessage& message) {
+        return onMessage(
+            static_cast<const MessageTypes::AddOrderMesssage&>(message));
+    }
+    virtual bool onMessage(const MessageTypes::OrderExecutedMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::OrderExecutedWithPriceMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::OrderCancelMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::OrderDeleteMessage&) {
         return true;
     }
-    virtual bool onMessage(const MessageTypes::OrderCancelMessage& message) {
+    virtual bool onMessage(const MessageTypes::OrderReplaceMessage&) {
         return true;
     }
-    virtual bool onMessage(const MessageTypes::OrderDeleteMessage& message) {
+    virtual bool onMessage(const MessageTypes::TradeMessage&) {
         return true;
     }
+    virtual bool onMessage(const MessageTypes::CrossTradeMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::BrokenTradeMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::NOIIMessage&) {
+        return true;
+    }
+    virtual bool onMessage(const MessageTypes::RPIIMessage&) {
+        return true;
+    }
+    virtual bool onMessage(
+        const MessageTypes::DirectListingWithCapitalRaiseMessage&) {
+        return true;
+    }
+};
 
-   private:
-    std::vector<std::uint8_t> _cache;
-    size_t _size;
-    size_t _messages;
-    size_t _errors;
+// the dynamic adapter is instantiated once, in handler.cpp
+extern template class ITCHHandlerT<ITCHHandler>;
 
-    using size_t = std::size_t;
-
-    bool ProcessSystemEventMessage(void* buffer, size_t size);
-    bool ProcessStockDirectoryMessage(void* buffer, size_t size);
-    bool ProcessStockTradingActionMessage(void* buffer, size_t size);
-    bool ProcessMarketParticipantPositionMessage(void* buffer, size_t size);
-    bool ProcessAddOrderMesssage(void* buffer, size_t size);
-    bool ProcessOrderExecutedMessage(void* buffer, size_t size);
-    bool ProcessOrderExecutedWithPriceMessage(void* buffer, size_t size);
-    bool ProcessOrderCancelMessage(void* buffer, size_t size);
-    bool ProcessOrderDeleteMessage(void* buffer, size_t size);
-    bool ProcessOrderReplaceMessage(void* buffer, size_t size);
-    bool ProcessTradeMessage(void* buffer, size_t size);
-    bool ProcessCrossTradeMessage(void* buffer, size_t size);
-    bool ProcessBrokenTradeMessage(void* buffer, size_t size);
-    bool ProcessUnknownMessage(void* buffer, size_t size);
-
-    template <size_t N>
-    size_t ReadString(const void* buffer, char (&str)[N]);
-    size_t readTimestamp(const void* buffer, std::uint64_t& value);
-};
+#endif
@@ -0,0 +1,260 @@
+#include "journal.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "book.hpp"
+
+namespace Journal {
+
+namespace {
+
+// size of the whole records of a journal, 0 if its header is invalid
+std::size_t valid_size(const void *data, const std::size_t size,
+                       const Utils::Price tick_size) {
+    FileHeader header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.version != version || header.tick_size != tick_size) {
+        return 0;
+    }
+    const std::size_t records = (size - sizeof(header)) / sizeof(Command);
+    return sizeof(header) + records * sizeof(Command);
+}
+
+}  // namespace
+
+std::size_t Replay(const void *data, const std::size_t size, Book &book,
+                   const uint64_t after, uint64_t *last) {
+    const std::size_t end = valid_size(data, size, book.get_tick_size());
+    if (end == 0) {
+        return 0;
+    }
+
+    std::size_t applied = 0;
+    Command command;
+    for (std::size_t offset = sizeof(FileHeader); offset < end;
+         offset += sizeof(Command)) {
+        std::memcpy(&command, static_cast<const uint8_t *>(data) + offset,
+                    sizeof(command));
+        if (last != nullptr) {
+            *last = command.sequence;
+        }
+        if (command.sequence <= after) {
+            continue;
+        }
+
+        switch (command.type) {
+            case Command::insert:
+                book.insert<Order>(
+                    static_cast<Utils::Side>(command.side), command.price,
+                    command.quantity,
+                    (command.flags & Command::immediate_or_cancel) != 0,
+                    (command.flags & Command::all_or_nothing) != 0,
+                    command.id);
+                break;
+            case Command::cancel:
+                book.remove(command.id);
+                break;
+            case Command::reduce:
+                book.cancel(command.id, command.quantity);
+                break;
+            case Command::execute:
+                book.execute(command.id, command.quantity, command.price,
+                             (command.flags & Command::non_printable) == 0);
+                break;
+            case Command::append:
+                book.append_order(
+                    static_cast<Utils::Side>(command.side), command.price,
+                    command.quantity, command.id,
+                    (command.flags & Command::all_or_nothing) != 0);
+                break;
+            case Command::modify:
+                if (const SharedOrderPtr order = book.find_order(command.id)) {
+                    order->set_all_or_nothing(
+                        (command.flags & Command::all_or_nothing) != 0);
+                    order->set_quantity(command.quantity);
+                }
+                break;
+        }
+        ++applied;
+    }
+    return applied;
+}
+
+}  // namespace Journal
+
+OrderJournal::OrderJournal(const std::size_t capacity,
+                           const std::size_t group_bytes,
+                           const std::chrono::microseconds group_interval)
+    : ring(capacity),
+      group_bytes(std::max(group_bytes, sizeof(Journal::Command))),
+      group_interval(group_interval) {}
+
+bool OrderJournal::Open(const FileSystem::Path &path,
+                        const Utils::Price tick_size, const bool truncate) {
+    if (IsOpen() || stopping.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // an existing journal is checked and cut after its last whole record
+    std::size_t size = 0;
+    if (!truncate) {
+        FileSystem::MappedFile existing(path);
+        if (existing.Open(false, false)) {
+            size = Journal::valid_size(existing.data(), existing.size(),
+                                       tick_size);
+            if (size == 0) {
+                return false;
+            }
+            if (size > sizeof(Journal::FileHeader)) {
+                Journal::Command command;
+                std::memcpy(&command,
+                            static_cast<const uint8_t *>(existing.data()) +
+                                size - sizeof(command),
+                            sizeof(command));
+                next_sequence = command.sequence + 1;
+            }
+            if (size != existing.size() &&
+                ::truncate(path.string().c_str(), size) != 0) {
+                return false;
+            }
+        }
+    }
+
+    file = FileSystem::FileWriter(path);
+    if (!file.Open(truncate)) {
+        return false;
+    }
+    if (size == 0) {
+        Journal::FileHeader header{};
+        std::memcpy(header.magic, Journal::magic, sizeof(header.magic));
+        header.version = Journal::version;
+        header.tick_size = tick_size;
+        if (!file.Write(&header, sizeof(header)) || !file.Sync()) {
+            file.Close();
+            return false;
+        }
+    }
+
+    durable.store(next_sequence - 1, std::memory_order_release);
+    opened = std::chrono::steady_clock::now();
+    flusher = std::thread([this] { Flush(); });
+    return true;
+}
+
+void OrderJournal::Close() {
+    if (!IsOpen()) {
+        return;
+    }
+
+    stopping.store(true, std::memory_order_release);
+    ring.Close();
+    flusher.join();
+    file.Close();
+    closed = std::chrono::steady_clock::now();
+}
+
+bool OrderJournal::Sync() {
+    const uint64_t target = appended_sequence();
+    sync_requested.store(true, std::memory_order_release);
+    while (durable.load(std::memory_order_acquire) < target &&
+           !failed()) {
+        std::this_thread::yield();
+    }
+    sync_requested.store(false, std::memory_order_relaxed);
+    return !failed();
+}
+
+OrderJournal::Metrics OrderJournal::get_metrics() const {
+    Metrics metrics;
+    metrics.commands = commands.load(std::memory_order_acquire);
+    metrics.bytes = bytes.load(std::memory_order_acquire);
+    metrics.commits = commits.load(std::memory_order_acquire);
+
+    const auto end = IsOpen() ? std::chrono::steady_clock::now() : closed;
+    metrics.seconds = std::chrono::duration<double>(end - opened).count();
+    if (metrics.seconds > 0.0) {
+        metrics.bytes_per_second = metrics.bytes / metrics.seconds;
+    }
+    if (!IsOpen()) {
+        metrics.commit_latency = commit_latency;
+    }
+    return metrics;
+}
+
+void OrderJournal::Commit(std::size_t &pending, const uint64_t last,
+                          const std::chrono::steady_clock::time_point first) {
+    // a failed write or sync leaves the durable sequence behind for good
+    const bool synced = file.Sync() && !failed();
+    if (!synced) {
+        error.store(true, std::memory_order_release);
+    }
+    commit_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - first)
+                              .count());
+    commands.fetch_add(pending / sizeof(Journal::Command),
+                       std::memory_order_relaxed);
+    bytes.fetch_add(pending, std::memory_order_relaxed);
+    commits.fetch_add(1, std::memory_order_relaxed);
+    if (synced) {
+        durable.store(last, std::memory_order_release);
+    }
+    pending = 0;
+}
+
+void OrderJournal::Flush() {
+    using Clock = std::chrono::steady_clock;
+    // longest sleep while a group waits for more commands
+    const std::chrono::nanoseconds poll = std::chrono::microseconds(50);
+
+    std::size_t pending = 0;
+    uint64_t last = 0;
+    Clock::time_point first;
+
+    auto write = [&](const Journal::Command &command) {
+        if (pending == 0) {
+            first = Clock::now();
+        }
+        if (!file.Write(&command, sizeof(command))) {
+            error.store(true, std::memory_order_release);
+        }
+        pending += sizeof(command);
+        last = command.sequence;
+    };
+
+    for (;;) {
+        // nothing pending, sleep until the next command
+        if (pending == 0 && !ring.Wait()) {
+            break;
+        }
+
+        const std::size_t room = group_bytes > pending
+                                     ? group_bytes - pending
+                                     : sizeof(Journal::Command);
+        ring.Consume(write, (room + sizeof(Journal::Command) - 1) /
+                                sizeof(Journal::Command));
+
+        const Clock::duration waited = Clock::now() - first;
+        if (pending >= group_bytes || waited >= group_interval) {
+            Commit(pending, last, first);
+            continue;
+        }
+        if (!ring.empty()) {
+            continue;
+        }
+        // the group is not full, commit it early only when asked to
+        if (stopping.load(std::memory_order_acquire) ||
+            sync_requested.load(std::memory_order_acquire)) {
+            Commit(pending, last, first);
+            continue;
+        }
+        std::this_thread::sleep_for(
+            std::min<Clock::duration>(group_interval - waited, poll));
+    }
+}
@@ -0,0 +1,246 @@
+/*
+ * Journal header defines the write-ahead journal of the commands a book
+ * accepts:
+ *  - FileHeader, at the start of every journal file
+ *  - Command, one fixed-size record per inbound command: an order
+ *    accepted by Book::insert or queued by Book::append_order, an order
+ *    canceled (Order::cancel, Book::remove), a partial cancel, an
+ *    execution or the change of a resting order. A replace is journaled as the cancel of the original and
+ *    the new order.
+ *  - OrderJournal, appending commands from the matching thread and
+ *    committing them to a file from a flush thread
+ *  - Replay, applying a journal to a book for recovery
+ *
+ * Commands are journaled when the book acts on them, so orders deferred
+ * by event handlers are journaled when they are finally inserted, and
+ * every order a handler or trigger inserts is journaled as any other.
+ * Replaying the commands in sequence into a book without handlers then
+ * rebuilds the same levels, in the same time priority. Triggers are not
+ * journaled, the orders they insert are. Cancels a handler issues while
+ * an insertion is still executing are replayed once it is done, orders
+ * must carry a reference number to be canceled on replay.
+ *
+ * Records are 8-byte aligned and in host byte order, as checkpoints are
+ * (see checkpoint.hpp). A checkpoint restored first is brought up to
+ * date by replaying the commands following the sequence it was taken at.
+ */
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "filesystem.hpp"
+#include "latency.hpp"
+#include "ring.hpp"
+#include "utils.hpp"
+
+class Book;
+
+namespace Journal {
+
+const uint32_t version = 1;
+const char magic[8] = {'L', 'O', 'B', 'J', 'R', 'N', 'L', '\0'};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    Utils::Price tick_size;
+};
+
+struct Command {
+    enum Type : uint8_t {
+        // insert an order: side, price, quantity, flags and id
+        insert = 0,
+        // cancel the resting order id
+        cancel = 1,
+        // cancel quantity of the resting order id
+        reduce = 2,
+        // execute quantity of the resting order id at price
+        execute = 3,
+        // queue an order without matching it (Book::append_order): side,
+        // price, quantity, flags and id
+        append = 4,
+        // set the quantity and flags of the resting order id
+        // (Order::set_quantity, Order::set_all_or_nothing)
+        modify = 5
+    };
+    // flags of the order, non_printable only for executions, which carry
+    // their price instead of the order's
+    enum Flags : uint8_t {
+        immediate_or_cancel = 1,
+        all_or_nothing = 2,
+        non_printable = 4
+    };
+
+    // position of the command in the journal, from 1
+    uint64_t sequence;
+    Type type;
+    uint8_t side;
+    uint8_t flags;
+    uint8_t reserved[5];
+    uint64_t id;
+    Utils::Price price;
+    double quantity;
+};
+
+static_assert(sizeof(FileHeader) == 24, "FileHeader is 24 bytes");
+static_assert(sizeof(Command) == 40, "Command is 40 bytes");
+
+/*
+ * @brief apply the commands of a journal, e.g. mapped from a file, to a
+ * book in sequence. A torn record at the end, left by a crash during a
+ * commit, is ignored.
+ *
+ * @param after, sequence of the last command already applied to the book
+ * @param last, set to the sequence of the last command of the journal
+ * @return the number of commands applied, 0 if the journal is invalid or
+ * has another tick size than the book
+ */
+std::size_t Replay(const void *data, const std::size_t size, Book &book,
+                   const uint64_t after = 0, uint64_t *last = nullptr);
+
+}  // namespace Journal
+
+/*
+ * OrderJournal writes the commands of a book to a file with group
+ * commit: the matching thread appends commands into an SPSCRing, a flush
+ * thread drains it into a FileSystem::FileWriter and syncs the file once
+ * group_bytes are pending or the oldest pending command waited for
+ * group_interval, whichever comes first. The matching thread never
+ * waits on the disk, only on the flush thread if the ring fills up.
+ *
+ * append and Sync are called from the thread running the book, every
+ * other method from the thread owning the journal.
+ */
+class OrderJournal {
+   public:
+    struct Metrics {
+        uint64_t commands = 0;
+        uint64_t bytes = 0;
+        uint64_t commits = 0;
+        // seconds between Open and Close, or now while open
+        double seconds = 0.0;
+        double bytes_per_second = 0.0;
+        // nanoseconds from the flush thread taking the first command of a
+        // group to the group being durable
+        LatencyHistogram commit_latency;
+    };
+
+    /*
+     * @brief Constructor
+     *
+     * @param capacity, number of commands the ring holds
+     * @param group_bytes, pending bytes committed at once
+     * @param group_interval, longest a pending command waits for its
+     * group to be committed
+     */
+    explicit OrderJournal(
+        const std::size_t capacity = 1 << 16,
+        const std::size_t group_bytes = 1 << 16,
+        const std::chrono::microseconds group_interval =
+            std::chrono::microseconds(1000));
+
+    OrderJournal(const OrderJournal &journal) = delete;
+    OrderJournal &operator=(const OrderJournal &journal) = delete;
+
+    ~OrderJournal() { Close(); }
+
+    /*
+     * @brief open the journal file and start the flush thread, a journal
+     * is opened once. A new or truncated file gets a header. An existing
+     * journal is appended to, numbering commands on from its last one,
+     * once a torn record left at its end is cut off.
+     *
+     * @return false if the file cannot be opened or holds something else
+     * than a journal of this tick size
+     */
+    bool Open(const FileSystem::Path &path, const Utils::Price tick_size,
+              const bool truncate = false);
+
+    /*
+     * @brief commit the pending commands, stop the flush thread and close
+     * the file, once nothing is appended anymore
+     */
+    void Close();
+
+    bool IsOpen() const { return flusher.joinable(); }
+
+    /*
+     * @brief append a command, it is committed by the flush thread
+     */
+    inline void append(const Journal::Command::Type type,
+                       const Utils::Side side, const uint8_t flags,
+                       const uint64_t id, const Utils::Price price,
+                       const double quantity) {
+        ring.Next() = Journal::Command{next_sequence++,
+                                       type,
+                                       static_cast<uint8_t>(side),
+                                       flags,
+                                       {},
+                                       id,
+                                       price,
+                                       quantity};
+        ring.Publish();
+    }
+
+    // sequence of the last command appended
+    uint64_t appended_sequence() const { return next_sequence - 1; }
+
+    // sequence of the last command durable on disk
+    uint64_t durable_sequence() const {
+        return durable.load(std::memory_order_acquire);
+    }
+
+    /*
+     * @brief wait until every command appended so far is durable
+     *
+     * @return false if a write failed meanwhile
+     */
+    bool Sync();
+
+    // whether a write or sync of the file failed
+    bool failed() const { return error.load(std::memory_order_acquire); }
+
+    /*
+     * @brief get the counters of the flush thread, the commit latency is
+     * only filled once the journal is closed
+     */
+    Metrics get_metrics() const;
+
+   private:
+    SPSCRing<Journal::Command, Ring::FutexWait> ring;
+    const std::size_t group_bytes;
+    const std::chrono::nanoseconds group_interval;
+
+    FileSystem::FileWriter file;
+    std::thread flusher;
+
+    // written by the matching thread
+    uint64_t next_sequence = 1;
+    std::atomic<bool> sync_requested{false};
+    std::atomic<bool> stopping{false};
+
+    // written by the flush thread
+    std::atomic<uint64_t> durable{0};
+    std::atomic<uint64_t> commands{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> commits{0};
+    std::atomic<bool> error{false};
+    LatencyHistogram commit_latency;
+
+    std::chrono::steady_clock::time_point opened;
+    std::chrono::steady_clock::time_point closed;
+
+    // body of the flush thread
+    void Flush();
+    void Commit(std::size_t &pending, const uint64_t last,
+                const std::chrono::steady_clock::time_point first);
+};
+
+#endif
@@ -0,0 +1,474 @@
+/*
+ * PriceLadder header defines a direct-indexed store for the price levels
+ * of one book side.
+ *
+ * Levels live in a contiguous ring of slots indexed by tick. The ring
+ * covers a window of `span` consecutive prices starting at the best price
+ * minus some headroom, and a two-level occupancy bitmap finds the next
+ * non-empty level with ctz. Levels worse than the window are kept in an
+ * overflow map so that outliers (stub quotes, far limits) never force the
+ * window to grow. The window is recentred when the touch drifts.
+ *
+ * Internally prices are mapped to a rank which increases from the best to
+ * the worst price on both sides (rank = -price for bids, price for asks),
+ * so both sides share the same code.
+ *
+ * Not thread-safe
+ */
+
+#ifndef LADDER_HPP
+#define LADDER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+template <class Limit>
+class PriceLadder {
+   private:
+    using Rank = Utils::Price;
+    using Overflow = std::map<Rank, Limit>;
+
+    Utils::Side side;
+    std::size_t span;
+    std::size_t mask;
+
+    // first rank covered by the window, the window is [base, base + span)
+    Rank base = 0;
+    std::size_t window_count = 0;
+
+    // slots are allocated on first use, untouched books cost nothing
+    std::vector<Limit> slots;
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> summary;
+
+    // levels worse than the window, keyed by rank
+    Overflow overflow;
+
+    inline Rank to_rank(const Utils::Price price) const {
+        return side == Utils::Side::bid ? -price : price;
+    }
+    inline Utils::Price to_price(const Rank rank) const {
+        return side == Utils::Side::bid ? -rank : rank;
+    }
+    inline std::size_t slot(const Rank rank) const {
+        return static_cast<std::size_t>(rank) & mask;
+    }
+    inline bool in_window(const Rank rank) const {
+        return rank >= base && rank < base + static_cast<Rank>(span);
+    }
+
+    inline void set_bit(const std::size_t s) {
+        words[s >> 6] |= 1ull << (s & 63);
+        summary[s >> 12] |= 1ull << ((s >> 6) & 63);
+    }
+
+    inline void clear_bit(const std::size_t s) {
+        words[s >> 6] &= ~(1ull << (s & 63));
+        if (words[s >> 6] == 0) {
+            summary[s >> 12] &= ~(1ull << ((s >> 6) & 63));
+        }
+    }
+
+    /*
+     * @brief find the first occupied slot in [first, last)
+     *
+     * @return the slot index or last if none is occupied
+     */
+    std::size_t find_slot(const std::size_t first,
+                          const std::size_t last) const {
+        if (first >= last) {
+            return last;
+        }
+
+        std::size_t word = first >> 6;
+        uint64_t bits = words[word] & (~0ull << (first & 63));
+
+        if (bits == 0) {
+            // skip empty words through the summary level
+            const std::size_t next_word = word + 1;
+            std::size_t group = next_word >> 6;
+            if (group >= summary.size()) {
+                return last;
+            }
+
+            uint64_t groups = summary[group];
+            if ((next_word & 63) != 0) {
+                groups &= ~0ull << (next_word & 63);
+            }
+
+            while (groups == 0) {
+                if (++group >= summary.size()) {
+                    return last;
+                }
+                groups = summary[group];
+            }
+
+            word = (group << 6) + __builtin_ctzll(groups);
+            bits = words[word];
+        }
+
+        const std::size_t found = (word << 6) + __builtin_ctzll(bits);
+        return found < last ? found : last;
+    }
+
+    /*
+     * @brief find the first occupied rank in [first, last), with
+     * last - first <= span. Handles the wrap around of the ring.
+     *
+     * @return the rank or last if none is occupied
+     */
+    Rank find_rank(const Rank first, const Rank last) const {
+        if (first >= last || window_count == 0) {
+            return last;
+        }
+
+        const std::size_t length = static_cast<std::size_t>(last - first);
+        const std::size_t begin = slot(first);
+
+        if (begin + length <= span) {
+            return first + (find_slot(begin, begin + length) - begin);
+        }
+
+        const std::size_t head = find_slot(begin, span);
+        if (head != span) {
+            return first + (head - begin);
+        }
+
+        const std::size_t tail_length = begin + length - span;
+        return first + (span - begin) + find_slot(0, tail_length);
+    }
+
+    inline Rank window_end() const { return base + static_cast<Rank>(span); }
+
+    inline Rank best_window_rank() const {
+        return find_rank(base, window_end());
+    }
+
+    void allocate() {
+        slots.resize(span);
+        words.assign(span / 64, 0);
+        summary.assign((words.size() + 63) / 64, 0);
+    }
+
+    /*
+     * @brief move the window to start at new_base. Every occupied rank
+     * must be at or after new_base. Window levels falling behind the new
+     * window are evicted to the overflow map, overflow levels covered by
+     * the new window are moved into their slots.
+     */
+    void rebase(const Rank new_base) {
+        const Rank new_end = new_base + static_cast<Rank>(span);
+        const Rank old_end = window_end();
+
+        if (new_end < old_end) {
+            const Rank first = new_end > base ? new_end : base;
+            for (Rank rank = find_rank(first, old_end); rank != old_end;
+                 rank = find_rank(rank + 1, old_end)) {
+                const std::size_t s = slot(rank);
+                overflow.emplace(rank, std::move(slots[s]));
+                slots[s] = Limit();
+                clear_bit(s);
+                --window_count;
+            }
+        }
+
+        base = new_base;
+
+        auto iter = overflow.begin();
+        while (iter != overflow.end() && iter->first < new_end) {
+            const std::size_t s = slot(iter->first);
+            slots[s] = std::move(iter->second);
+            set_bit(s);
+            ++window_count;
+            iter = overflow.erase(iter);
+        }
+    }
+
+    // headroom left in front of the best level when recentring
+    inline Rank headroom() const { return static_cast<Rank>(span / 4); }
+
+   public:
+    /*
+     * @brief iterator over the levels from the best to the worst
+     * price. Dereferences to a pair-like (first: price, second: limit)
+     * so that code written against std::map iterators keeps working.
+     */
+    template <bool Const>
+    class basic_iterator {
+       private:
+        using Ladder =
+            typename std::conditional<Const, const PriceLadder,
+                                      PriceLadder>::type;
+        using FarIterator =
+            typename std::conditional<Const,
+                                      typename Overflow::const_iterator,
+                                      typename Overflow::iterator>::type;
+        using LimitRef =
+            typename std::conditional<Const, const Limit &, Limit &>::type;
+
+        Ladder *ladder = nullptr;
+        Rank rank = 0;
+        bool windowed = false;
+        FarIterator far;
+
+        basic_iterator(Ladder *ladder, const Rank rank)
+            : ladder(ladder), rank(rank), windowed(true) {}
+        basic_iterator(Ladder *ladder, FarIterator far)
+            : ladder(ladder), windowed(false), far(far) {}
+
+        friend PriceLadder;
+
+       public:
+        struct reference {
+            const Utils::Price first;
+            LimitRef second;
+        };
+
+        struct pointer {
+            reference ref;
+            reference *operator->() { return &ref; }
+        };
+
+        basic_iterator() = default;
+
+        inline reference operator*() const {
+            if (windowed) {
+                return {ladder->to_price(rank),
+                        ladder->slots[ladder->slot(rank)]};
+            }
+            return {ladder->to_price(far->first), far->second};
+        }
+
+        inline pointer operator->() const { return pointer{**this}; }
+
+        inline basic_iterator &operator++() {
+            if (windowed) {
+                const Rank end = ladder->window_end();
+                rank = ladder->find_rank(rank + 1, end);
+                if (rank == end) {
+                    windowed = false;
+                    far = ladder->overflow.begin();
+                }
+            } else {
+                ++far;
+            }
+            return *this;
+        }
+
+        inline basic_iterator operator++(int) {
+            basic_iterator copy = *this;
+            ++(*this);
+            return copy;
+        }
+
+        inline bool operator==(const basic_iterator &other) const {
+            if (windowed != other.windowed) {
+                return false;
+            }
+            return windowed ? rank == other.rank : far == other.far;
+        }
+
+        inline bool operator!=(const basic_iterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    /*
+     * @brief Constructor
+     *
+     * @param side, the book side ordering the levels
+     * @param span, number of ticks covered by the window, rounded up to a
+     * power of two and at least 64
+     */
+    explicit PriceLadder(const Utils::Side side,
+                         const std::size_t span = 4096)
+        : side(side) {
+        std::size_t size = 64;
+        while (size < span) {
+            size <<= 1;
+        }
+        this->span = size;
+        mask = size - 1;
+    }
+
+    PriceLadder(const PriceLadder &) = delete;
+    PriceLadder &operator=(const PriceLadder &) = delete;
+
+    inline bool empty() const { return window_count == 0; }
+    inline std::size_t size() const { return window_count + overflow.size(); }
+    inline std::size_t get_span() const { return span; }
+
+    // approximate heap memory held by the ladder, in bytes
+    inline std::size_t get_memory_usage() const {
+        // a red-black tree node carries 4 words on top of its value
+        const std::size_t node = sizeof(typename Overflow::value_type) + 32;
+        return slots.capacity() * sizeof(Limit) +
+               (words.capacity() + summary.capacity()) * sizeof(uint64_t) +
+               overflow.size() * node;
+    }
+
+    inline iterator begin() {
+        if (window_count == 0) {
+            return end();
+        }
+        return iterator(this, best_window_rank());
+    }
+
+    inline iterator end() { return iterator(this, overflow.end()); }
+
+    inline const_iterator begin() const {
+        if (window_count == 0) {
+            return end();
+        }
+        return const_iterator(this, best_window_rank());
+    }
+
+    inline const_iterator end() const {
+        return const_iterator(this, overflow.end());
+    }
+
+    /*
+     * @brief get the best price of the side, the ladder must not be empty
+     */
+    inline Utils::Price best_price() const {
+        return to_price(best_window_rank());
+    }
+
+    /*
+     * @brief get the level at price
+     *
+     * @return pointer to the level or nullptr if there is none
+     */
+    inline Limit *get(const Utils::Price price) {
+        const Rank rank = to_rank(price);
+        if (in_window(rank)) {
+            const std::size_t s = slot(rank);
+            return (words[s >> 6] >> (s & 63)) & 1 ? &slots[s] : nullptr;
+        }
+        if (rank < base) {
+            return nullptr;
+        }
+        const auto iter = overflow.find(rank);
+        return iter != overflow.end() ? &iter->second : nullptr;
+    }
+
+    inline iterator find(const Utils::Price price) {
+        const Rank rank = to_rank(price);
+        if (in_window(rank)) {
+            const std::size_t s = slot(rank);
+            return (words[s >> 6] >> (s & 63)) & 1 ? iterator(this, rank)
+                                                    : end();
+        }
+        if (rank < base) {
+            return end();
+        }
+        return iterator(this, overflow.find(rank));
+    }
+
+    /*
+     * @brief get an iterator to the first level at price or worse
+     */
+    inline iterator lower_bound(const Utils::Price price) {
+        const Rank rank = to_rank(price);
+        if (window_count != 0 && rank < window_end()) {
+            const Rank first = rank > base ? rank : base;
+            const Rank found = find_rank(first, window_end());
+            if (found != window_end()) {
+                return iterator(this, found);
+            }
+        }
+        return iterator(this, overflow.lower_bound(rank));
+    }
+
+    /*
+     * @brief get the level at price, creating an empty one if needed.
+     * Recentres the window when the price is better than the window or
+     * when the touch has drifted far enough to cover the new price.
+     */
+    Limit &emplace(const Utils::Price price) {
+        const Rank rank = to_rank(price);
+
+        if (slots.empty()) {
+            allocate();
+        }
+
+        if (window_count == 0) {
+            // overflow is empty whenever the window is
+            base = rank - headroom();
+        } else if (rank < base) {
+            rebase(rank - headroom());
+        } else if (rank >= window_end()) {
+            const Rank best = best_window_rank();
+            if (rank - best < static_cast<Rank>(span)) {
+                const Rank preferred = best - headroom();
+                const Rank needed = rank - static_cast<Rank>(span) + 1;
+                rebase(preferred > needed ? preferred : needed);
+            } else {
+                return overflow[rank];
+            }
+        }
+
+        const std::size_t s = slot(rank);
+        if (!((words[s >> 6] >> (s & 63)) & 1)) {
+            set_bit(s);
+            ++window_count;
+        }
+        return slots[s];
+    }
+
+    /*
+     * @brief erase the level at iterator
+     *
+     * @return iterator to the next worse level
+     */
+    iterator erase(iterator iter) {
+        if (!iter.windowed) {
+            return iterator(this, overflow.erase(iter.far));
+        }
+
+        const std::size_t s = slot(iter.rank);
+        slots[s] = Limit();
+        clear_bit(s);
+        --window_count;
+
+        if (window_count == 0) {
+            // keep the best levels in the window
+            if (!overflow.empty()) {
+                rebase(overflow.begin()->first - headroom());
+            }
+            return begin();
+        }
+
+        return ++iter;
+    }
+
+    inline void erase(const Utils::Price price) {
+        const iterator iter = find(price);
+        if (iter != end()) {
+            erase(iter);
+        }
+    }
+
+    void clear() {
+        for (Rank rank = find_rank(base, window_end()); rank != window_end();
+             rank = find_rank(rank + 1, window_end())) {
+            slots[slot(rank)] = Limit();
+        }
+        std::fill(words.begin(), words.end(), 0);
+        std::fill(summary.begin(), summary.end(), 0);
+        window_count = 0;
+        overflow.clear();
+    }
+};
+
+#endif
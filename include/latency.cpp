@@ -0,0 +1,82 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+}
+
+void LatencyHistogram::reset() {
+    counts.fill(0);
+    total = 0;
+    sum = 0;
+    minimum = UINT64_MAX;
+    maximum = 0;
+}
+
+uint64_t LatencyHistogram::percentile(const double p) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(highest(i), maximum);
+        }
+    }
+    return maximum;
+}
+
+const char *LatencyProfile::stage_name(const Stage stage) {
+    switch (stage) {
+        case frame:
+            return "frame";
+        case decode:
+            return "decode";
+        case book:
+            return "book";
+        case callbacks:
+            return "callbacks";
+    }
+    return "unknown";
+}
+
+void LatencyProfile::merge(const LatencyProfile &other) {
+    for (std::size_t stage = 0; stage < stages; ++stage) {
+        for (std::size_t type = 0; type < 256; ++type) {
+            const auto &source = other.histograms[stage][type];
+            if (!source) continue;
+
+            auto &histogram = histograms[stage][type];
+            if (!histogram) histogram.reset(new LatencyHistogram());
+            histogram->merge(*source);
+        }
+    }
+}
+
+void LatencyProfile::reset() {
+    for (auto &stage : histograms) {
+        for (auto &histogram : stage) {
+            histogram.reset();
+        }
+    }
+}
+
+LatencyHistogram LatencyProfile::total(const Stage stage) const {
+    LatencyHistogram merged;
+    for (const auto &histogram : histograms[stage]) {
+        if (histogram) merged.merge(*histogram);
+    }
+    return merged;
+}
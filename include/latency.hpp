@@ -0,0 +1,130 @@
+/*
+ * Latency header defines low-overhead latency recording:
+ *  - LatencyHistogram, an HDR-style log-linear histogram
+ *  - LatencyProfile, one histogram per processing stage and message type
+ *
+ * Values below 2^sub_bits are counted exactly, every power of two above
+ * is split into 2^(sub_bits - 1) linear buckets, so a recorded value is
+ * known within 1 / 2^(sub_bits - 1) of itself. Recording is an index
+ * computation and an increment, histograms are fixed-size arrays.
+ *
+ * Values are meant to be Timestamp::rdts differences, converted to
+ * nanoseconds only when reported.
+ *
+ * Not thread-safe: every thread records into its own histograms, which
+ * are merged once the threads are done.
+ */
+
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class LatencyHistogram {
+   public:
+    static const unsigned sub_bits = 5;
+    // values from 2^max_bits on are counted in the last bucket
+    static const unsigned max_bits = 40;
+    static const std::size_t bucket_count =
+        (max_bits - sub_bits + 2) << (sub_bits - 1);
+
+    inline void record(uint64_t value) {
+        ++counts[index(value)];
+        ++total;
+        sum += value;
+        if (value < minimum) minimum = value;
+        if (value > maximum) maximum = value;
+    }
+
+    void merge(const LatencyHistogram &other);
+    void reset();
+
+    /*
+     * @brief get the value below which a fraction p of the recorded
+     * values fall, as the highest value of its bucket
+     *
+     * @param p, between 0 and 1
+     */
+    uint64_t percentile(const double p) const;
+
+    inline uint64_t count() const { return total; }
+    inline uint64_t min() const { return total != 0 ? minimum : 0; }
+    inline uint64_t max() const { return maximum; }
+    inline double mean() const {
+        return total != 0 ? static_cast<double>(sum) / total : 0.0;
+    }
+
+   private:
+    std::array<uint64_t, bucket_count> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t minimum = UINT64_MAX;
+    uint64_t maximum = 0;
+
+    static inline std::size_t index(uint64_t value) {
+        if (value < (1ull << sub_bits)) {
+            return static_cast<std::size_t>(value);
+        }
+        if (value >= (1ull << max_bits)) {
+            value = (1ull << max_bits) - 1;
+        }
+        const unsigned shift = 64 - __builtin_clzll(value) - sub_bits;
+        return (static_cast<std::size_t>(shift) << (sub_bits - 1)) +
+               static_cast<std::size_t>(value >> shift);
+    }
+
+    // highest value counted in the bucket at index
+    static inline uint64_t highest(const std::size_t index) {
+        if (index < (1u << sub_bits)) {
+            return index;
+        }
+        const unsigned shift = (index >> (sub_bits - 1)) - 1;
+        const uint64_t top = index - (static_cast<uint64_t>(shift)
+                                      << (sub_bits - 1));
+        return ((top + 1) << shift) - 1;
+    }
+};
+
+class LatencyProfile {
+   public:
+    enum Stage : uint8_t { frame = 0, decode = 1, book = 2, callbacks = 3 };
+    static const std::size_t stages = 4;
+
+    static const char *stage_name(const Stage stage);
+
+    /*
+     * @brief record the latency of a stage for a message type, the
+     * histogram is allocated on first use
+     */
+    inline void record(const Stage stage, const char type,
+                       const uint64_t value) {
+        auto &histogram = histograms[stage][static_cast<uint8_t>(type)];
+        if (!histogram) histogram.reset(new LatencyHistogram());
+        histogram->record(value);
+    }
+
+    void merge(const LatencyProfile &other);
+    void reset();
+
+    /*
+     * @brief get the histogram of a stage for a message type
+     *
+     * @return the histogram or nullptr if nothing was recorded
+     */
+    inline const LatencyHistogram *get(const Stage stage,
+                                       const char type) const {
+        return histograms[stage][static_cast<uint8_t>(type)].get();
+    }
+
+    // every message type of a stage merged
+    LatencyHistogram total(const Stage stage) const;
+
+   private:
+    std::array<std::array<std::unique_ptr<LatencyHistogram>, 256>, stages>
+        histograms;
+};
+
+#endif
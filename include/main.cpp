@@ -2,18 +2,262 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "../external/cpp-optparse/OptionParser.h"
+#include "archive.hpp"
 #include "filesystem.hpp"
 #include "handler.hpp"
+#include "latency.hpp"
+#include "manager.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "seek.hpp"
 #include "timestamp.hpp"
 #include "utils.hpp"
 
+/*
+ * @brief replay the input file, read block by block by a reader or
+ * mapped, or stdin, through a handler
+ */
+template <class Handler>
+void Replay(Handler& handler, const FileSystem::MappedFile& file,
+            FileSystem::Reader* reader) {
+    if (reader != nullptr) {
+        const void* data;
+        size_t size;
+        while (reader->Next(data, size)) {
+            handler.Process(data, size);
+        }
+        if (reader->failed()) {
+            fmt::print("Failed to read the input file, replay incomplete");
+        }
+    } else if (file.IsOpen()) {
+        handler.Process(file.data(), file.size());
+    } else {
+        // process stdin
+        size_t size;
+        std::vector<uint8_t> buffer(FileSystem::AsyncReader::DEFAULT_BLOCK);
+        while ((size = std::fread(buffer.data(), 1, buffer.size(), stdin)) >
+               0) {
+            handler.Process(buffer.data(), size);
+        }
+    }
+}
+
+template <class Handler>
+void Report(const Handler& handler, const uint64_t elapsed) {
+    size_t total_messages = handler.messages();
+
+    fmt::print("Errors: {}", handler.errors());
+
+    // TODO ReportConsole::GenerateTimePeriod
+    fmt::print("Processing Time: {}",
+               Utils::ReportConsole::GenerateTimePeriod(elapsed));
+
+    fmt::print("Total ITCH messages: {}", total_messages);
+    fmt::print("Total books: {}", handler.book_count());
+    fmt::print("Total resting orders: {}", handler.order_count());
+    fmt::print("Books memory: {} bytes", handler.memory_usage());
+
+    // a seek may process no message at all
+    if (total_messages == 0 || elapsed == 0) {
+        return;
+    }
+    fmt::print("ITCH message latency: {}",
+               Utils::ReportConsole::GenerateTimePeriod(elapsed /
+                                                        total_messages));
+    fmt::print("ITCH message throughput: {} msg/s",
+               total_messages * 1000000000 / elapsed);
+}
+
+/*
+ * @brief print the latency percentiles of every stage, per message type
+ */
+void ReportLatency(const LatencyProfile& profile) {
+    const double ticks_per_ns = Timestamp::rdts_per_nano();
+    auto print = [&](const char* stage, const char* type,
+                     const LatencyHistogram& histogram) {
+        fmt::print("{:<10} {:>4} {:>12} {:>10.0f} {:>10.0f} {:>10.0f} "
+                   "{:>10.0f}\n",
+                   stage, type, histogram.count(),
+                   histogram.percentile(0.5) / ticks_per_ns,
+                   histogram.percentile(0.99) / ticks_per_ns,
+                   histogram.percentile(0.999) / ticks_per_ns,
+                   histogram.max() / ticks_per_ns);
+    };
+
+    fmt::print("{:<10} {:>4} {:>12} {:>10} {:>10} {:>10} {:>10}\n", "stage",
+               "type", "messages", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    for (std::size_t i = 0; i < LatencyProfile::stages; ++i) {
+        const auto stage = static_cast<LatencyProfile::Stage>(i);
+        const LatencyHistogram total = profile.total(stage);
+        if (total.count() == 0) continue;
+
+        for (int type = 0; type < 256; ++type) {
+            const LatencyHistogram* histogram =
+                profile.get(stage, static_cast<char>(type));
+            if (histogram == nullptr) continue;
+            const char name[2] = {static_cast<char>(type), 0};
+            print(LatencyProfile::stage_name(stage), name, *histogram);
+        }
+        print(LatencyProfile::stage_name(stage), "all", total);
+    }
+}
+
+/*
+ * @brief build the seek index of the input in one pass and write it to
+ * path
+ */
+bool BuildIndex(const FileSystem::MappedFile& file,
+                FileSystem::Reader* reader, const std::string& path,
+                const uint64_t interval_messages,
+                const uint64_t interval_time) {
+    SeekIndexBuilder builder(interval_messages, interval_time);
+    Replay(builder, file, reader);
+
+    std::vector<uint8_t> index;
+    builder.index().write(index);
+    FileSystem::FileWriter writer{FileSystem::Path(path)};
+    if (!writer.Open(true) || !writer.Write(index.data(), index.size()) ||
+        !writer.Sync()) {
+        return false;
+    }
+    fmt::print("Indexed {} messages, {} entries", builder.messages(),
+               builder.index().entries().size());
+    return true;
+}
+
+/*
+ * @brief parse a time of day, HH:MM[:SS[.fraction]]
+ *
+ * @return nanoseconds since midnight, UINT64_MAX if malformed
+ */
+uint64_t ParseTime(const std::string& time) {
+    unsigned hours = 0, minutes = 0, seconds = 0;
+    char fraction[10] = {};
+    const int fields = std::sscanf(time.c_str(), "%u:%u:%u.%9[0-9]", &hours,
+                                   &minutes, &seconds, fraction);
+    if (fields < 2 || hours > 23 || minutes > 59 || seconds > 59) {
+        return UINT64_MAX;
+    }
+
+    uint64_t nanoseconds = 0;
+    std::size_t digits = 0;
+    for (; fraction[digits] != 0; ++digits) {
+        nanoseconds = nanoseconds * 10 + (fraction[digits] - '0');
+    }
+    for (; digits < 9; ++digits) nanoseconds *= 10;
+    return ((hours * 60ull + minutes) * 60 + seconds) * 1000000000ull +
+           nanoseconds;
+}
+
+/*
+ * @brief bring the books up to the first message at or after a time of
+ * day: restore the checkpoint when it was taken before that message,
+ * then process the mapped input from the checkpoint, or from byte 0, up
+ * to it
+ *
+ * @param position, set to the position reached
+ * @return false if the checkpoint is invalid
+ */
+bool Seek(BookManager& manager, const FileSystem::MappedFile& file,
+          const SeekIndex& index, const FileSystem::MappedFile& checkpoint,
+          const uint64_t timestamp, Checkpoint::Position& position) {
+    position = index.locate(file.data(), file.size(), timestamp);
+
+    Checkpoint::Position start;
+    if (checkpoint.IsOpen()) {
+        std::size_t offset = 0;
+        Checkpoint::ManagerHeader header;
+        if (!Checkpoint::Read(checkpoint.data(), checkpoint.size(), offset,
+                              header)) {
+            return false;
+        }
+        // a checkpoint taken after the time is of no use
+        if (header.position.offset <= position.offset &&
+            manager.restore(checkpoint.data(), checkpoint.size(), &start) ==
+                0) {
+            return false;
+        }
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(file.data());
+    manager.Process(data + start.offset, position.offset - start.offset);
+    return true;
+}
+
 int main(int argc, char** argv) {
     auto parser = optparse::OptionParser().version("1.0.0.0");
 
     parser.add_option("-i", "--input").dest("input").help("Input filename");
+    parser.add_option("--populate")
+        .action("store_true")
+        .dest("populate")
+        .help("Fault the whole input file in before processing");
+    parser.add_option("--async")
+        .action("store_true")
+        .dest("async")
+        .help("Read the input file ahead in blocks rather than mapping it");
+    parser.add_option("--block-size")
+        .dest("block_size")
+        .type("int")
+        .set_default(1024)
+        .help("Kilobytes of the blocks read ahead, see --async");
+    parser.add_option("--queue-depth")
+        .dest("queue_depth")
+        .type("int")
+        .set_default(4)
+        .help("Blocks read ahead at once, see --async");
+    parser.add_option("--direct")
+        .action("store_true")
+        .dest("direct")
+        .help("Bypass the page cache when reading ahead, see --async");
+    parser.add_option("-t", "--threads")
+        .dest("threads")
+        .type("int")
+        .set_default(1)
+        .help("Worker threads, books are sharded by StockLocate");
+    parser.add_option("--rebalance")
+        .dest("rebalance")
+        .type("int")
+        .set_default(0)
+        .help("Rebalance the busiest symbols every N messages");
+    parser.add_option("--pipeline")
+        .action("store_true")
+        .dest("pipeline")
+        .help("Decode and maintain the books on two threads");
+    parser.add_option("--latency")
+        .action("store_true")
+        .dest("latency")
+        .help("Report per stage latency percentiles by message type");
+    parser.add_option("--build-index")
+        .dest("build_index")
+        .help("Write the timestamp seek index of the input to a file");
+    parser.add_option("--index-messages")
+        .dest("index_messages")
+        .type("int")
+        .set_default(65536)
+        .help("Messages between two seek index entries at most");
+    parser.add_option("--index-interval")
+        .dest("index_interval")
+        .type("int")
+        .set_default(1000)
+        .help("Milliseconds between two seek index entries at most");
+    parser.add_option("--seek")
+        .dest("seek")
+        .help("Replay up to a time of day, HH:MM[:SS[.fraction]]");
+    parser.add_option("--index")
+        .dest("index")
+        .help("Seek index of the input, see --build-index");
+    parser.add_option("--checkpoint")
+        .dest("checkpoint")
+        .help("Checkpoint of the books to seek from");
 
     optparse::Values options = parser.parse_args(argc, argv);
 
@@ -23,47 +267,148 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    ITCHHandler itch_handler;
-    // Open input file or stdin
-    std::shared_ptr<Reader> input(new StdInput());
+    // Map input file, the whole file is processed in place. Compressed
+    // files are decompressed on a dedicated thread instead, plain files
+    // may be read ahead in blocks rather than mapped.
+    FileSystem::MappedFile file;
+    std::unique_ptr<FileSystem::Reader> reader;
     if (options.is_set("input")) {
-        FileSystem::File* file =
-            new FileSystem::File(FileSystem::Path(options.get("input")));
-        file->Open(true, false);
-        input.reset(file);
+        const FileSystem::Path path(options.get("input"));
+        file = FileSystem::MappedFile(path);
+        if (!file.Open(false, true)) {
+            fmt::print("Failed to open input file {}", options["input"]);
+            return -1;
+        }
+
+        if (FileSystem::DetectCompression(file.data(), file.size()) !=
+            FileSystem::Compression::none) {
+            file.Close();
+            auto archive = std::make_unique<FileSystem::ArchiveReader>(path);
+            if (!archive->Open()) {
+                fmt::print("Unsupported compression of input file {}",
+                           options["input"]);
+                return -1;
+            }
+            reader = std::move(archive);
+        } else if (options.get("async") && !options.is_set("seek")) {
+            // seeking walks the mapped file
+            file.Close();
+            auto async = std::make_unique<FileSystem::AsyncReader>(
+                path, static_cast<int>(options.get("block_size")) * 1024ull,
+                static_cast<int>(options.get("queue_depth")));
+            if (!async->Open(options.get("direct"))) {
+                fmt::print("Failed to open input file {}", options["input"]);
+                return -1;
+            }
+            reader = std::move(async);
+        } else if (options.get("populate") && !file.Open(true, true)) {
+            fmt::print("Failed to open input file {}", options["input"]);
+            return -1;
+        }
     }
 
-    // process input
-    size_t size;
-    uint8_t buffer[8192];
-    fmt::print("ITCH processing...");
-    uint64_t timestamp_start = Timestamp::nano();
+    if (options.is_set("build_index")) {
+        const uint64_t interval_messages =
+            static_cast<int>(options.get("index_messages"));
+        const uint64_t interval_time =
+            static_cast<int>(options.get("index_interval")) * 1000000ull;
+        if (!BuildIndex(file, reader.get(), options["build_index"],
+                        interval_messages, interval_time)) {
+            fmt::print("Failed to write index file {}",
+                       options["build_index"]);
+            return -1;
+        }
+        return 0;
+    }
 
-    while ((size == Utils::ReadMessage(buffer, sizeof(buffer))) > 0) {
-        // process buffer
-        itch_handler.ProcessMessage(buffer, size);
+    if (options.is_set("seek")) {
+        const uint64_t timestamp = ParseTime(options["seek"]);
+        if (timestamp == UINT64_MAX) {
+            fmt::print("Invalid time {}", options["seek"]);
+            return -1;
+        }
+        FileSystem::MappedFile index_file(
+            FileSystem::Path(options.get("index")));
+        SeekIndex index;
+        if (!file.IsOpen() || !options.is_set("index") ||
+            !index_file.Open(false, false) ||
+            !index.read(index_file.data(), index_file.size())) {
+            fmt::print("Seeking requires an input file and its index");
+            return -1;
+        }
+        FileSystem::MappedFile checkpoint;
+        if (options.is_set("checkpoint")) {
+            checkpoint = FileSystem::MappedFile(
+                FileSystem::Path(options.get("checkpoint")));
+            if (!checkpoint.Open(true, true)) {
+                fmt::print("Cannot open checkpoint {}", options["checkpoint"]);
+                return -1;
+            }
+        }
+
+        BookManager itch_handler;
+        Checkpoint::Position position;
+        uint64_t timestamp_start = Timestamp::nano();
+        if (!Seek(itch_handler, file, index, checkpoint, timestamp,
+                  position)) {
+            fmt::print("Invalid checkpoint {}", options["checkpoint"]);
+            return -1;
+        }
+        uint64_t timestamp_stop = Timestamp::nano();
+
+        fmt::print("Reached offset {}, message {}", position.offset,
+                   position.sequence);
+        Report(itch_handler, timestamp_stop - timestamp_start);
+        return 0;
     }
-    uint64_t timestamp_stop = Timestamp::nano();
 
-    fmt::print("Done!");
+    const int threads = options.get("threads");
+    fmt::print("ITCH processing...");
 
-    fmt::print("Errors:");
+    if (threads > 1) {
+        ShardedReplay itch_handler(threads);
+        itch_handler.set_rebalance_interval(
+            static_cast<int>(options.get("rebalance")));
 
-    size_t total_messages = itch_handler.messages();
+        uint64_t timestamp_start = Timestamp::nano();
+        Replay(itch_handler, file, reader.get());
+        itch_handler.Flush();
+        uint64_t timestamp_stop = Timestamp::nano();
 
-    // TODO ReportConsole::GenerateTimePeriod
-    // TODO OnMessage to handle messages override
-    fmt::print("Processing Time: {}", Utils::ReportConsole::GenerateTimePeriod(
-                                          timestamp_stop - timestamp_start));
+        fmt::print("Done!");
+        Report(itch_handler, timestamp_stop - timestamp_start);
+    } else if (options.get("latency")) {
+        BookManager manager;
+        LatencyProfile profile;
+        ProfiledReplay<> itch_handler(manager, profile);
 
-    fmt::print("Total ITCH messages: {}", total_messages);
+        uint64_t timestamp_start = Timestamp::nano();
+        Replay(itch_handler, file, reader.get());
+        uint64_t timestamp_stop = Timestamp::nano();
 
-    fmt::print("ITCH message latency: {}",
-               Utils::ReportConsole::GenerateTimePeriod(
-                   (timestamp_stop - timestamp_start) / total_messages));
-    fmt::print(
-        "ITCH message throughput: {} msg/s",
-        total_messages * 1000000000 / (timestamp_stop - timestamp_start));
+        fmt::print("Done!");
+        Report(itch_handler, timestamp_stop - timestamp_start);
+        ReportLatency(profile);
+    } else if (options.get("pipeline")) {
+        BookPipeline<> itch_handler;
+
+        uint64_t timestamp_start = Timestamp::nano();
+        Replay(itch_handler, file, reader.get());
+        itch_handler.Flush();
+        uint64_t timestamp_stop = Timestamp::nano();
+
+        fmt::print("Done!");
+        Report(itch_handler, timestamp_stop - timestamp_start);
+    } else {
+        BookManager itch_handler;
+
+        uint64_t timestamp_start = Timestamp::nano();
+        Replay(itch_handler, file, reader.get());
+        uint64_t timestamp_stop = Timestamp::nano();
+
+        fmt::print("Done!");
+        Report(itch_handler, timestamp_stop - timestamp_start);
+    }
 
     return 0;
 }
@@ -0,0 +1,253 @@
+#include "manager.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+BookManager::BookManager(const Utils::Price tick_size,
+                         const std::size_t ladder_span,
+                         const std::size_t expected_orders)
+    : tick_size(tick_size),
+      ladder_span(ladder_span),
+      expected_orders(expected_orders),
+      books(max_books),
+      symbols(max_books) {}
+
+std::unique_ptr<Book> BookManager::release_book(const uint16_t locate) {
+    if (books[locate]) --count;
+    return std::move(books[locate]);
+}
+
+void BookManager::adopt_book(const uint16_t locate, std::unique_ptr<Book> book,
+                             const char* symbol) {
+    if (books[locate]) --count;
+    if (book) ++count;
+    books[locate] = std::move(book);
+    std::memcpy(symbols[locate].data(), symbol, symbols[locate].size());
+}
+
+std::size_t BookManager::order_count() const {
+    std::size_t orders = 0;
+    for (const auto& book : books) {
+        if (book) orders += book->get_order_count();
+    }
+    return orders;
+}
+
+std::size_t BookManager::memory_usage() const {
+    std::size_t memory = books.capacity() * sizeof(books[0]) +
+                         symbols.capacity() * sizeof(symbols[0]);
+    for (const auto& book : books) {
+        if (book) memory += book->get_memory_usage();
+    }
+    return memory;
+}
+
+std::size_t BookManager::memory_usage(const uint16_t locate) const {
+    return books[locate] ? books[locate]->get_memory_usage() : 0;
+}
+
+std::size_t BookManager::checkpoint(
+    std::vector<uint8_t>& buffer,
+    const Checkpoint::Position& position) const {
+    const std::size_t start = buffer.size();
+
+    Checkpoint::ManagerHeader header{};
+    std::memcpy(header.magic, Checkpoint::manager_magic, sizeof(header.magic));
+    header.version = Checkpoint::version;
+    header.books = count;
+    header.position = position;
+    Checkpoint::Append(buffer, header);
+
+    for (std::size_t locate = 0; locate < books.size(); ++locate) {
+        if (!books[locate]) continue;
+
+        const std::size_t entry_offset = buffer.size();
+        Checkpoint::BookEntry entry{};
+        entry.locate = static_cast<uint16_t>(locate);
+        std::memset(entry.symbol, ' ', sizeof(entry.symbol));
+        std::memcpy(entry.symbol, symbols[locate].data(),
+                    std::strlen(symbols[locate].data()));
+        Checkpoint::Append(buffer, entry);
+
+        // the size of the book is only known once it is written
+        const uint64_t size = books[locate]->checkpoint(buffer, position);
+        std::memcpy(buffer.data() + entry_offset +
+                        offsetof(Checkpoint::BookEntry, size),
+                    &size, sizeof(size));
+    }
+
+    return buffer.size() - start;
+}
+
+std::size_t BookManager::restore(const void* data, const std::size_t size,
+                                 Checkpoint::Position* position) {
+    std::size_t offset = 0;
+    Checkpoint::ManagerHeader header;
+    if (!Checkpoint::Read(data, size, offset, header) ||
+        std::memcmp(header.magic, Checkpoint::manager_magic,
+                    sizeof(header.magic)) != 0 ||
+        header.version != Checkpoint::version) {
+        return 0;
+    }
+
+    for (auto& book : books) book.reset();
+    count = 0;
+
+    for (uint64_t i = 0; i < header.books; ++i) {
+        Checkpoint::BookEntry entry;
+        if (!Checkpoint::Read(data, size, offset, entry) ||
+            entry.size > size - offset) {
+            return 0;
+        }
+
+        add_book(entry.locate,
+                 std::string_view(entry.symbol, sizeof(entry.symbol)));
+        const uint8_t* book_data = static_cast<const uint8_t*>(data) + offset;
+        if (books[entry.locate]->restore(book_data, entry.size) !=
+            entry.size) {
+            return 0;
+        }
+        offset += entry.size;
+    }
+
+    if (position != nullptr) *position = header.position;
+    return offset;
+}
+
+bool BookManager::add_book(const uint16_t locate,
+                           const std::string_view symbol) {
+    auto& book = books[locate];
+    if (!book) {
+        book.reset(new Book(tick_size, ladder_span));
+        if (expected_orders != 0) book->reserve_orders(expected_orders);
+        ++count;
+    }
+
+    auto& stock = symbols[locate];
+    const std::size_t size = std::min(symbol.size(), stock.size() - 1);
+    std::memcpy(stock.data(), symbol.data(), size);
+    stock[size] = '\0';
+    return true;
+}
+
+bool BookManager::add_order(const uint16_t locate, const uint64_t reference,
+                            const Utils::Side side, const uint32_t shares,
+                            const uint32_t price) {
+    Book* book = books[locate].get();
+    if (book == nullptr) return false;
+
+    // the exchange reports resting orders, a locked or crossed add (e.g.
+    // before the opening cross) does not trade inside our book
+    return book->append_order(side, book->itch_to_ticks(price), shares,
+                              reference) != nullptr;
+}
+
+bool BookManager::execute(const uint16_t locate, const uint64_t reference,
+                          const uint32_t shares) {
+    Book* book = books[locate].get();
+    return book != nullptr && book->execute(reference, shares);
+}
+
+bool BookManager::execute(const uint16_t locate, const uint64_t reference,
+                          const uint32_t shares, const uint32_t price,
+                          const bool printable) {
+    Book* book = books[locate].get();
+    return book != nullptr && book->execute(reference, shares,
+                                            book->itch_to_ticks(price),
+                                            printable);
+}
+
+bool BookManager::cancel(const uint16_t locate, const uint64_t reference,
+                         const uint32_t shares) {
+    Book* book = books[locate].get();
+    return book != nullptr && book->cancel(reference, shares);
+}
+
+bool BookManager::remove(const uint16_t locate, const uint64_t reference) {
+    Book* book = books[locate].get();
+    return book != nullptr && book->remove(reference);
+}
+
+bool BookManager::replace(const uint16_t locate, const uint64_t reference,
+                          const uint64_t new_reference, const uint32_t shares,
+                          const uint32_t price) {
+    Book* book = books[locate].get();
+    return book != nullptr &&
+           book->replace(reference, new_reference, book->itch_to_ticks(price),
+                         shares, true) != nullptr;
+}
+
+bool BookManager::Apply(const BookUpdate& update) {
+    switch (update.type) {
+        case 'R':
+            return add_book(update.locate,
+                            std::string_view(update.symbol,
+                                             sizeof(update.symbol)));
+        case 'A':
+            return add_order(update.locate, update.reference,
+                             update.side == 'B' ? Utils::Side::bid
+                                                : Utils::Side::ask,
+                             update.shares, update.price);
+        case 'E':
+            return execute(update.locate, update.reference, update.shares);
+        case 'C':
+            return execute(update.locate, update.reference, update.shares,
+                           update.price, update.side != 'N');
+        case 'X':
+            return cancel(update.locate, update.reference, update.shares);
+        case 'D':
+            return remove(update.locate, update.reference);
+        case 'U':
+            return replace(update.locate, update.reference,
+                           update.new_reference, update.shares, update.price);
+        default:
+            return true;
+    }
+}
+
+bool BookManager::onMessage(
+    const MessageTypes::StockDirectoryMessage& message) {
+    return add_book(message.StockLocate(), message.Stock());
+}
+
+bool BookManager::onMessage(const MessageTypes::AddOrderMesssage& message) {
+    return add_order(message.StockLocate(), message.OrderReferenceNumber(),
+                     message.BuySellIndicator() == 'B' ? Utils::Side::bid
+                                                       : Utils::Side::ask,
+                     message.Shares(), message.Price());
+}
+
+bool BookManager::onMessage(
+    const MessageTypes::OrderExecutedMessage& message) {
+    return execute(message.StockLocate(), message.OrderReferenceNumber(),
+                   message.ExecutedShares());
+}
+
+bool BookManager::onMessage(
+    const MessageTypes::OrderExecutedWithPriceMessage& message) {
+    return execute(message.StockLocate(), message.OrderReferenceNumber(),
+                   message.ExecutedShares(), message.ExecutionPrice(),
+                   message.Printable() != 'N');
+}
+
+bool BookManager::onMessage(const MessageTypes::OrderCancelMessage& message) {
+    return cancel(message.StockLocate(), message.OrderReferenceNumber(),
+                  message.CanceledShares());
+}
+
+bool BookManager::onMessage(const MessageTypes::OrderDeleteMessage& message) {
+    return remove(message.StockLocate(), message.OrderReferenceNumber());
+}
+
+bool BookManager::onMessage(
+    const MessageTypes::OrderReplaceMessage& message) {
+    return replace(message.StockLocate(),
+                   message.OriginalOrderReferenceNumber(),
+                   message.NewOrderReferenceNumber(), message.Shares(),
+                   message.Price());
+}
+
+template class ITCHHandlerT<BookManager>;
@@ -0,0 +1,183 @@
+/*
+ * BookManager routes ITCH messages to one Book per instrument.
+ *
+ * Books are created lazily on Stock Directory ('R') messages and stored
+ * in a dense array indexed by the 16-bit StockLocate code, so routing a
+ * message is a single array access with no hashing.
+ *
+ * Messages are dispatched statically (see ITCHHandlerT). The same book
+ * operations are available from decoded BookUpdate records, e.g. when
+ * decoding and book maintenance run on different threads.
+ *
+ * Not thread-safe
+ */
+
+#ifndef MANAGER_HPP
+#define MANAGER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "book.hpp"
+#include "handler.hpp"
+
+/*
+ * @brief fixed-size record of the ITCH messages changing books. 'F' is
+ * recorded as 'A', prices keep the 4 implied decimals.
+ */
+struct BookUpdate {
+    char type;
+    // 'B' or 'S' for 'A', printable 'Y' or 'N' for 'C'
+    char side;
+    uint16_t locate;
+    uint32_t shares;
+    uint32_t price;
+    uint32_t reserved;
+    uint64_t reference;
+    union {
+        // new reference for 'U'
+        uint64_t new_reference;
+        // space padded symbol for 'R'
+        char symbol[8];
+    };
+};
+
+static_assert(sizeof(BookUpdate) == 32, "BookUpdate is 32 bytes");
+
+class BookManager : public ITCHHandlerT<BookManager> {
+   public:
+    static const std::size_t max_books = 1 << 16;
+
+    /*
+     * @brief Constructor
+     *
+     * @param tick_size, tick size of every book (see Book::Book)
+     * @param ladder_span, ladder span of every book (see Book::Book)
+     * @param expected_orders, resting orders expected per book, used to
+     * pre-size the order reference index of new books
+     */
+    explicit BookManager(const Utils::Price tick_size = 1,
+                         const std::size_t ladder_span = 4096,
+                         const std::size_t expected_orders = 0);
+
+    /*
+     * @brief get the book of a StockLocate code
+     *
+     * @return the book or nullptr if no directory message created it
+     */
+    inline Book *get_book(const uint16_t locate) const {
+        return books[locate].get();
+    }
+
+    /*
+     * @brief get the 8 characters symbol of a StockLocate code,
+     * padded with spaces as in the ITCH directory message
+     */
+    inline const char *get_symbol(const uint16_t locate) const {
+        return symbols[locate].data();
+    }
+
+    /*
+     * @brief detach the book of a StockLocate code, e.g. to move it to
+     * another manager. The symbol is kept.
+     *
+     * @return the book or nullptr
+     */
+    std::unique_ptr<Book> release_book(const uint16_t locate);
+
+    /*
+     * @brief attach a book released by another manager, replacing the
+     * book and the symbol of the StockLocate code
+     */
+    void adopt_book(const uint16_t locate, std::unique_ptr<Book> book,
+                    const char *symbol);
+
+    /*
+     * @brief book operations of the ITCH messages, prices with 4 implied
+     * decimals. add_book() creates the book of a StockLocate code if
+     * needed, the other ones fail if it does not exist.
+     *
+     * @return true on success
+     */
+    bool add_book(const uint16_t locate, const std::string_view symbol);
+    bool add_order(const uint16_t locate, const uint64_t reference,
+                   const Utils::Side side, const uint32_t shares,
+                   const uint32_t price);
+    bool execute(const uint16_t locate, const uint64_t reference,
+                 const uint32_t shares);
+    bool execute(const uint16_t locate, const uint64_t reference,
+                 const uint32_t shares, const uint32_t price,
+                 const bool printable);
+    bool cancel(const uint16_t locate, const uint64_t reference,
+                const uint32_t shares);
+    bool remove(const uint16_t locate, const uint64_t reference);
+    bool replace(const uint16_t locate, const uint64_t reference,
+                 const uint64_t new_reference, const uint32_t shares,
+                 const uint32_t price);
+
+    // apply a decoded update
+    bool Apply(const BookUpdate &update);
+
+    /*
+     * @brief append a binary checkpoint of every book and its symbol to
+     * buffer, along with the stream position it corresponds to
+     * (see checkpoint.hpp)
+     *
+     * @return the size of the checkpoint in bytes
+     */
+    std::size_t checkpoint(std::vector<uint8_t> &buffer,
+                           const Checkpoint::Position &position = {}) const;
+
+    /*
+     * @brief replace every book by the books of a checkpoint, e.g. mapped
+     * from a file, and resume the stream from position
+     *
+     * @return the size of the checkpoint, 0 if it is invalid. Books
+     * restored before an invalid one was found are kept.
+     */
+    std::size_t restore(const void *data, const std::size_t size,
+                        Checkpoint::Position *position = nullptr);
+
+    // number of books created
+    inline std::size_t book_count() const { return count; }
+
+    // number of resting orders over every book
+    std::size_t order_count() const;
+
+    // approximate memory held by every book, in bytes
+    std::size_t memory_usage() const;
+
+    // approximate memory held by the book of a StockLocate code
+    std::size_t memory_usage(const uint16_t locate) const;
+
+   protected:
+    friend class ITCHHandlerT<BookManager>;
+
+    // message handlers, 'F' is handled as 'A' and other types are skipped
+    bool onMessage(const MessageTypes::StockDirectoryMessage& message);
+    bool onMessage(const MessageTypes::AddOrderMesssage& message);
+    bool onMessage(const MessageTypes::OrderExecutedMessage& message);
+    bool onMessage(const MessageTypes::OrderExecutedWithPriceMessage& message);
+    bool onMessage(const MessageTypes::OrderCancelMessage& message);
+    bool onMessage(const MessageTypes::OrderDeleteMessage& message);
+    bool onMessage(const MessageTypes::OrderReplaceMessage& message);
+
+   private:
+    const Utils::Price tick_size;
+    const std::size_t ladder_span;
+    const std::size_t expected_orders;
+
+    std::vector<std::unique_ptr<Book>> books;
+    std::vector<std::array<char, 9>> symbols;
+    std::size_t count = 0;
+};
+
+// the parse loop is instantiated in manager.cpp, next to the handlers it
+// inlines
+extern template class ITCHHandlerT<BookManager>;
+
+#endif
@@ -0,0 +1,348 @@
+/*
+ * NASDAQ ITCH 5.0 message views
+ *
+ * Every message type is a view over the bytes of a complete message:
+ * nothing is copied when a message is dispatched, and each accessor
+ * loads and byte-swaps its field from a fixed offset only when it is
+ * called. Views are only valid while the underlying buffer is.
+ *
+ * Offsets and lengths follow the NASDAQ TotalView-ITCH 5.0
+ * specification, the 2 bytes length prefix of the framing excluded.
+ */
+
+#ifndef MESSAGES_HPP
+#define MESSAGES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "utils.hpp"
+
+namespace MessageTypes {
+
+class Message {
+   protected:
+    const uint8_t* _data;
+
+    inline char Char(const std::size_t offset) const {
+        return static_cast<char>(_data[offset]);
+    }
+    inline uint16_t U16(const std::size_t offset) const {
+        return Utils::LoadBigEndian16(_data + offset);
+    }
+    inline uint32_t U32(const std::size_t offset) const {
+        return Utils::LoadBigEndian32(_data + offset);
+    }
+    inline uint64_t U64(const std::size_t offset) const {
+        return Utils::LoadBigEndian64(_data + offset);
+    }
+    // alpha fields are left justified and padded with spaces
+    inline std::string_view String(const std::size_t offset,
+                                   const std::size_t size) const {
+        return std::string_view(reinterpret_cast<const char*>(_data) + offset,
+                                size);
+    }
+
+   public:
+    explicit Message(const void* data)
+        : _data(static_cast<const uint8_t*>(data)) {}
+
+    inline const uint8_t* data() const { return _data; }
+
+    // header shared by every message type
+    inline char Type() const { return Char(0); }
+    inline uint16_t StockLocate() const { return U16(1); }
+    inline uint16_t TrackingNumber() const { return U16(3); }
+    // nanoseconds since midnight
+    inline uint64_t Timestamp() const {
+        return Utils::LoadBigEndian48(_data + 5);
+    }
+};
+
+struct SystemEventMessage : Message {
+    static constexpr char type = 'S';
+    static constexpr std::size_t length = 12;
+    using Message::Message;
+
+    inline char EventCode() const { return Char(11); }
+};
+
+struct StockDirectoryMessage : Message {
+    static constexpr char type = 'R';
+    static constexpr std::size_t length = 39;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char MarketCategory() const { return Char(19); }
+    inline char FinancialStatusIndicator() const { return Char(20); }
+    inline uint32_t RoundLotSize() const { return U32(21); }
+    inline char RoundLotsOnly() const { return Char(25); }
+    inline char IssueClassification() const { return Char(26); }
+    inline std::string_view IssueSubType() const { return String(27, 2); }
+    inline char Authenticity() const { return Char(29); }
+    inline char ShortSaleThresholdIndicator() const { return Char(30); }
+    inline char IPOFlag() const { return Char(31); }
+    inline char LULDReferencePriceTier() const { return Char(32); }
+    inline char ETPFlag() const { return Char(33); }
+    inline uint32_t ETPLeverageFactor() const { return U32(34); }
+    inline char InverseIndicator() const { return Char(38); }
+};
+
+struct StockTradingActionMessage : Message {
+    static constexpr char type = 'H';
+    static constexpr std::size_t length = 25;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char TradingState() const { return Char(19); }
+    inline char Reserved() const { return Char(20); }
+    inline std::string_view Reason() const { return String(21, 4); }
+};
+
+struct RegSHOMessage : Message {
+    static constexpr char type = 'Y';
+    static constexpr std::size_t length = 20;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char RegSHOAction() const { return Char(19); }
+};
+
+struct MarketParticipantPositionMessage : Message {
+    static constexpr char type = 'L';
+    static constexpr std::size_t length = 26;
+    using Message::Message;
+
+    inline std::string_view MPID() const { return String(11, 4); }
+    inline std::string_view Stock() const { return String(15, 8); }
+    inline char PrimaryMarketMaker() const { return Char(23); }
+    inline char MarketMakerMode() const { return Char(24); }
+    inline char MarketParticipantState() const { return Char(25); }
+};
+
+struct MWCBDeclineLevelMessage : Message {
+    static constexpr char type = 'V';
+    static constexpr std::size_t length = 35;
+    using Message::Message;
+
+    // prices with 8 implied decimals
+    inline uint64_t Level1() const { return U64(11); }
+    inline uint64_t Level2() const { return U64(19); }
+    inline uint64_t Level3() const { return U64(27); }
+};
+
+struct MWCBStatusMessage : Message {
+    static constexpr char type = 'W';
+    static constexpr std::size_t length = 12;
+    using Message::Message;
+
+    inline char BreachedLevel() const { return Char(11); }
+};
+
+struct IPOQuotingPeriodUpdateMessage : Message {
+    static constexpr char type = 'K';
+    static constexpr std::size_t length = 28;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    // seconds since midnight
+    inline uint32_t IPOQuotationReleaseTime() const { return U32(19); }
+    inline char IPOQuotationReleaseQualifier() const { return Char(23); }
+    inline uint32_t IPOPrice() const { return U32(24); }
+};
+
+struct LULDAuctionCollarMessage : Message {
+    static constexpr char type = 'J';
+    static constexpr std::size_t length = 35;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline uint32_t AuctionCollarReferencePrice() const { return U32(19); }
+    inline uint32_t UpperAuctionCollarPrice() const { return U32(23); }
+    inline uint32_t LowerAuctionCollarPrice() const { return U32(27); }
+    inline uint32_t AuctionCollarExtension() const { return U32(31); }
+};
+
+struct OperationalHaltMessage : Message {
+    static constexpr char type = 'h';
+    static constexpr std::size_t length = 21;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char MarketCode() const { return Char(19); }
+    inline char OperationalHaltAction() const { return Char(20); }
+};
+
+struct AddOrderMesssage : Message {
+    static constexpr char type = 'A';
+    static constexpr std::size_t length = 36;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+    inline char BuySellIndicator() const { return Char(19); }
+    inline uint32_t Shares() const { return U32(20); }
+    inline std::string_view Stock() const { return String(24, 8); }
+    inline uint32_t Price() const { return U32(32); }
+};
+
+// 'F' extends 'A' with the market participant attribution
+struct AddOrderMPIDAttributionMessage : AddOrderMesssage {
+    static constexpr char type = 'F';
+    static constexpr std::size_t length = 40;
+    using AddOrderMesssage::AddOrderMesssage;
+
+    inline std::string_view Attribution() const { return String(36, 4); }
+};
+
+struct OrderExecutedMessage : Message {
+    static constexpr char type = 'E';
+    static constexpr std::size_t length = 31;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+    inline uint32_t ExecutedShares() const { return U32(19); }
+    inline uint64_t MatchNumber() const { return U64(23); }
+};
+
+struct OrderExecutedWithPriceMessage : Message {
+    static constexpr char type = 'C';
+    static constexpr std::size_t length = 36;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+    inline uint32_t ExecutedShares() const { return U32(19); }
+    inline uint64_t MatchNumber() const { return U64(23); }
+    inline char Printable() const { return Char(31); }
+    inline uint32_t ExecutionPrice() const { return U32(32); }
+};
+
+struct OrderCancelMessage : Message {
+    static constexpr char type = 'X';
+    static constexpr std::size_t length = 23;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+    inline uint32_t CanceledShares() const { return U32(19); }
+};
+
+struct OrderDeleteMessage : Message {
+    static constexpr char type = 'D';
+    static constexpr std::size_t length = 19;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+};
+
+struct OrderReplaceMessage : Message {
+    static constexpr char type = 'U';
+    static constexpr std::size_t length = 35;
+    using Message::Message;
+
+    inline uint64_t OriginalOrderReferenceNumber() const { return U64(11); }
+    inline uint64_t NewOrderReferenceNumber() const { return U64(19); }
+    inline uint32_t Shares() const { return U32(27); }
+    inline uint32_t Price() const { return U32(31); }
+};
+
+struct TradeMessage : Message {
+    static constexpr char type = 'P';
+    static constexpr std::size_t length = 44;
+    using Message::Message;
+
+    inline uint64_t OrderReferenceNumber() const { return U64(11); }
+    inline char BuySellIndicator() const { return Char(19); }
+    inline uint32_t Shares() const { return U32(20); }
+    inline std::string_view Stock() const { return String(24, 8); }
+    inline uint32_t Price() const { return U32(32); }
+    inline uint64_t MatchNumber() const { return U64(36); }
+};
+
+struct CrossTradeMessage : Message {
+    static constexpr char type = 'Q';
+    static constexpr std::size_t length = 40;
+    using Message::Message;
+
+    inline uint64_t Shares() const { return U64(11); }
+    inline std::string_view Stock() const { return String(19, 8); }
+    inline uint32_t CrossPrice() const { return U32(27); }
+    inline uint64_t MatchNumber() const { return U64(31); }
+    inline char CrossType() const { return Char(39); }
+};
+
+struct BrokenTradeMessage : Message {
+    static constexpr char type = 'B';
+    static constexpr std::size_t length = 19;
+    using Message::Message;
+
+    inline uint64_t MatchNumber() const { return U64(11); }
+};
+
+struct NOIIMessage : Message {
+    static constexpr char type = 'I';
+    static constexpr std::size_t length = 50;
+    using Message::Message;
+
+    inline uint64_t PairedShares() const { return U64(11); }
+    inline uint64_t ImbalanceShares() const { return U64(19); }
+    inline char ImbalanceDirection() const { return Char(27); }
+    inline std::string_view Stock() const { return String(28, 8); }
+    inline uint32_t FarPrice() const { return U32(36); }
+    inline uint32_t NearPrice() const { return U32(40); }
+    inline uint32_t CurrentReferencePrice() const { return U32(44); }
+    inline char CrossType() const { return Char(48); }
+    inline char PriceVariationIndicator() const { return Char(49); }
+};
+
+struct RPIIMessage : Message {
+    static constexpr char type = 'N';
+    static constexpr std::size_t length = 20;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char InterestFlag() const { return Char(19); }
+};
+
+struct DirectListingWithCapitalRaiseMessage : Message {
+    static constexpr char type = 'O';
+    static constexpr std::size_t length = 48;
+    using Message::Message;
+
+    inline std::string_view Stock() const { return String(11, 8); }
+    inline char OpenEligibilityStatus() const { return Char(19); }
+    inline uint32_t MinimumAllowablePrice() const { return U32(20); }
+    inline uint32_t MaximumAllowablePrice() const { return U32(24); }
+    inline uint32_t NearExecutionPrice() const { return U32(28); }
+    inline uint64_t NearExecutionTime() const { return U64(32); }
+    inline uint32_t LowerPriceRangeCollar() const { return U32(40); }
+    inline uint32_t UpperPriceRangeCollar() const { return U32(44); }
+};
+
+/*
+ * @brief expected length of every message type, indexed by the type byte
+ * and 0 for types this decoder does not know
+ */
+template <class... Messages>
+struct LengthTable {
+    uint32_t length[256] = {};
+
+    constexpr LengthTable() {
+        ((length[static_cast<uint8_t>(Messages::type)] = Messages::length),
+         ...);
+    }
+};
+
+inline constexpr LengthTable<
+    SystemEventMessage, StockDirectoryMessage, StockTradingActionMessage,
+    RegSHOMessage, MarketParticipantPositionMessage, MWCBDeclineLevelMessage,
+    MWCBStatusMessage, IPOQuotingPeriodUpdateMessage, LULDAuctionCollarMessage,
+    OperationalHaltMessage, AddOrderMesssage, AddOrderMPIDAttributionMessage,
+    OrderExecutedMessage, OrderExecutedWithPriceMessage, OrderCancelMessage,
+    OrderDeleteMessage, OrderReplaceMessage, TradeMessage, CrossTradeMessage,
+    BrokenTradeMessage, NOIIMessage, RPIIMessage,
+    DirectListingWithCapitalRaiseMessage>
+    lengths{};
+
+}  // namespace MessageTypes
+
+#endif
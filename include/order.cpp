@@ -1,10 +1,16 @@
 #include "order.hpp"
 
+#include <algorithm>
+
+#include "book.hpp"
+
 /*
  * @brief Order class
  */
-Order::Order(const Utils::Side side, const double price, const double quantity,
-             const bool immediate_or_cancel, const bool all_or_nothing) {
+Order::Order(const Utils::Side side, const Utils::Price price,
+             const double quantity, const bool immediate_or_cancel,
+             const bool all_or_nothing, const uint64_t id) {
+    this->id = id;
     this->side = side;
     this->price = price;
     this->quantity = quantity;
@@ -12,10 +18,83 @@ Order::Order(const Utils::Side side, const double price, const double quantity,
     this->all_or_nothing = all_or_nothing;
 }
 
-double Order::get_price() const { return price; }
+void Order::on_accepted() {}
+void Order::on_queue() {}
+void Order::on_rejected() {}
+
+bool Order::cancel() {
+    if (!queued) {
+        return false;
+    }
+
+    // keep the order alive once the book releases its reference
+    const SharedOrderPtr order = queue_reference;
+    book->journal_command(Journal::Command::cancel, *this, quantity);
+    book->report(ExecutionReport::canceled, *this, quantity);
+    book->erase_order(this);
+    on_canceled();
+    return true;
+}
+
+Book *Order::get_book() const { return book; }
+uint64_t Order::get_id() const { return id; }
+Utils::Side Order::get_side() const { return side; }
+Utils::Price Order::get_price() const { return price; }
 double Order::get_quantity() const { return quantity; }
+
+void Order::set_quantity(const double quantity) {
+    resize(quantity);
+    if (queued) {
+        book->journal_command(Journal::Command::modify, *this, quantity);
+    }
+}
+
+void Order::resize(const double quantity) {
+    if (queued) {
+        OrderLimit *limit = book->limit_of(this);
+        if (all_or_nothing) {
+            limit->all_or_nothing_quantity += quantity - this->quantity;
+            book->unindex_all_or_nothing(this);
+            this->quantity = quantity;
+            book->index_all_or_nothing(this);
+        } else {
+            limit->quantity += quantity - this->quantity;
+            this->quantity = quantity;
+        }
+        book->update_depth(side, price);
+        return;
+    }
+    this->quantity = quantity;
+}
+
 bool Order::is_immediate_or_cancel() const { return immediate_or_cancel; }
 bool Order::is_all_or_nothing() const { return all_or_nothing; }
+
+void Order::set_all_or_nothing(const bool flag_all_or_nothing) {
+    if (flag_all_or_nothing == all_or_nothing) {
+        return;
+    }
+
+    if (queued) {
+        OrderLimit *limit = book->limit_of(this);
+        if (flag_all_or_nothing) {
+            book->enable_cumulative();
+            limit->quantity -= quantity;
+            limit->all_or_nothing_quantity += quantity;
+            limit->link_all_or_nothing(this);
+        } else {
+            limit->all_or_nothing_quantity -= quantity;
+            limit->quantity += quantity;
+            limit->unlink_all_or_nothing(this);
+        }
+        all_or_nothing = flag_all_or_nothing;
+        book->update_depth(side, price);
+        book->journal_command(Journal::Command::modify, *this, quantity);
+        return;
+    }
+    all_or_nothing = flag_all_or_nothing;
+}
+
 bool Order::is_queued() const { return queued; }
 
 /*
@@ -25,15 +104,278 @@ double OrderLimit::get_quantity() const { return quantity; }
 double OrderLimit::get_all_or_nothing_quantity() const {
     return all_or_nothing_quantity;
 }
-OrderLimit::~OrderLimit() {
-    for (auto &order : orders) {
+
+void OrderLimit::insert(Order *order) {
+    order->previous = tail;
+    order->next = nullptr;
+    if (tail != nullptr) {
+        tail->next = order;
+    } else {
+        head = order;
+    }
+    tail = order;
+    ++count;
+
+    if (order->all_or_nothing) {
+        all_or_nothing_quantity += order->quantity;
+        link_all_or_nothing(order);
+    } else {
+        quantity += order->quantity;
+    }
+}
+
+void OrderLimit::erase(Order *order) {
+    if (order->previous != nullptr) {
+        order->previous->next = order->next;
+    } else {
+        head = order->next;
+    }
+    if (order->next != nullptr) {
+        order->next->previous = order->previous;
+    } else {
+        tail = order->previous;
+    }
+    order->previous = nullptr;
+    order->next = nullptr;
+    --count;
+
+    if (order->all_or_nothing) {
+        all_or_nothing_quantity -= order->quantity;
+        unlink_all_or_nothing(order);
+    } else {
+        quantity -= order->quantity;
+    }
+}
+
+void OrderLimit::link_all_or_nothing(Order *order) {
+    order->all_or_nothing_previous = all_or_nothing_tail;
+    order->all_or_nothing_next = nullptr;
+    if (all_or_nothing_tail != nullptr) {
+        all_or_nothing_tail->all_or_nothing_next = order;
+    } else {
+        all_or_nothing_head = order;
+    }
+    all_or_nothing_tail = order;
+    ++all_or_nothing_count;
+    order->book->index_all_or_nothing(order);
+}
+
+void OrderLimit::unlink_all_or_nothing(Order *order) {
+    if (order->all_or_nothing_previous != nullptr) {
+        order->all_or_nothing_previous->all_or_nothing_next =
+            order->all_or_nothing_next;
+    } else {
+        all_or_nothing_head = order->all_or_nothing_next;
+    }
+    if (order->all_or_nothing_next != nullptr) {
+        order->all_or_nothing_next->all_or_nothing_previous =
+            order->all_or_nothing_previous;
+    } else {
+        all_or_nothing_tail = order->all_or_nothing_previous;
+    }
+    order->all_or_nothing_previous = nullptr;
+    order->all_or_nothing_next = nullptr;
+    --all_or_nothing_count;
+    order->book->unindex_all_or_nothing(order);
+}
+
+double OrderLimit::simulate_trade(const double quantity) const {
+    double quantity_remaining = quantity;
+
+    for (Order *order = head; order != nullptr && quantity_remaining > 0.0;
+         order = order->next) {
+        if (!order->all_or_nothing) {
+            quantity_remaining -= std::min(order->quantity, quantity_remaining);
+        } else if (order->quantity <= quantity_remaining) {
+            quantity_remaining -= order->quantity;
+        }
+    }
+
+    return quantity_remaining;
+}
+
+double OrderLimit::trade(ConstOrderPtr &order) {
+    double traded = 0.0;
+    Order *resting = head;
+    Book *book = order->book;
+
+    while (resting != nullptr && order->quantity > 0.0) {
+        Order *next = resting->next;
+
+        // all-or-nothing orders are skipped unless filled completely
+        if (resting->all_or_nothing && resting->quantity > order->quantity) {
+            resting = next;
+            continue;
+        }
+
+        const double fill = std::min(resting->quantity, order->quantity);
+        const bool filled = fill >= resting->quantity;
+
+        // a filled order is unlinked while it still carries its quantity,
+        // only orders that are not all-or-nothing are filled partially
+        if (filled) {
+            erase(resting);
+        } else {
+            quantity -= fill;
+        }
+        resting->quantity -= fill;
+        order->quantity -= fill;
+        traded += fill;
+
+        const SharedOrderPtr resting_order = resting->queue_reference;
+        if (filled) {
+            book->unindex_order(resting);
+            resting->queued = false;
+            resting->book = nullptr;
+            resting->queue_reference.reset();
+        }
+
+        book->report_fill(*order, resting_order->id, resting_order->price,
+                          fill);
+        order->on_traded(resting_order);
+        resting_order->on_traded(order);
+        resting = next;
+    }
+
+    return traded;
+}
+
+OrderLimit::OrderLimit(OrderLimit &&other) noexcept {
+    *this = std::move(other);
+}
+
+OrderLimit &OrderLimit::operator=(OrderLimit &&other) noexcept {
+    if (this != &other) {
+        release();
+        quantity = other.quantity;
+        all_or_nothing_quantity = other.all_or_nothing_quantity;
+        head = other.head;
+        tail = other.tail;
+        count = other.count;
+        all_or_nothing_head = other.all_or_nothing_head;
+        all_or_nothing_tail = other.all_or_nothing_tail;
+        all_or_nothing_count = other.all_or_nothing_count;
+
+        other.quantity = 0.0;
+        other.all_or_nothing_quantity = 0.0;
+        other.head = other.tail = nullptr;
+        other.all_or_nothing_head = other.all_or_nothing_tail = nullptr;
+        other.count = other.all_or_nothing_count = 0;
+    }
+    return *this;
+}
+
+void OrderLimit::release() {
+    Order *order = head;
+    while (order != nullptr) {
+        Order *next = order->next;
+        order->previous = order->next = nullptr;
+        order->all_or_nothing_previous = order->all_or_nothing_next = nullptr;
         order->book = nullptr;
         order->queued = false;
+        // may destroy the order, it must be the last access
+        order->queue_reference.reset();
+        order = next;
     }
+
+    head = tail = nullptr;
+    all_or_nothing_head = all_or_nothing_tail = nullptr;
+    count = all_or_nothing_count = 0;
+    quantity = all_or_nothing_quantity = 0.0;
 }
 
-std::size_t OrderLimit::order_count() const { return orders.size(); }
+OrderLimit::~OrderLimit() { release(); }
+
+std::size_t OrderLimit::get_order_count() const { return count; }
+std::size_t OrderLimit::order_count() const { return count; }
 std::size_t OrderLimit::all_or_nothing_order_count() const {
-    return all_or_nothing_iterators.size();
+    return all_or_nothing_count;
+}
+
+/*
+ * @brief Trigger class
+ */
+Trigger::Trigger(Utils::Side side, Utils::Price price)
+    : side(side), price(price) {}
+
+void Trigger::on_accepted() {}
+void Trigger::on_queued() {}
+void Trigger::on_rejected() {}
+void Trigger::on_triggered() {}
+void Trigger::on_canceled() {}
+
+Utils::Price Trigger::get_price() const { return price; }
+Utils::Side Trigger::get_side() const { return side; }
+Book *Trigger::get_book() { return book; }
+bool Trigger::is_queued() const { return queued; }
+
+void Trigger::set_price(Utils::Price new_price) {
+    if (!queued) {
+        price = new_price;
+        return;
+    }
+
+    const SharedTriggerPtr trigger = shared_from_this();
+    Book *owner = book;
+    owner->erase_trigger(this);
+    price = new_price;
+    if (side == Utils::Side::bid) {
+        owner->queue_bid_trigger(trigger);
+    } else {
+        owner->queue_ask_trigger(trigger);
+    }
+}
+
+bool Trigger::cancel() {
+    if (!queued) {
+        return false;
+    }
+
+    // keep the trigger alive once the book releases its reference
+    const SharedTriggerPtr trigger = shared_from_this();
+    book->erase_trigger(this);
+    book = nullptr;
+    on_canceled();
+    return true;
+}
+
+/*
+ * @brief TriggerLimit class
+ */
+std::list<SharedTriggerPtr>::iterator TriggerLimit::insert(
+    ConstTriggerPtr &trigger) {
+    return triggers.insert(triggers.end(), trigger);
 }
 
+void TriggerLimit::erase(Trigger *trigger) {
+    trigger->queued = false;
+    // may destroy the trigger, it must be the last access
+    triggers.erase(trigger->queue_position);
+}
+
+void TriggerLimit::trigger_all() {
+    std::list<SharedTriggerPtr> fired;
+    fired.swap(triggers);
+
+    for (auto &trigger : fired) {
+        trigger->queued = false;
+    }
+    for (auto &trigger : fired) {
+        trigger->book->report_trigger(*trigger);
+        trigger->on_triggered();
+        trigger->book = nullptr;
+    }
+}
+
+TriggerLimit::~TriggerLimit() {
+    for (auto &trigger : triggers) {
+        trigger->queued = false;
+        trigger->book = nullptr;
+    }
+}
+
+/*
+ * @brief Insertable class
+ */
+Insertable::Insertable(const SharedOrderPtr &order) : object(order) {}
+Insertable::Insertable(const SharedTriggerPtr &trigger) : object(trigger) {}
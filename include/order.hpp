@@ -15,10 +15,14 @@
 #include <cstddef>
 #include <list>
 #include <map>
+#include <memory>
 #include <variant>
 
 #include "utils.hpp"
 
+template <class Limit>
+class PriceLadder;
+
 class Order;
 class OrderLimit;
 class Trigger;
@@ -35,17 +39,35 @@ using ConstTriggerPtr = const SharedTriggerPtr;
  */
 class Order : public std::enable_shared_from_this<Order> {
    private:
+    // reference number, 0 when the order is not indexed by the book
+    uint64_t id = 0;
     Utils::Side side;
-    double price;
+    Utils::Price price;
     double quantity;
     bool immediate_or_cancel = false;
     bool all_or_nothing = false;
     bool queued = false;
     Book *book = nullptr;
 
-    // iterators to allocate order in book, cancel O(1)
-    std::map<double, OrderLimit>::iterator limit_iterator;
-    std::list<SharedOrderPtr>::iterator order_iterator;
+    // intrusive links of the price level FIFO, cancel O(1).
+    // The level itself is found from the price through the book ladder.
+    Order *previous = nullptr;
+    Order *next = nullptr;
+
+    // intrusive links of the all-or-nothing chain of the price level
+    Order *all_or_nothing_previous = nullptr;
+    Order *all_or_nothing_next = nullptr;
+
+    // reference held by the book while the order is queued, so that
+    // queuing costs no allocation
+    SharedOrderPtr queue_reference;
+
+    /*
+     * @brief change the quantity, and the level of the order when it is
+     * queued, without journaling it: the book journals the commands
+     * reducing an order itself
+     */
+    void resize(const double quantity);
 
    protected:
     virtual void on_accepted();
@@ -55,25 +77,33 @@ class Order : public std::enable_shared_from_this<Order> {
     virtual void on_canceled(){};
 
    public:
-    // @brief Constructor
-    Order(const Utils::Side side, const double price, const double quantity,
-          const bool immediate_or_cancel = false,
-          const bool all_or_nothing = false);
+    /*
+     * @brief Constructor
+     *
+     * @param price, limit price in ticks of the book the order is
+     * inserted into (see Book::to_ticks)
+     * @param id, reference number under which the book indexes the
+     * order while it rests (0 to leave it unindexed)
+     */
+    Order(const Utils::Side side, const Utils::Price price,
+          const double quantity, const bool immediate_or_cancel = false,
+          const bool all_or_nothing = false, const uint64_t id = 0);
 
-    inline bool cancel();
+    bool cancel();
     /*
      * @brief get instance of book into which the order was inserted.
      * @return book* pointer to the book object or nullptr
      */
-    inline Book *get_book() const;
-    inline Utils::Side get_side() const;
-    inline double get_price() const;
-    inline double get_quantity() const;
-    inline void set_quantity(const double quantity);  // O(1) at best
-    inline bool is_immediate_or_cancel() const;
-    inline bool is_all_or_nothing() const;
-    inline void set_all_or_nothing(const bool flag_all_or_nothing);
-    inline bool is_queued() const;
+    Book *get_book() const;
+    uint64_t get_id() const;
+    Utils::Side get_side() const;
+    Utils::Price get_price() const;
+    double get_quantity() const;
+    void set_quantity(const double quantity);  // O(1) at best
+    bool is_immediate_or_cancel() const;
+    bool is_all_or_nothing() const;
+    void set_all_or_nothing(const bool flag_all_or_nothing);
+    bool is_queued() const;
 
     friend Book;
     friend OrderLimit;
@@ -84,15 +114,20 @@ class OrderLimit {
     double quantity = 0.0;
     double all_or_nothing_quantity = 0.0;
 
-    // order are stored as double-linked lists for O(1) cancel
-    std::list<SharedOrderPtr> orders;
+    // orders are stored as an intrusive double-linked list for O(1)
+    // cancel, the links live in Order so queuing allocates nothing
+    Order *head = nullptr;
+    Order *tail = nullptr;
+    std::size_t count = 0;
 
-    // all_or_nothing_iterators stores iterators to the all_or_nothing
-    // orders to be quickly looked up. When all-or-nothing orders
-    // are executed or canceled, their iterators must be deleted
-    // from the list
-    std::list<std::list<SharedOrderPtr>::iterator> all_or_nothing_iterators;
-    std::list<SharedOrderPtr>::iterator insert(ConstOrderPtr &order);
+    // all-or-nothing orders are additionally chained through their own
+    // intrusive links to be quickly looked up. When all-or-nothing orders
+    // are executed or canceled, they must be unlinked from the chain
+    Order *all_or_nothing_head = nullptr;
+    Order *all_or_nothing_tail = nullptr;
+    std::size_t all_or_nothing_count = 0;
+
+    void insert(Order *order);
 
     /*
      * @brief simulates the execution of an order with quantity
@@ -110,38 +145,85 @@ class OrderLimit {
      * @param order, the inbound order
      * @return the traded quantity
      */
-    inline double trade(ConstOrderPtr &order);
+    double trade(ConstOrderPtr &order);
     /*
      * @brief check if orders is empty in the limit order
      */
-    inline bool is_empty() const { return orders.empty(); }
-    void erase(const std::list<SharedOrderPtr>::iterator &order_iter);
+    inline bool is_empty() const { return head == nullptr; }
+
+    /*
+     * @brief unlink an order from the level and remove its remaining
+     * quantity. The queue reference of the order is left untouched.
+     */
+    void erase(Order *order);
+
+    void link_all_or_nothing(Order *order);
+    void unlink_all_or_nothing(Order *order);
 
    public:
+    /*
+     * @brief forward iterator over the queued orders in time priority
+     */
+    class iterator {
+       private:
+        Order *order;
+
+       public:
+        explicit iterator(Order *order) : order(order) {}
+
+        inline ConstOrderPtr &operator*() const {
+            return order->queue_reference;
+        }
+        inline ConstOrderPtr *operator->() const {
+            return &order->queue_reference;
+        }
+        inline iterator &operator++() {
+            order = order->next;
+            return *this;
+        }
+        inline bool operator==(const iterator &other) const {
+            return order == other.order;
+        }
+        inline bool operator!=(const iterator &other) const {
+            return order != other.order;
+        }
+    };
+
     /*
      * @brief get the non-all-or-none quantity at this price level.
      * This quantity can be filled partially.
      *
      * @return the non-all-or-none quantity at this price level
      */
-    inline double get_quantity() const;
+    double get_quantity() const;
     /*
      * @brief get the all-or-none quantity at this price level.
      *
      * @return the all-or-none quantity at this price level
      */
-    inline double get_all_or_nothing_quantity() const;
-    inline std::size_t get_order_count() const;
+    double get_all_or_nothing_quantity() const;
+    std::size_t get_order_count() const;
 
-    inline std::list<SharedOrderPtr>::iterator begin();
-    inline std::list<SharedOrderPtr>::iterator end();
-    inline std::size_t order_count() const;
-    inline std::size_t all_or_nothing_order_count() const;
+    inline iterator begin() const { return iterator(head); }
+    inline iterator end() const { return iterator(nullptr); }
+    std::size_t order_count() const;
+    std::size_t all_or_nothing_order_count() const;
 
     friend Order;
     friend Book;
 
+    // levels are moved between ladder slots when the ladder recentres
+    OrderLimit() = default;
+    OrderLimit(OrderLimit &&other) noexcept;
+    OrderLimit &operator=(OrderLimit &&other) noexcept;
     ~OrderLimit();
+
+   private:
+    // detach every queued order, used on destruction
+    void release();
+
+    template <class Limit>
+    friend class PriceLadder;
 };
 
 /*
@@ -155,10 +237,13 @@ class OrderLimit {
 class Trigger : public std::enable_shared_from_this<Trigger> {
    private:
     const Utils::Side side;
-    double price;
+    Utils::Price price;
     bool queued = false;
     Book *book = nullptr;
 
+    // position in the trigger level while queued, cancel O(1)
+    std::list<SharedTriggerPtr>::iterator queue_position;
+
    protected:
     virtual void on_accepted();
     virtual void on_queued();
@@ -167,15 +252,31 @@ class Trigger : public std::enable_shared_from_this<Trigger> {
     virtual void on_canceled();
 
    public:
-    inline double get_price() const;
-    inline void set_price(double new_price);
-    inline Utils::Side get_side() const;
+    Utils::Price get_price() const;
+    /*
+     * @brief move the trigger to another price, a queued trigger is
+     * requeued at the new price and may fire immediately
+     */
+    void set_price(Utils::Price new_price);
+    Utils::Side get_side() const;
 
-    Trigger(Utils::Side side, double price);
+    /*
+     * @brief Constructor
+     *
+     * @param price, trigger price in ticks of the book the trigger is
+     * inserted into (see Book::to_ticks)
+     */
+    Trigger(Utils::Side side, Utils::Price price);
+    virtual ~Trigger() = default;
 
-    inline Book *get_book();
-    inline bool cancel();
-    inline bool is_queued() const;
+    /*
+     * @brief get instance of book into which the trigger was inserted,
+     * still set while on_triggered() runs
+     * @return book* pointer to the book object or nullptr
+     */
+    Book *get_book();
+    bool cancel();
+    bool is_queued() const;
 
     friend Book;
     friend TriggerLimit;
@@ -193,18 +294,29 @@ class TriggerLimit {
     std::list<SharedTriggerPtr>::iterator insert(ConstTriggerPtr &trigger);
 
     inline bool is_empty() const { return triggers.empty(); }
+    void erase(Trigger *trigger);
+
+    /*
+     * @brief fire every trigger of the level in insertion order. The
+     * triggers are dequeued first, so that none of them can be canceled
+     * by the handler of another one.
+     */
     void trigger_all();
 
    public:
     /*
      * @brief: Get Iterator the first trigger in queue
      */
-    inline std::list<SharedTriggerPtr>::iterator begin();
+    inline std::list<SharedTriggerPtr>::iterator begin() {
+        return triggers.begin();
+    }
     /*
      * @brief: Get Iterator the end trigger in queue
      */
-    inline std::list<SharedTriggerPtr>::iterator end();
-    inline std::size_t trigger_count() const;
+    inline std::list<SharedTriggerPtr>::iterator end() {
+        return triggers.end();
+    }
+    inline std::size_t trigger_count() const { return triggers.size(); }
 
     friend Book;
     friend Trigger;
@@ -224,10 +336,18 @@ class Insertable {
     Insertable(const SharedOrderPtr &order);
     Insertable(const SharedTriggerPtr &trigger);
 
-    inline bool is_order() const;
-    inline bool is_trigger() const;
-
-    inline const SharedOrderPtr *get_order() const;
-    inline const SharedTriggerPtr *get_trigger() const;
+    inline bool is_order() const {
+        return std::holds_alternative<SharedOrderPtr>(object);
+    }
+    inline bool is_trigger() const {
+        return std::holds_alternative<SharedTriggerPtr>(object);
+    }
+
+    inline const SharedOrderPtr *get_order() const {
+        return std::get_if<SharedOrderPtr>(&object);
+    }
+    inline const SharedTriggerPtr *get_trigger() const {
+        return std::get_if<SharedTriggerPtr>(&object);
+    }
 };
 #endif
@@ -0,0 +1,153 @@
+/*
+ * OrderIndex header defines an open-addressing hash table from an order
+ * reference number to the resting Order.
+ *
+ * Entries are stored inline in a single power-of-two array (linear
+ * probing, backward-shift deletion), so lookups touch one or two cache
+ * lines and inserting or erasing an entry never allocates. The table
+ * only grows when the load factor exceeds 3/4; reserve() pre-sizes it
+ * from the expected number of resting orders.
+ *
+ * Reference 0 is reserved to mark empty slots.
+ *
+ * Not thread-safe
+ */
+
+#ifndef ORDER_INDEX_HPP
+#define ORDER_INDEX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Order;
+
+class OrderIndex {
+   private:
+    struct Entry {
+        uint64_t id = 0;
+        Order *order = nullptr;
+    };
+
+    std::vector<Entry> table;
+    std::size_t mask = 0;
+    std::size_t count = 0;
+
+    static inline std::size_t hash(const uint64_t id) {
+        // fibonacci hashing spreads sequential reference numbers
+        return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> 17);
+    }
+
+    void rehash(const std::size_t capacity) {
+        std::vector<Entry> old;
+        old.swap(table);
+        table.assign(capacity, Entry());
+        mask = capacity - 1;
+        count = 0;
+
+        for (const Entry &entry : old) {
+            if (entry.id != 0) {
+                insert(entry.id, entry.order);
+            }
+        }
+    }
+
+   public:
+    OrderIndex() { rehash(64); }
+
+    /*
+     * @brief pre-size the table for an expected number of orders
+     */
+    void reserve(const std::size_t expected) {
+        std::size_t capacity = 64;
+        while (capacity * 3 < expected * 4) {
+            capacity <<= 1;
+        }
+        if (capacity > table.size()) {
+            rehash(capacity);
+        }
+    }
+
+    inline std::size_t size() const { return count; }
+    inline std::size_t capacity() const { return table.size(); }
+    inline std::size_t get_memory_usage() const {
+        return table.capacity() * sizeof(Entry);
+    }
+
+    /*
+     * @brief insert the order of a reference number
+     *
+     * @return false if the reference number is already in use, the entry
+     * is then left as it is
+     */
+    inline bool insert(const uint64_t id, Order *order) {
+        if ((count + 1) * 4 > table.size() * 3) {
+            rehash(table.size() * 2);
+        }
+
+        std::size_t slot = hash(id) & mask;
+        while (table[slot].id != 0) {
+            if (table[slot].id == id) {
+                return false;
+            }
+            slot = (slot + 1) & mask;
+        }
+        ++count;
+        table[slot].id = id;
+        table[slot].order = order;
+        return true;
+    }
+
+    /*
+     * @return the order of a reference number or nullptr
+     */
+    inline Order *find(const uint64_t id) const {
+        std::size_t slot = hash(id) & mask;
+        while (table[slot].id != 0) {
+            if (table[slot].id == id) {
+                return table[slot].order;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    /*
+     * @brief erase a reference number, shifting back the following
+     * entries of the cluster so no tombstones are left behind
+     *
+     * @return true if the reference number was found
+     */
+    inline bool erase(const uint64_t id) {
+        std::size_t slot = hash(id) & mask;
+        while (table[slot].id != id) {
+            if (table[slot].id == 0) {
+                return false;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        std::size_t next = (slot + 1) & mask;
+        while (table[next].id != 0) {
+            const std::size_t home = hash(table[next].id) & mask;
+            // move the entry back unless its home lies in (slot, next]
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                table[slot] = table[next];
+                slot = next;
+            }
+            next = (next + 1) & mask;
+        }
+
+        table[slot] = Entry();
+        --count;
+        return true;
+    }
+
+    inline void clear() {
+        std::fill(table.begin(), table.end(), Entry());
+        count = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * BookPipeline splits the replay over two threads: the calling thread
+ * frames and decodes ITCH messages into BookUpdate records written in
+ * place into an SPSCRing, a consumer thread applies them to the books of
+ * its BookManager. Records are published every batch records and at the
+ * end of every Process() call.
+ *
+ * UpdateDecoder is the decoding stage on its own, handing records to any
+ * sink providing:
+ *  - BookUpdate& Next(), the record to fill
+ *  - void Commit(), once the record is filled
+ *
+ * The public methods of BookPipeline are meant to be called from a
+ * single thread.
+ */
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "handler.hpp"
+#include "manager.hpp"
+#include "ring.hpp"
+
+template <class Sink>
+class UpdateDecoder : public ITCHHandlerT<UpdateDecoder<Sink>> {
+   public:
+    explicit UpdateDecoder(Sink sink) : sink(sink) {}
+
+   private:
+    friend class ITCHHandlerT<UpdateDecoder<Sink>>;
+
+    Sink sink;
+
+    inline BookUpdate& Next(const char type, const uint16_t locate) {
+        BookUpdate& update = sink.Next();
+        update.type = type;
+        update.locate = locate;
+        return update;
+    }
+
+    inline bool onMessage(const MessageTypes::StockDirectoryMessage& message) {
+        BookUpdate& update = Next('R', message.StockLocate());
+        std::memcpy(update.symbol, message.Stock().data(),
+                    sizeof(update.symbol));
+        sink.Commit();
+        return true;
+    }
+
+    // 'F' included
+    inline bool onMessage(const MessageTypes::AddOrderMesssage& message) {
+        BookUpdate& update = Next('A', message.StockLocate());
+        update.side = message.BuySellIndicator();
+        update.reference = message.OrderReferenceNumber();
+        update.shares = message.Shares();
+        update.price = message.Price();
+        sink.Commit();
+        return true;
+    }
+
+    inline bool onMessage(const MessageTypes::OrderExecutedMessage& message) {
+        BookUpdate& update = Next('E', message.StockLocate());
+        update.reference = message.OrderReferenceNumber();
+        update.shares = message.ExecutedShares();
+        sink.Commit();
+        return true;
+    }
+
+    inline bool onMessage(
+        const MessageTypes::OrderExecutedWithPriceMessage& message) {
+        BookUpdate& update = Next('C', message.StockLocate());
+        update.side = message.Printable();
+        update.reference = message.OrderReferenceNumber();
+        update.shares = message.ExecutedShares();
+        update.price = message.ExecutionPrice();
+        sink.Commit();
+        return true;
+    }
+
+    inline bool onMessage(const MessageTypes::OrderCancelMessage& message) {
+        BookUpdate& update = Next('X', message.StockLocate());
+        update.reference = message.OrderReferenceNumber();
+        update.shares = message.CanceledShares();
+        sink.Commit();
+        return true;
+    }
+
+    inline bool onMessage(const MessageTypes::OrderDeleteMessage& message) {
+        BookUpdate& update = Next('D', message.StockLocate());
+        update.reference = message.OrderReferenceNumber();
+        sink.Commit();
+        return true;
+    }
+
+    inline bool onMessage(const MessageTypes::OrderReplaceMessage& message) {
+        BookUpdate& update = Next('U', message.StockLocate());
+        update.reference = message.OriginalOrderReferenceNumber();
+        update.new_reference = message.NewOrderReferenceNumber();
+        update.shares = message.Shares();
+        update.price = message.Price();
+        sink.Commit();
+        return true;
+    }
+};
+
+template <class Waiter = Ring::FutexWait>
+class BookPipeline {
+   public:
+    /*
+     * @brief Constructor, starts the consumer thread
+     *
+     * @param tick_size, ladder_span, expected_orders, forwarded to the
+     * BookManager (see BookManager::BookManager)
+     * @param capacity, records of the ring
+     * @param batch, records decoded before they are published
+     */
+    explicit BookPipeline(const Utils::Price tick_size = 1,
+                          const std::size_t ladder_span = 4096,
+                          const std::size_t expected_orders = 0,
+                          const std::size_t capacity = 1 << 16,
+                          const std::size_t batch = 64)
+        : manager(tick_size, ladder_span, expected_orders),
+          ring(capacity),
+          decoder(Sink{this}),
+          batch(batch) {
+        consumer = std::thread([this] { Run(); });
+    }
+
+    BookPipeline(const BookPipeline& pipeline) = delete;
+    BookPipeline& operator=(const BookPipeline& pipeline) = delete;
+
+    ~BookPipeline() {
+        ring.Close();
+        consumer.join();
+    }
+
+    inline bool Process(const void* buffer, const std::size_t size) {
+        decoder.Process(buffer, size);
+        Publish();
+        return true;
+    }
+
+    /*
+     * @brief wait until every decoded record is applied, books and
+     * counters are only consistent after a flush
+     */
+    inline void Flush() {
+        Publish();
+        while (!ring.empty()) {
+            std::this_thread::yield();
+        }
+    }
+
+    inline const BookManager& get_manager() const { return manager; }
+    inline Book* get_book(const uint16_t locate) const {
+        return manager.get_book(locate);
+    }
+
+    inline std::size_t messages() const { return decoder.messages(); }
+    // messages failing to decode or to apply
+    inline std::size_t errors() const { return decoder.errors() + failed; }
+    inline std::size_t book_count() const { return manager.book_count(); }
+    inline std::size_t order_count() const { return manager.order_count(); }
+    inline std::size_t memory_usage() const {
+        return manager.memory_usage() + ring.capacity() * sizeof(BookUpdate);
+    }
+
+   private:
+    struct Sink {
+        BookPipeline* pipeline;
+
+        inline BookUpdate& Next() { return pipeline->ring.Next(); }
+        inline void Commit() {
+            if (++pipeline->pending == pipeline->batch) pipeline->Publish();
+        }
+    };
+
+    BookManager manager;
+    SPSCRing<BookUpdate, Waiter> ring;
+    UpdateDecoder<Sink> decoder;
+    std::thread consumer;
+
+    const std::size_t batch;
+    // records decoded and not published yet, producer only
+    std::size_t pending = 0;
+    // updates failing to apply, consumer only
+    std::size_t failed = 0;
+
+    inline void Publish() {
+        ring.Publish();
+        pending = 0;
+    }
+
+    void Run() {
+        while (ring.Wait()) {
+            ring.Consume([this](const BookUpdate& update) {
+                if (!manager.Apply(update)) ++failed;
+            });
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * Pool header defines slab allocation for Order and Trigger objects:
+ *  - SlabArena, fixed-size blocks carved out of large slabs
+ *  - SlabPool, one arena per size class
+ *  - PoolAllocator, standard allocator over a SlabPool
+ *
+ * Objects are created with std::allocate_shared and a PoolAllocator, so
+ * the object and its shared_ptr control block share a single block.
+ * Freed blocks go to a per-arena free list and are reused first. The
+ * allocator stored in every control block shares the ownership of the
+ * pool, which is released with the last object allocated from it.
+ *
+ * reset() rewinds every arena at once without visiting the blocks: it is
+ * meant for end-of-session teardown, once no pointer into the pool is
+ * used anymore. Destructors of objects still alive are not run.
+ *
+ * Not thread-safe
+ */
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+class SlabArena {
+   private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct Slab {
+        char *memory;
+        std::size_t blocks;
+    };
+
+    // slabs double in size from first_slab_blocks up to slab_blocks, so
+    // that books holding a handful of orders stay small
+    static const std::size_t first_slab_blocks = 32;
+
+    std::size_t block_size = 0;
+    std::size_t slab_blocks = 0;
+
+    std::vector<Slab> slabs;
+    std::size_t current_slab = 0;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+
+    FreeBlock *free_list = nullptr;
+    std::size_t live = 0;
+
+    void next_slab() {
+        if (cursor != nullptr) {
+            ++current_slab;
+        }
+        if (current_slab == slabs.size()) {
+            std::size_t blocks = slabs.empty() ? first_slab_blocks
+                                               : slabs.back().blocks * 2;
+            if (blocks > slab_blocks) {
+                blocks = slab_blocks;
+            }
+            slabs.push_back(
+                {static_cast<char *>(::operator new(block_size * blocks)),
+                 blocks});
+        }
+        cursor = slabs[current_slab].memory;
+        limit = cursor + block_size * slabs[current_slab].blocks;
+    }
+
+   public:
+    SlabArena() = default;
+    SlabArena(const SlabArena &) = delete;
+    SlabArena &operator=(const SlabArena &) = delete;
+
+    inline void configure(const std::size_t block_size,
+                          const std::size_t slab_blocks) {
+        this->block_size = block_size;
+        this->slab_blocks = slab_blocks;
+    }
+
+    inline void *allocate() {
+        ++live;
+        if (free_list != nullptr) {
+            FreeBlock *block = free_list;
+            free_list = block->next;
+            return block;
+        }
+        if (cursor == limit) {
+            next_slab();
+        }
+        void *block = cursor;
+        cursor += block_size;
+        return block;
+    }
+
+    inline void deallocate(void *pointer) {
+        FreeBlock *block = static_cast<FreeBlock *>(pointer);
+        block->next = free_list;
+        free_list = block;
+        --live;
+    }
+
+    /*
+     * @brief rewind the arena, every block becomes free again.
+     * Slabs are kept for the next session.
+     */
+    inline void reset() {
+        free_list = nullptr;
+        current_slab = 0;
+        cursor = nullptr;
+        limit = nullptr;
+        live = 0;
+    }
+
+    inline std::size_t get_live() const { return live; }
+    inline std::size_t get_reserved() const {
+        std::size_t blocks = 0;
+        for (const Slab &slab : slabs) {
+            blocks += slab.blocks;
+        }
+        return blocks * block_size;
+    }
+
+    ~SlabArena() {
+        for (const Slab &slab : slabs) {
+            ::operator delete(slab.memory);
+        }
+    }
+};
+
+class SlabPool {
+   public:
+    static const std::size_t granularity = 16;
+    static const std::size_t max_block_size = 512;
+
+   private:
+    static const std::size_t classes = max_block_size / granularity;
+
+    SlabArena arenas[classes];
+    std::size_t live = 0;
+    std::size_t high_water = 0;
+
+    static inline std::size_t size_class(const std::size_t size) {
+        return (size + granularity - 1) / granularity - 1;
+    }
+
+   public:
+    /*
+     * @brief Constructor
+     *
+     * @param slab_blocks, largest number of blocks carved out of a slab
+     */
+    explicit SlabPool(const std::size_t slab_blocks = 4096) {
+        for (std::size_t i = 0; i < classes; ++i) {
+            arenas[i].configure((i + 1) * granularity, slab_blocks);
+        }
+    }
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    inline void *allocate(const std::size_t size) {
+        if (++live > high_water) {
+            high_water = live;
+        }
+        if (size > max_block_size) {
+            return ::operator new(size);
+        }
+        return arenas[size_class(size)].allocate();
+    }
+
+    inline void deallocate(void *pointer, const std::size_t size) {
+        --live;
+        if (size > max_block_size) {
+            ::operator delete(pointer);
+            return;
+        }
+        arenas[size_class(size)].deallocate(pointer);
+    }
+
+    /*
+     * @brief rewind every arena in O(number of size classes). Objects
+     * still alive are dropped without running their destructors.
+     */
+    inline void reset() {
+        for (auto &arena : arenas) {
+            arena.reset();
+        }
+        live = 0;
+    }
+
+    // number of objects currently allocated
+    inline std::size_t get_live() const { return live; }
+    // largest number of objects allocated at the same time
+    inline std::size_t get_high_water() const { return high_water; }
+    // bytes held by the slabs of every arena
+    inline std::size_t get_reserved() const {
+        std::size_t reserved = 0;
+        for (const auto &arena : arenas) {
+            reserved += arena.get_reserved();
+        }
+        return reserved;
+    }
+};
+
+/*
+ * @brief standard allocator over a SlabPool, to be used with
+ * std::allocate_shared. Rebinding to the shared_ptr control block keeps
+ * the same pool, and its ownership.
+ */
+template <class T>
+class PoolAllocator {
+   private:
+    std::shared_ptr<SlabPool> pool;
+
+    template <class U>
+    friend class PoolAllocator;
+
+   public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<SlabPool> pool) noexcept
+        : pool(std::move(pool)) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U> &other) noexcept
+        : pool(other.pool) {}
+
+    inline T *allocate(const std::size_t n) {
+        static_assert(alignof(T) <= SlabPool::granularity,
+                      "PoolAllocator does not support over-aligned types");
+        return static_cast<T *>(pool->allocate(n * sizeof(T)));
+    }
+
+    inline void deallocate(T *pointer, const std::size_t n) noexcept {
+        pool->deallocate(pointer, n * sizeof(T));
+    }
+
+    template <class U>
+    inline bool operator==(const PoolAllocator<U> &other) const noexcept {
+        return pool == other.pool;
+    }
+
+    template <class U>
+    inline bool operator!=(const PoolAllocator<U> &other) const noexcept {
+        return pool != other.pool;
+    }
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * ProfiledReplay replays an ITCH stream through a BookManager and
+ * records the latency of every stage of every message into a
+ * LatencyProfile, by message type:
+ *  - frame, reading the length prefix of the message
+ *  - decode, decoding the message into a BookUpdate (see UpdateDecoder)
+ *  - book, applying the update to the book (see BookManager::Apply)
+ *  - callbacks, running the callback given the applied update, only
+ *    recorded when a callback is given
+ *
+ * Stages are timed with Timestamp::rdts, a few ns per message on top of
+ * the regular processing. Frames may span consecutive blocks.
+ *
+ * Not thread-safe, profiles of replays running on several threads are
+ * merged with LatencyProfile::merge.
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "latency.hpp"
+#include "manager.hpp"
+#include "pipeline.hpp"
+#include "timestamp.hpp"
+#include "utils.hpp"
+
+struct NoCallback {
+    inline void operator()(const BookUpdate &) const {}
+};
+
+template <class Callback = NoCallback>
+class ProfiledReplay {
+   public:
+    ProfiledReplay(BookManager &manager, LatencyProfile &profile,
+                   Callback callback = Callback())
+        : manager(manager),
+          profile(profile),
+          callback(callback),
+          decoder(Sink{this}) {}
+
+    ProfiledReplay(const ProfiledReplay &replay) = delete;
+    ProfiledReplay &operator=(const ProfiledReplay &replay) = delete;
+
+    bool Process(const void *buffer, std::size_t size) {
+        const uint8_t *data = static_cast<const uint8_t *>(buffer);
+
+        // complete the frame left over by the previous block
+        if (!carry.empty()) {
+            const uint64_t start = Timestamp::rdts();
+            while (carry.size() < 2 && size > 0) {
+                carry.push_back(*data++);
+                --size;
+            }
+            if (carry.size() < 2) return true;
+
+            const std::size_t frame = 2 + Utils::LoadBigEndian16(carry.data());
+            const std::size_t tail = std::min(frame - carry.size(), size);
+            carry.insert(carry.end(), data, data + tail);
+            data += tail;
+            size -= tail;
+            if (carry.size() < frame) return true;
+
+            if (frame > 2) {
+                Handle(carry.data() + 2, frame - 2, start, Timestamp::rdts());
+            }
+            carry.clear();
+        }
+
+        while (size >= 2) {
+            const uint64_t start = Timestamp::rdts();
+            const std::size_t length = Utils::LoadBigEndian16(data);
+            if (size - 2 < length) break;
+
+            const uint8_t *message = data + 2;
+            data += 2 + length;
+            size -= 2 + length;
+            if (length != 0) {
+                Handle(message, length, start, Timestamp::rdts());
+            }
+        }
+        carry.assign(data, data + size);
+        return true;
+    }
+
+    inline std::size_t messages() const { return processed; }
+    // messages failing to decode or to apply
+    inline std::size_t errors() const { return failed; }
+    inline std::size_t book_count() const { return manager.book_count(); }
+    inline std::size_t order_count() const { return manager.order_count(); }
+    inline std::size_t memory_usage() const { return manager.memory_usage(); }
+
+   private:
+    struct Sink {
+        ProfiledReplay *replay;
+
+        inline BookUpdate &Next() {
+            replay->decoded = true;
+            return replay->update;
+        }
+        inline void Commit() {}
+    };
+
+    BookManager &manager;
+    LatencyProfile &profile;
+    Callback callback;
+    UpdateDecoder<Sink> decoder;
+
+    BookUpdate update;
+    // whether the last message decoded into an update
+    bool decoded = false;
+    // frame left incomplete at the end of the previous block
+    std::vector<uint8_t> carry;
+
+    std::size_t processed = 0;
+    std::size_t failed = 0;
+
+    inline void Handle(const uint8_t *message, const std::size_t length,
+                       const uint64_t start, const uint64_t framed) {
+        const char type = static_cast<char>(message[0]);
+        ++processed;
+        profile.record(LatencyProfile::frame, type, framed - start);
+
+        decoded = false;
+        const bool valid = decoder.ProcessMessage(message, length);
+        const uint64_t updated = Timestamp::rdts();
+        profile.record(LatencyProfile::decode, type, updated - framed);
+        if (!valid) {
+            ++failed;
+            return;
+        }
+        if (!decoded) return;
+
+        if (!manager.Apply(update)) ++failed;
+        const uint64_t applied = Timestamp::rdts();
+        profile.record(LatencyProfile::book, type, applied - updated);
+
+        if constexpr (!std::is_same<Callback, NoCallback>::value) {
+            callback(static_cast<const BookUpdate &>(update));
+            profile.record(LatencyProfile::callbacks, type,
+                           Timestamp::rdts() - applied);
+        }
+    }
+};
+
+#endif
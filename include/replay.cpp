@@ -0,0 +1,257 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+ShardedReplay::ShardedReplay(const std::size_t workers,
+                             const Utils::Price tick_size,
+                             const std::size_t ladder_span,
+                             const std::size_t expected_orders)
+    : shards(BookManager::max_books), load(BookManager::max_books) {
+    const std::size_t count = std::max<std::size_t>(workers, 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        this->workers.emplace_back(new Worker());
+        this->workers.back()->manager.reset(
+            new BookManager(tick_size, ladder_span, expected_orders));
+    }
+    for (std::size_t locate = 0; locate < shards.size(); ++locate) {
+        shards[locate] = static_cast<uint16_t>(locate % count);
+    }
+    for (auto &worker : this->workers) {
+        Worker *pointer = worker.get();
+        worker->thread = std::thread([this, pointer] { Run(*pointer); });
+    }
+}
+
+ShardedReplay::~ShardedReplay() {
+    Flush();
+    for (auto &worker : workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stop = true;
+        }
+        worker->ready.notify_one();
+    }
+    for (auto &worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void ShardedReplay::Run(Worker &worker) {
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    for (;;) {
+        worker.ready.wait(lock,
+                          [&] { return worker.stop || !worker.queue.empty(); });
+        if (worker.queue.empty()) return;
+
+        std::vector<uint8_t> batch = std::move(worker.queue.front());
+        worker.queue.pop_front();
+        worker.busy = true;
+        lock.unlock();
+
+        worker.manager->Process(batch.data(), batch.size());
+        batch.clear();
+
+        lock.lock();
+        worker.spare.push_back(std::move(batch));
+        worker.busy = false;
+        worker.drained.notify_one();
+    }
+}
+
+void ShardedReplay::Publish(Worker &worker) {
+    if (worker.batch.empty()) return;
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.drained.wait(
+            lock, [&] { return worker.queue.size() < max_queued; });
+        worker.queue.push_back(std::move(worker.batch));
+        worker.batch.clear();
+        // reuse a batch processed by the worker
+        if (!worker.spare.empty()) {
+            worker.batch = std::move(worker.spare.back());
+            worker.spare.pop_back();
+        }
+    }
+    worker.ready.notify_one();
+}
+
+void ShardedReplay::Append(Worker &worker, const uint8_t *message,
+                           const std::size_t length) {
+    if (worker.batch.capacity() == 0) worker.batch.reserve(batch_bytes);
+    worker.batch.push_back(static_cast<uint8_t>(length >> 8));
+    worker.batch.push_back(static_cast<uint8_t>(length));
+    worker.batch.insert(worker.batch.end(), message, message + length);
+    if (worker.batch.size() >= batch_bytes) Publish(worker);
+}
+
+void ShardedReplay::Route(const uint8_t *message, const std::size_t length) {
+    ++routed;
+    // too short to carry a StockLocate code, left to the first worker
+    if (length < 3) {
+        Append(*workers[0], message, length);
+        return;
+    }
+
+    const uint16_t locate = Utils::LoadBigEndian16(message + 1);
+    if (locate == 0) {
+        for (auto &worker : workers) {
+            Append(*worker, message, length);
+        }
+        return;
+    }
+
+    ++load[locate];
+    Append(*workers[shards[locate]], message, length);
+
+    if (rebalance_interval != 0 && routed >= next_rebalance) {
+        Rebalance();
+    }
+}
+
+bool ShardedReplay::Process(const void *buffer, std::size_t size) {
+    const uint8_t *data = static_cast<const uint8_t *>(buffer);
+
+    // complete the frame left over by the previous block
+    if (!carry.empty()) {
+        while (carry.size() < 2 && size > 0) {
+            carry.push_back(*data++);
+            --size;
+        }
+        if (carry.size() < 2) return true;
+
+        const std::size_t frame = 2 + Utils::LoadBigEndian16(carry.data());
+        const std::size_t tail = std::min(frame - carry.size(), size);
+        carry.insert(carry.end(), data, data + tail);
+        data += tail;
+        size -= tail;
+        if (carry.size() < frame) return true;
+
+        if (frame > 2) Route(carry.data() + 2, frame - 2);
+        carry.clear();
+    }
+
+    for (;;) {
+        const std::size_t block = size;
+        const std::size_t consumed = indexer.Index(data, size);
+        for (std::size_t i = 0; i < indexer.size(); ++i) {
+            Route(data + indexer[i].offset, indexer[i].length);
+        }
+        data += consumed;
+        size -= consumed;
+
+        // blocks larger than the indexer limit are indexed in parts
+        if (block <= FrameIndexer::max_block || consumed == 0) break;
+    }
+    carry.assign(data, data + size);
+    return true;
+}
+
+void ShardedReplay::Flush() {
+    for (auto &worker : workers) {
+        Publish(*worker);
+    }
+    for (auto &worker : workers) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->drained.wait(
+            lock, [&] { return worker->queue.empty() && !worker->busy; });
+    }
+}
+
+void ShardedReplay::Move(const uint16_t locate, const std::size_t worker) {
+    const std::size_t current = shards[locate];
+    if (current == worker) return;
+
+    BookManager &from = *workers[current]->manager;
+    BookManager &to = *workers[worker]->manager;
+    std::unique_ptr<Book> book = from.release_book(locate);
+    if (book) {
+        std::array<char, 9> symbol;
+        std::copy_n(from.get_symbol(locate), symbol.size(), symbol.begin());
+        to.adopt_book(locate, std::move(book), symbol.data());
+    }
+    shards[locate] = static_cast<uint16_t>(worker);
+}
+
+void ShardedReplay::assign(const uint16_t locate, const std::size_t worker) {
+    if (worker >= workers.size()) return;
+    Flush();
+    Move(locate, worker);
+}
+
+std::size_t ShardedReplay::Rebalance() {
+    next_rebalance = routed + rebalance_interval;
+
+    // load of every worker under the current assignment
+    std::vector<uint64_t> assigned(workers.size());
+    std::vector<uint16_t> active;
+    uint64_t total = 0;
+    for (std::size_t locate = 1; locate < load.size(); ++locate) {
+        if (load[locate] == 0) continue;
+        active.push_back(static_cast<uint16_t>(locate));
+        assigned[shards[locate]] += load[locate];
+        total += load[locate];
+    }
+    const double limit = static_cast<double>(total) / workers.size() *
+                         (1.0 + rebalance_threshold);
+
+    std::size_t moved = 0;
+    if (*std::max_element(assigned.begin(), assigned.end()) > limit) {
+        std::sort(active.begin(), active.end(),
+                  [this](const uint16_t a, const uint16_t b) {
+                      return load[a] > load[b];
+                  });
+
+        // the hottest codes of the overloaded workers move to the least
+        // loaded one, as long as the move lowers the busier of the two
+        for (const uint16_t locate : active) {
+            const std::size_t from = shards[locate];
+            if (assigned[from] <= limit) continue;
+            const std::size_t to =
+                std::min_element(assigned.begin(), assigned.end()) -
+                assigned.begin();
+            if (assigned[to] + load[locate] >= assigned[from]) continue;
+
+            if (moved++ == 0) Flush();
+            assigned[from] -= load[locate];
+            assigned[to] += load[locate];
+            Move(locate, to);
+        }
+    }
+
+    std::fill(load.begin(), load.end(), 0);
+    return moved;
+}
+
+std::size_t ShardedReplay::errors() const {
+    std::size_t errors = 0;
+    for (const auto &worker : workers) {
+        errors += worker->manager->errors();
+    }
+    return errors;
+}
+
+std::size_t ShardedReplay::book_count() const {
+    std::size_t books = 0;
+    for (const auto &worker : workers) {
+        books += worker->manager->book_count();
+    }
+    return books;
+}
+
+std::size_t ShardedReplay::order_count() const {
+    std::size_t orders = 0;
+    for (const auto &worker : workers) {
+        orders += worker->manager->order_count();
+    }
+    return orders;
+}
+
+std::size_t ShardedReplay::memory_usage() const {
+    std::size_t memory = 0;
+    for (const auto &worker : workers) {
+        memory += worker->manager->memory_usage();
+    }
+    return memory;
+}
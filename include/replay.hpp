@@ -0,0 +1,168 @@
+/*
+ * ShardedReplay replays an ITCH stream over several worker threads.
+ *
+ * The calling thread frames the stream (see FrameIndexer) and routes
+ * every message by its StockLocate code to the worker owning the book,
+ * each worker running its own BookManager. Messages of a StockLocate
+ * code always go to the same worker through a FIFO queue, so the order
+ * of the messages of every instrument is preserved. Messages with
+ * StockLocate 0 (system events, market wide circuit breakers) are
+ * broadcast to every worker.
+ *
+ * Messages are copied, length prefix included, into per-worker batches,
+ * which workers process with the regular framing loop. Queues are
+ * bounded: the reader waits for a worker that falls behind.
+ *
+ * StockLocate codes are assigned round-robin by default, assign() sets
+ * the worker of a code before the replay, and with a rebalance interval
+ * the busiest codes of overloaded workers periodically move to the least
+ * loaded ones, their books moving between workers once every queue is
+ * drained.
+ *
+ * The public methods are meant to be called from a single thread.
+ */
+
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frames.hpp"
+#include "manager.hpp"
+
+class ShardedReplay {
+   public:
+    /*
+     * @brief Constructor, starts the worker threads
+     *
+     * @param workers, number of worker threads, at least 1
+     * @param tick_size, ladder_span, expected_orders, forwarded to the
+     * BookManager of every worker (see BookManager::BookManager)
+     */
+    explicit ShardedReplay(const std::size_t workers,
+                           const Utils::Price tick_size = 1,
+                           const std::size_t ladder_span = 4096,
+                           const std::size_t expected_orders = 0);
+    ShardedReplay(const ShardedReplay &replay) = delete;
+    ShardedReplay &operator=(const ShardedReplay &replay) = delete;
+
+    // drains the queues and joins the workers
+    ~ShardedReplay();
+
+    /*
+     * @brief route the messages of a block of the stream, frames may span
+     * consecutive blocks
+     */
+    bool Process(const void *buffer, std::size_t size);
+
+    /*
+     * @brief hand every pending message to the workers and wait until
+     * they are processed. Books and counters are only consistent after
+     * a flush.
+     */
+    void Flush();
+
+    /*
+     * @brief move a StockLocate code, and its book if any, to a worker
+     */
+    void assign(const uint16_t locate, const std::size_t worker);
+
+    /*
+     * @brief rebalance the busiest StockLocate codes every interval
+     * messages, 0 disables rebalancing
+     */
+    inline void set_rebalance_interval(const std::size_t interval) {
+        rebalance_interval = interval;
+    }
+
+    /*
+     * @brief imbalance tolerated before rebalancing, as a fraction of the
+     * mean load of the workers, 0.1 by default
+     */
+    inline void set_rebalance_threshold(const double threshold) {
+        rebalance_threshold = threshold;
+    }
+
+    /*
+     * @brief move load off the workers handling more than the mean number
+     * of messages since the last rebalance by more than the threshold.
+     * The current assignment is kept otherwise: the busiest codes of an
+     * overloaded worker move, one at a time, to the least loaded worker
+     * while it is still overloaded and the move lowers the busier of the
+     * two. Queues are only drained when a code moves.
+     *
+     * @return the number of StockLocate codes moved
+     */
+    std::size_t Rebalance();
+
+    inline std::size_t worker_count() const { return workers.size(); }
+    inline std::size_t worker_of(const uint16_t locate) const {
+        return shards[locate];
+    }
+    inline const BookManager &get_manager(const std::size_t worker) const {
+        return *workers[worker]->manager;
+    }
+    inline Book *get_book(const uint16_t locate) const {
+        return workers[shards[locate]]->manager->get_book(locate);
+    }
+
+    // number of messages routed, broadcast messages counted once
+    inline std::size_t messages() const { return routed; }
+    // number of messages failing to process, summed over the workers
+    std::size_t errors() const;
+    std::size_t book_count() const;
+    std::size_t order_count() const;
+    std::size_t memory_usage() const;
+
+   private:
+    // bytes of messages gathered before a batch is handed to a worker
+    static const std::size_t batch_bytes = 1 << 16;
+    // batches queued to a worker before the reader waits
+    static const std::size_t max_queued = 64;
+
+    struct Worker {
+        std::unique_ptr<BookManager> manager;
+        std::thread thread;
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable drained;
+        std::deque<std::vector<uint8_t>> queue;
+        std::vector<std::vector<uint8_t>> spare;
+        bool busy = false;
+        bool stop = false;
+
+        // batch being filled, only used by the reader
+        std::vector<uint8_t> batch;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<uint16_t> shards;
+    // messages per StockLocate code since the last rebalance
+    std::vector<uint64_t> load;
+
+    FrameIndexer indexer;
+    // frame left incomplete at the end of the previous block
+    std::vector<uint8_t> carry;
+
+    std::size_t routed = 0;
+    std::size_t rebalance_interval = 0;
+    std::size_t next_rebalance = 0;
+    double rebalance_threshold = 0.1;
+
+    void Run(Worker &worker);
+    void Route(const uint8_t *message, const std::size_t length);
+    void Append(Worker &worker, const uint8_t *message,
+                const std::size_t length);
+    void Publish(Worker &worker);
+    void Move(const uint16_t locate, const std::size_t worker);
+};
+
+#endif
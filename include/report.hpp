@@ -0,0 +1,48 @@
+/*
+ * Report header defines the execution reports a book can record:
+ *  - accepted / rejected, an order was validated or refused on insertion
+ *  - queued, an order rests in the book
+ *  - fill, an inbound order traded with a resting one
+ *  - canceled, quantity of an order was canceled
+ *  - triggered, a trigger fired
+ *
+ * Reports are plain records appended to a buffer of the book in event
+ * order, so that consumers can observe a book without subclassing Order
+ * or Trigger and handle the events of an insertion in a single loop.
+ * Orders are identified by their reference number, orders inserted
+ * without one report id 0.
+ */
+
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#include <cstdint>
+
+#include "utils.hpp"
+
+struct ExecutionReport {
+    enum Type : uint8_t {
+        accepted = 0,
+        rejected = 1,
+        queued = 2,
+        fill = 3,
+        canceled = 4,
+        triggered = 5
+    };
+
+    Type type;
+    // side of the order, of the inbound order for fills
+    Utils::Side side;
+    // reference number of the order, of the inbound order for fills and
+    // 0 for triggers or executions against a counterparty off the book
+    uint64_t id;
+    // reference number of the resting order of a fill, 0 otherwise
+    uint64_t maker_id;
+    // limit price of the order, trade price for fills, trigger price
+    Utils::Price price;
+    // quantity of the order, traded quantity for fills, canceled
+    // quantity for cancels
+    double quantity;
+};
+
+#endif
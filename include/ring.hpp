@@ -0,0 +1,253 @@
+/*
+ * SPSCRing is a bounded, lock-free ring buffer between one producer
+ * thread and one consumer thread.
+ *
+ * Records are written in place: the producer fills the slots returned by
+ * Next() and makes them visible with a single Publish(), the consumer
+ * handles every available record in Consume() and releases them with a
+ * single index update, so both sides pay one atomic store per batch.
+ * The producer and consumer indices, and the copy of the other side's
+ * index each one caches, live on separate cache lines.
+ *
+ * A side waiting for the other one uses the Waiter policy:
+ *  - SpinWait, busy-spins (yielding now and then), lowest latency when
+ *    both threads have their own core
+ *  - FutexWait, spins briefly then sleeps on a futex, the other side only
+ *    makes a system call when someone sleeps
+ *
+ * Thread-safe for one producer and one consumer
+ */
+
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace Ring {
+
+static const std::size_t cache_line = 64;
+
+inline void Pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+class SpinWait {
+   public:
+    template <class Ready>
+    inline void wait(Ready ready) {
+        for (uint32_t spins = 1; !ready(); ++spins) {
+            if (spins % 1024 == 0) {
+                std::this_thread::yield();
+            } else {
+                Pause();
+            }
+        }
+    }
+
+    inline void notify() {}
+};
+
+class FutexWait {
+   public:
+    static const uint32_t spins = 256;
+
+    template <class Ready>
+    inline void wait(Ready ready) {
+        for (uint32_t i = 0; i < spins; ++i) {
+            if (ready()) return;
+            Pause();
+        }
+        for (;;) {
+            const uint32_t current = epoch.load(std::memory_order_acquire);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            if (ready()) {
+                sleepers.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            Sleep(current);
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            if (ready()) return;
+        }
+    }
+
+    // pairs with the sleepers increment of wait()
+    inline void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            Wake();
+        }
+    }
+
+   private:
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> sleepers{0};
+
+    inline void Sleep(const uint32_t current) {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch),
+                FUTEX_WAIT_PRIVATE, current, nullptr, nullptr, 0);
+#else
+        if (epoch.load(std::memory_order_acquire) == current) {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    inline void Wake() {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch),
+                FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+    }
+};
+
+}  // namespace Ring
+
+template <class T, class Waiter = Ring::SpinWait>
+class SPSCRing {
+   public:
+    /*
+     * @brief Constructor
+     *
+     * @param capacity, number of records, rounded up to a power of two
+     */
+    explicit SPSCRing(const std::size_t capacity = 4096) {
+        std::size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        slots.reset(new T[size]);
+    }
+
+    SPSCRing(const SPSCRing& ring) = delete;
+    SPSCRing& operator=(const SPSCRing& ring) = delete;
+
+    inline std::size_t capacity() const { return mask + 1; }
+
+    // producer
+
+    /*
+     * @brief get the next slot to write, waiting for the consumer if the
+     * ring is full. The record is not visible before Publish().
+     */
+    inline T& Next() {
+        if (producer.write - producer.cached_read > mask) {
+            producer.cached_read = read.load(std::memory_order_acquire);
+            if (producer.write - producer.cached_read > mask) {
+                // let the consumer drain what is already written
+                Publish();
+                space.wait([this] {
+                    producer.cached_read = read.load(std::memory_order_acquire);
+                    return producer.write - producer.cached_read <= mask;
+                });
+            }
+        }
+        return slots[producer.write++ & mask];
+    }
+
+    // make every record returned by Next() visible to the consumer
+    inline void Publish() {
+        if (producer.write == producer.published) return;
+        producer.published = producer.write;
+        write.store(producer.write, std::memory_order_release);
+        data.notify();
+    }
+
+    // no record follows the published ones
+    inline void Close() {
+        Publish();
+        closed.store(true, std::memory_order_release);
+        data.notify();
+    }
+
+    // consumer
+
+    /*
+     * @brief handle up to max available records in order with
+     * handler(const T&), then release their slots at once
+     *
+     * @return the number of records handled
+     */
+    template <class Handler>
+    inline std::size_t Consume(Handler&& handler,
+                               const std::size_t max = SIZE_MAX) {
+        if (consumer.cached_write == consumer.read) {
+            consumer.cached_write = write.load(std::memory_order_acquire);
+        }
+        std::size_t available = consumer.cached_write - consumer.read;
+        if (available == 0) return 0;
+        if (available > max) available = max;
+
+        for (std::size_t i = 0; i < available; ++i) {
+            handler(static_cast<const T&>(slots[(consumer.read + i) & mask]));
+        }
+        consumer.read += available;
+        read.store(consumer.read, std::memory_order_release);
+        space.notify();
+        return available;
+    }
+
+    /*
+     * @brief wait until a record is available
+     *
+     * @return false if the ring is closed and drained
+     */
+    inline bool Wait() {
+        data.wait([this] {
+            return write.load(std::memory_order_acquire) != consumer.read ||
+                   closed.load(std::memory_order_acquire);
+        });
+        return write.load(std::memory_order_acquire) != consumer.read;
+    }
+
+    // whether every published record was consumed, from either side
+    inline bool empty() const {
+        return read.load(std::memory_order_acquire) ==
+               write.load(std::memory_order_acquire);
+    }
+
+   private:
+    struct alignas(Ring::cache_line) Producer {
+        std::size_t write = 0;
+        std::size_t published = 0;
+        std::size_t cached_read = 0;
+    };
+
+    struct alignas(Ring::cache_line) Consumer {
+        std::size_t read = 0;
+        std::size_t cached_write = 0;
+    };
+
+    std::unique_ptr<T[]> slots;
+    std::size_t mask;
+
+    alignas(Ring::cache_line) std::atomic<std::size_t> write{0};
+    alignas(Ring::cache_line) std::atomic<std::size_t> read{0};
+    alignas(Ring::cache_line) std::atomic<bool> closed{false};
+
+    Producer producer;
+    Consumer consumer;
+
+    alignas(Ring::cache_line) Waiter data;
+    alignas(Ring::cache_line) Waiter space;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "seek.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utils.hpp"
+
+namespace {
+
+const char seek_magic[8] = {'L', 'O', 'B', 'S', 'E', 'E', 'K', '\0'};
+
+}  // namespace
+
+/*
+ * @brief SeekIndex class
+ */
+std::size_t SeekIndex::write(std::vector<uint8_t> &buffer) const {
+    const std::size_t start = buffer.size();
+    buffer.reserve(start + sizeof(Header) +
+                   _entries.size() * sizeof(SeekEntry));
+
+    Header header{};
+    std::memcpy(header.magic, seek_magic, sizeof(header.magic));
+    header.version = version;
+    header.interval_messages = _interval_messages;
+    header.interval_time = _interval_time;
+    header.end = _end;
+    header.entries = _entries.size();
+    Checkpoint::Append(buffer, header);
+
+    const std::size_t size = buffer.size();
+    buffer.resize(size + _entries.size() * sizeof(SeekEntry));
+    if (!_entries.empty()) {
+        std::memcpy(buffer.data() + size, _entries.data(),
+                    _entries.size() * sizeof(SeekEntry));
+    }
+    return buffer.size() - start;
+}
+
+bool SeekIndex::read(const void *data, const std::size_t size) {
+    _entries.clear();
+    _end = Checkpoint::Position{};
+
+    std::size_t offset = 0;
+    Header header;
+    if (!Checkpoint::Read(data, size, offset, header) ||
+        std::memcmp(header.magic, seek_magic, sizeof(seek_magic)) != 0 ||
+        header.version != version ||
+        header.entries > (size - offset) / sizeof(SeekEntry)) {
+        return false;
+    }
+
+    _entries.resize(header.entries);
+    if (header.entries != 0) {
+        std::memcpy(_entries.data(),
+                    static_cast<const uint8_t *>(data) + offset,
+                    header.entries * sizeof(SeekEntry));
+    }
+    _end = header.end;
+    _interval_messages = header.interval_messages;
+    _interval_time = header.interval_time;
+    return true;
+}
+
+const SeekEntry *SeekIndex::seek(const uint64_t timestamp) const {
+    if (_entries.empty()) {
+        return nullptr;
+    }
+
+    const auto found = std::upper_bound(
+        _entries.begin(), _entries.end(), timestamp,
+        [](const uint64_t time, const SeekEntry &entry) {
+            return time < entry.timestamp;
+        });
+    return found == _entries.begin() ? &_entries.front() : &*(found - 1);
+}
+
+Checkpoint::Position SeekIndex::locate(const void *stream,
+                                       const std::size_t size,
+                                       const uint64_t timestamp) const {
+    const uint8_t *data = static_cast<const uint8_t *>(stream);
+    // start from the last entry strictly before the time, messages
+    // sharing the timestamp of an entry may precede it
+    const auto found = std::lower_bound(
+        _entries.begin(), _entries.end(), timestamp,
+        [](const SeekEntry &entry, const uint64_t time) {
+            return entry.timestamp < time;
+        });
+    Checkpoint::Position position = found != _entries.begin()
+                                        ? (found - 1)->position
+                                        : Checkpoint::Position{};
+
+    const std::size_t end = std::min<std::size_t>(size, _end.offset);
+    while (position.offset + 2 <= end) {
+        const std::size_t length =
+            Utils::LoadBigEndian16(data + position.offset);
+        if (position.offset + 2 + length > end) {
+            break;
+        }
+        if (length >= 11 &&
+            Utils::LoadBigEndian48(data + position.offset + 7) >= timestamp) {
+            break;
+        }
+        position.sequence += length != 0;
+        position.offset += 2 + length;
+    }
+    return position;
+}
+
+/*
+ * @brief SeekIndexBuilder class
+ */
+SeekIndexBuilder::SeekIndexBuilder(const uint64_t interval_messages,
+                                   const uint64_t interval_time) {
+    _index._interval_messages = std::max<uint64_t>(interval_messages, 1);
+    _index._interval_time = interval_time;
+}
+
+void SeekIndexBuilder::Sample(const uint8_t *frame,
+                              const uint64_t frame_offset) {
+    const std::size_t length = Utils::LoadBigEndian16(frame);
+    remaining = 2 + length;
+    // frames of length 0 carry no message
+    if (length == 0) {
+        return;
+    }
+
+    const uint64_t time =
+        length >= 11 ? Utils::LoadBigEndian48(frame + 7) : last_time;
+    std::vector<SeekEntry> &entries = _index._entries;
+    if (entries.empty() ||
+        count - last_messages >= _index._interval_messages ||
+        time >= last_time + _index._interval_time) {
+        entries.push_back(SeekEntry{time, {frame_offset, count}});
+        last_messages = count;
+        last_time = time;
+    }
+    ++count;
+}
+
+void SeekIndexBuilder::Process(const void *buffer, const std::size_t size) {
+    const uint8_t *data = static_cast<const uint8_t *>(buffer);
+    std::size_t position = 0;
+
+    while (position < size) {
+        // skip the rest of the current frame
+        if (remaining != 0) {
+            const std::size_t skip = std::min(remaining, size - position);
+            position += skip;
+            offset += skip;
+            remaining -= skip;
+            if (remaining == 0) {
+                _index._end = Checkpoint::Position{offset, count};
+            }
+            continue;
+        }
+
+        // the prefix of the next frame is in the block
+        if (prefix_length == 0 && size - position >= prefix_size) {
+            Sample(data + position, offset);
+            continue;
+        }
+
+        // the prefix spans the end of the block, it is gathered first
+        prefix[prefix_length++] = data[position++];
+        ++offset;
+        if (prefix_length >= 2) {
+            const std::size_t length = Utils::LoadBigEndian16(prefix);
+            if (prefix_length == std::min(prefix_size, 2 + length)) {
+                Sample(prefix, offset - prefix_length);
+                remaining -= prefix_length;
+                prefix_length = 0;
+                if (remaining == 0) {
+                    _index._end = Checkpoint::Position{offset, count};
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * Seek header defines the timestamp index of an ITCH stream, a sidecar
+ * to start a replay near a time of day rather than from byte 0:
+ *  - SeekEntry, the exchange timestamp of a message along with the
+ *    stream position of its frame (see Checkpoint::Position)
+ *  - SeekIndex, the entries of a stream, written to and read from a
+ *    binary sidecar, and the lookup of a time
+ *  - SeekIndexBuilder, sampling an entry every interval_messages
+ *    messages or interval_time nanoseconds of exchange time, in a single
+ *    streaming pass over consecutive blocks
+ *
+ * An entry points at the length prefix of its frame, its sequence is the
+ * number of messages before it, as for checkpoints: a replay jumps to a
+ * time by restoring a checkpoint taken at or before the entry found, or
+ * starting from byte 0 when there is none, and processing the bytes up
+ * to the entry, or up to the exact message given by SeekIndex::locate.
+ *
+ * Records are fixed-size and 8-byte aligned, in host byte order, so an
+ * index file can be read from a mapping of it.
+ *
+ * Not thread-safe
+ */
+
+#ifndef SEEK_HPP
+#define SEEK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "checkpoint.hpp"
+
+struct SeekEntry {
+    // nanoseconds since midnight of the message
+    uint64_t timestamp;
+    Checkpoint::Position position;
+};
+
+static_assert(sizeof(SeekEntry) == 24, "SeekEntry is 24 bytes");
+
+class SeekIndex {
+   public:
+    static const uint32_t version = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t interval_messages;
+        uint64_t interval_time;
+        // bytes and messages of the stream indexed
+        Checkpoint::Position end;
+        uint64_t entries;
+    };
+
+    static_assert(sizeof(Header) == 56, "SeekIndex::Header is 56 bytes");
+
+    /*
+     * @brief append the index to buffer
+     *
+     * @return the size of the index in bytes
+     */
+    std::size_t write(std::vector<uint8_t> &buffer) const;
+
+    /*
+     * @brief replace the entries by an index written by write(), e.g.
+     * mapped from a file
+     *
+     * @return false if the index is invalid, the entries are then cleared
+     */
+    bool read(const void *data, const std::size_t size);
+
+    /*
+     * @brief get the last entry at or before a time, O(log n)
+     *
+     * @param timestamp, nanoseconds since midnight
+     * @return the entry, the first one if every entry is later, nullptr
+     * if the index is empty
+     */
+    const SeekEntry *seek(const uint64_t timestamp) const;
+
+    /*
+     * @brief get the position of the first message at or after a time,
+     * walking the frames of the stream from the last entry before it
+     *
+     * @param stream, the whole stream indexed, e.g. mapped from a file
+     * @return the position, the end of the indexed stream if every
+     * message is earlier
+     */
+    Checkpoint::Position locate(const void *stream, const std::size_t size,
+                                const uint64_t timestamp) const;
+
+    inline const std::vector<SeekEntry> &entries() const { return _entries; }
+    inline const Checkpoint::Position &end() const { return _end; }
+    inline uint64_t interval_messages() const { return _interval_messages; }
+    inline uint64_t interval_time() const { return _interval_time; }
+
+   private:
+    friend class SeekIndexBuilder;
+
+    std::vector<SeekEntry> _entries;
+    Checkpoint::Position _end;
+    uint64_t _interval_messages = 0;
+    uint64_t _interval_time = 0;
+};
+
+class SeekIndexBuilder {
+   public:
+    /*
+     * @brief Constructor
+     *
+     * @param interval_messages, messages between two entries at most
+     * @param interval_time, nanoseconds of exchange time between two
+     * entries at most
+     */
+    explicit SeekIndexBuilder(const uint64_t interval_messages = 1 << 16,
+                              const uint64_t interval_time = 1000000000);
+
+    /*
+     * @brief index the messages of a block, blocks are the consecutive
+     * parts of the stream and frames may span them
+     */
+    void Process(const void *buffer, const std::size_t size);
+
+    // the index of the frames complete so far
+    inline const SeekIndex &index() const { return _index; }
+
+    // number of messages indexed
+    inline uint64_t messages() const { return _index._end.sequence; }
+
+   private:
+    // longest frame prefix read: length, type, locate, tracking number
+    // and timestamp
+    static constexpr std::size_t prefix_size = 2 + 11;
+
+    SeekIndex _index;
+    // bytes and messages seen, the current frame included
+    uint64_t offset = 0;
+    uint64_t count = 0;
+    // sequence and time of the last entry
+    uint64_t last_messages = 0;
+    uint64_t last_time = 0;
+
+    // prefix of a frame spanning two blocks and bytes of the frame left
+    uint8_t prefix[prefix_size];
+    std::size_t prefix_length = 0;
+    std::size_t remaining = 0;
+
+    // count the frame starting at offset, its prefix is complete, and
+    // add an entry for it once an interval elapsed
+    void Sample(const uint8_t *frame, const uint64_t frame_offset);
+};
+
+#endif
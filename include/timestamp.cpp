@@ -0,0 +1,64 @@
+#include "timestamp.hpp"
+
+#include <time.h>
+
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+uint64_t Timestamp::utc() {
+    struct timespec timestamp;
+    clock_gettime(CLOCK_REALTIME, &timestamp);
+    return timestamp.tv_sec * 1000000000ull + timestamp.tv_nsec;
+}
+
+uint64_t Timestamp::local() {
+    const uint64_t timestamp = utc();
+    const time_t seconds = timestamp / 1000000000;
+    struct tm local;
+    if (localtime_r(&seconds, &local) == nullptr) {
+        return timestamp;
+    }
+    return timestamp + local.tm_gmtoff * 1000000000ll;
+}
+
+uint64_t Timestamp::nano() {
+    struct timespec timestamp;
+    clock_gettime(CLOCK_MONOTONIC, &timestamp);
+    return timestamp.tv_sec * 1000000000ull + timestamp.tv_nsec;
+}
+
+uint64_t Timestamp::rdts() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return nano();
+#endif
+}
+
+double Timestamp::rdts_per_nano() {
+    // calibrated once against the monotonic clock over ~10 ms
+    static const double ratio = [] {
+        const uint64_t nano_start = nano();
+        const uint64_t rdts_start = rdts();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const uint64_t rdts_stop = rdts();
+        const uint64_t nano_stop = nano();
+        return nano_stop > nano_start
+                   ? static_cast<double>(rdts_stop - rdts_start) /
+                         (nano_stop - nano_start)
+                   : 1.0;
+    }();
+    return ratio;
+}
+
+void Timestamp::swap(Timestamp& timestamp) noexcept {
+    std::swap(_timestamp, timestamp._timestamp);
+}
+
+void swap(Timestamp& timestamp1, Timestamp& timestamp2) noexcept {
+    timestamp1.swap(timestamp2);
+}
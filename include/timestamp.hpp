@@ -115,6 +115,8 @@ class Timestamp {
     static uint64_t nano();
     // Get the current value RDTS (Read timestamp counter)
     static uint64_t rdts();
+    // Get the RDTS ticks per nanosecond, calibrated on first call
+    static double rdts_per_nano();
 
     // swap two instances
     void swap(Timestamp& timestamp) noexcept;
@@ -1,22 +1,110 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
-#include <cfloat>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 
 namespace Utils {
 enum Side { bid = 0, ask = 1 };
 enum Offset { abs = 0, pct = 1 };
 
-const double max_price = DBL_MAX;
-const double min_price = 0.0;
-const double negative_price = -DBL_MAX;
+/*
+ * Prices are carried as signed integer ticks of a per-book tick size.
+ * ITCH delivers prices as fixed-point integers with four implied decimals,
+ * so the tick size is expressed in units of 1 / price_scale.
+ */
+using Price = int64_t;
+const Price price_scale = 10000;
 
-size_t ReadMessage(const void* buffer, int16_t& value);
-size_t ReadMessage(const void* buffer, int32_t& value);
-size_t ReadMessage(const void* buffer, int64_t& value);
+const Price max_price = INT64_MAX;
+const Price min_price = 0;
+const Price negative_price = INT64_MIN;
+
+/*
+ * Load big-endian integers from unaligned network bytes, a plain load
+ * followed by a byte swap
+ */
+inline uint16_t LoadBigEndian16(const void* buffer) {
+    uint16_t value;
+    std::memcpy(&value, buffer, sizeof(value));
+    return __builtin_bswap16(value);
+}
+
+inline uint32_t LoadBigEndian32(const void* buffer) {
+    uint32_t value;
+    std::memcpy(&value, buffer, sizeof(value));
+    return __builtin_bswap32(value);
+}
+
+inline uint64_t LoadBigEndian64(const void* buffer) {
+    uint64_t value;
+    std::memcpy(&value, buffer, sizeof(value));
+    return __builtin_bswap64(value);
+}
+
+// 6 bytes integer, e.g. ITCH nanoseconds since midnight
+inline uint64_t LoadBigEndian48(const void* buffer) {
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    return (static_cast<uint64_t>(LoadBigEndian16(data)) << 32) |
+           LoadBigEndian32(data + 2);
+}
+
+/*
+ * Store integers as unaligned big-endian network bytes
+ */
+inline void StoreBigEndian16(void* buffer, const uint16_t value) {
+    const uint16_t swapped = __builtin_bswap16(value);
+    std::memcpy(buffer, &swapped, sizeof(swapped));
+}
+
+inline void StoreBigEndian32(void* buffer, const uint32_t value) {
+    const uint32_t swapped = __builtin_bswap32(value);
+    std::memcpy(buffer, &swapped, sizeof(swapped));
+}
+
+inline void StoreBigEndian64(void* buffer, const uint64_t value) {
+    const uint64_t swapped = __builtin_bswap64(value);
+    std::memcpy(buffer, &swapped, sizeof(swapped));
+}
+
+inline void StoreBigEndian48(void* buffer, const uint64_t value) {
+    uint8_t* data = static_cast<uint8_t*>(buffer);
+    StoreBigEndian16(data, static_cast<uint16_t>(value >> 32));
+    StoreBigEndian32(data + 2, static_cast<uint32_t>(value));
+}
+
+/*
+ * Read big-endian integers from a network buffer
+ * @return the number of bytes read
+ */
+inline size_t ReadMessage(const void* buffer, uint16_t& value) {
+    value = LoadBigEndian16(buffer);
+    return sizeof(value);
+}
+
+inline size_t ReadMessage(const void* buffer, uint32_t& value) {
+    value = LoadBigEndian32(buffer);
+    return sizeof(value);
+}
+
+inline size_t ReadMessage(const void* buffer, uint64_t& value) {
+    value = LoadBigEndian64(buffer);
+    return sizeof(value);
+}
+
+inline size_t ReadMessage(const void* buffer, int16_t& value) {
+    return ReadMessage(buffer, reinterpret_cast<uint16_t&>(value));
+}
+
+inline size_t ReadMessage(const void* buffer, int32_t& value) {
+    return ReadMessage(buffer, reinterpret_cast<uint32_t&>(value));
+}
+
+inline size_t ReadMessage(const void* buffer, int64_t& value) {
+    return ReadMessage(buffer, reinterpret_cast<uint64_t&>(value));
+}
 
 }  // namespace Utils
 
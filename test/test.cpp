@@ -1,15 +1,570 @@
+#include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
 #include <CppUTest/UtestMacros.h>
 
+#include <zlib.h>
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "../include/archive.hpp"
+#include "../include/book.hpp"
+#include "../include/encoder.hpp"
+#include "../include/frames.hpp"
+#include "../include/journal.hpp"
+#include "../include/latency.hpp"
+#include "../include/manager.hpp"
+#include "../include/replay.hpp"
+#include "../include/seek.hpp"
+
 TEST_GROUP(UnitTest){};
 
-TEST(UnitTest, Queue) {
-    CHECK_TRUE(queue_bids());
-    CHECK_TRUE(queue_ask());
+TEST(UnitTest, Prices) {
+    Book book(100);
+    CHECK_EQUAL(1001, book.to_ticks(10.01));
+    CHECK_EQUAL(1001, book.itch_to_ticks(100100));
+    // prices off the tick round to the nearest one
+    CHECK_EQUAL(1001, book.itch_to_ticks(100149));
+    CHECK_EQUAL(1002, book.itch_to_ticks(100150));
+    DOUBLES_EQUAL(10.01, book.to_price(1001), 1e-9);
+    CHECK_EQUAL(Utils::min_price, book.get_bid_price());
+    CHECK_EQUAL(Utils::max_price, book.get_ask_price());
+    CHECK_THROWS(std::invalid_argument, Book(0));
+}
+
+TEST(UnitTest, Cancel) {
+    Book book;
+    auto first = std::make_shared<Order>(Utils::Side::bid, 100, 5.0);
+    auto second = std::make_shared<Order>(Utils::Side::bid, 100, 3.0);
+    book.insert(first);
+    book.insert(second);
+
+    CHECK_TRUE(first->cancel());
+    CHECK_FALSE(first->is_queued());
+    CHECK_FALSE(first->cancel());
+
+    auto limit = book.bid_limit_at_price(100);
+    CHECK_EQUAL(1, limit->second.order_count());
+    DOUBLES_EQUAL(3.0, limit->second.get_quantity(), 1e-9);
+    CHECK_TRUE(*limit->second.begin() == second);
+
+    // pooled orders outlive their book, released from it
+    std::shared_ptr<Order> pooled;
+    {
+        Book owner;
+        pooled = owner.insert<Order>(Utils::Side::ask, 105, 2.0);
+    }
+    CHECK_FALSE(pooled->is_queued());
+    CHECK_TRUE(pooled->get_book() == nullptr);
+    DOUBLES_EQUAL(2.0, pooled->get_quantity(), 1e-9);
+    CHECK_FALSE(pooled->cancel());
+}
+
+TEST(UnitTest, OrderReference) {
+    Book book;
+    book.reserve_orders(1024);
+    book.insert<Order>(Utils::Side::ask, 101, 10.0, false, false, 7);
+
+    CHECK_TRUE(book.execute(7, 4.0));
+    CHECK_EQUAL(101, book.get_market_price());
+    DOUBLES_EQUAL(6.0, book.find_order(7)->get_quantity(), 1e-9);
+
+    auto replacement = book.replace(7, 8, 102, 5.0);
+    CHECK_TRUE(book.find_order(7) == nullptr);
+    CHECK_TRUE(book.find_order(8) == replacement);
+    CHECK_EQUAL(102, book.get_ask_price());
+
+    CHECK_TRUE(book.remove(8));
+    CHECK_FALSE(book.remove(8));
+    CHECK_EQUAL(Utils::max_price, book.get_ask_price());
+}
+
+TEST(UnitTest, DuplicateReference) {
+    Book book;
+    book.enable_execution_reports(true);
+    auto first = book.insert<Order>(Utils::Side::bid, 100, 5.0, false,
+                                    false, 7);
+    auto second = book.insert<Order>(Utils::Side::bid, 99, 3.0, false,
+                                     false, 7);
+
+    // the second order is refused, the first one stays reachable
+    CHECK_TRUE(first->is_queued());
+    CHECK_FALSE(second->is_queued());
+    CHECK_EQUAL(ExecutionReport::rejected,
+                book.get_execution_reports().back().type);
+    CHECK_EQUAL(1, book.get_order_count());
+    CHECK_TRUE(book.find_order(7) == first);
+    CHECK_TRUE(book.cancel(7, 5.0));
+    CHECK_EQUAL(0, book.get_order_count());
+}
+
+TEST(UnitTest, PassiveAdds) {
+    // an add crossing the book, as before the opening cross, rests
+    BookManager manager(100);
+    CHECK_TRUE(manager.add_book(1, "AAPL"));
+    CHECK_TRUE(manager.add_order(1, 1, Utils::Side::bid, 100, 1010000));
+    CHECK_TRUE(manager.add_order(1, 2, Utils::Side::ask, 200, 1000000));
+    Book *book = manager.get_book(1);
+    CHECK_EQUAL(2, book->get_order_count());
+    CHECK_EQUAL(10100, book->get_bid_price());
+    CHECK_EQUAL(10000, book->get_ask_price());
+
+    // replaced passively too, every reference stays reachable
+    CHECK_TRUE(manager.replace(1, 1, 3, 100, 1020000));
+    CHECK_EQUAL(10200, book->get_bid_price());
+    CHECK_TRUE(manager.execute(1, 3, 100));
+    CHECK_TRUE(manager.remove(1, 2));
+    CHECK_EQUAL(0, book->get_order_count());
+    CHECK_FALSE(manager.add_order(1, 4, Utils::Side::bid, 0, 1000000));
+}
+
+TEST(UnitTest, ExecutedWithPrice) {
+    BookManager manager(100);
+    CHECK_TRUE(manager.add_book(1, "AAPL"));
+    CHECK_TRUE(manager.add_order(1, 1, Utils::Side::ask, 300, 1000000));
+    Book *book = manager.get_book(1);
+    const Utils::Price market_price = book->get_market_price();
+    auto stop = book->insert<Trigger>(Utils::Side::ask, 10050);
+    CHECK_TRUE(stop->is_queued());
+
+    // a non-printable execution leaves the market price and triggers alone
+    std::vector<uint8_t> stream;
+    MessageTypes::Encoder encoder(stream);
+    MessageTypes::Header header;
+    header.locate = 1;
+    encoder.OrderExecutedWithPrice(header, 1, 100, 1, 'N', 1010000);
+    CHECK_TRUE(manager.Process(stream.data(), stream.size()));
+    DOUBLES_EQUAL(200.0, book->find_order(1)->get_quantity(), 1e-9);
+    CHECK_EQUAL(market_price, book->get_market_price());
+    CHECK_TRUE(stop->is_queued());
+
+    // a printable one trades at the execution price, not the order's
+    stream.clear();
+    encoder.OrderExecutedWithPrice(header, 1, 100, 2, 'Y', 1010000);
+    CHECK_TRUE(manager.Process(stream.data(), stream.size()));
+    DOUBLES_EQUAL(100.0, book->find_order(1)->get_quantity(), 1e-9);
+    CHECK_EQUAL(10100, book->get_market_price());
+    CHECK_FALSE(stop->is_queued());
+}
+
+TEST(UnitTest, Rebalance) {
+    // codes 1 and 3 on worker 1, 2 and 4 on worker 0 by default
+    const std::size_t adds[] = {0, 60, 10, 20, 10};
+    std::vector<uint8_t> stream;
+    MessageTypes::Encoder encoder(stream);
+    MessageTypes::Header header;
+    uint64_t reference = 1;
+    for (uint16_t locate = 1; locate <= 4; ++locate) {
+        header.locate = locate;
+        encoder.StockDirectory(header, "TEST", 'Q', 'N', 100, 'N', 'C', "Z",
+                               'P', 'N', 'N', '1', 'N', 0, 'N');
+        for (std::size_t i = 0; i < adds[locate]; ++i) {
+            encoder.AddOrder(header, reference++, 'B', 100, "TEST", 10000);
+        }
+    }
+
+    ShardedReplay replay(2);
+    CHECK_TRUE(replay.Process(stream.data(), stream.size()));
+    // code 1 alone outweighs the other worker, only code 3 moves
+    CHECK_EQUAL(1, replay.Rebalance());
+    CHECK_EQUAL(1, replay.worker_of(1));
+    CHECK_EQUAL(0, replay.worker_of(3));
+    CHECK_EQUAL(0, replay.worker_of(2));
+    CHECK_EQUAL(100, replay.order_count());
+    CHECK_EQUAL(20, replay.get_book(3)->get_order_count());
+
+    // balanced load, nothing moves
+    stream.clear();
+    for (uint16_t locate = 1; locate <= 2; ++locate) {
+        header.locate = locate;
+        for (std::size_t i = 0; i < 10; ++i) {
+            encoder.AddOrder(header, reference++, 'B', 100, "TEST", 10000);
+        }
+    }
+    CHECK_TRUE(replay.Process(stream.data(), stream.size()));
+    CHECK_EQUAL(0, replay.Rebalance());
+    replay.Flush();
+    CHECK_EQUAL(120, replay.order_count());
+    CHECK_EQUAL(0, replay.errors());
+}
+
+TEST(UnitTest, FrameIndex) {
+    // a delete message, an 'A' one byte short and a truncated frame
+    uint8_t block[2 + 19 + 2 + 35 + 4] = {0, 19, 'D'};
+    block[21] = 0;
+    block[22] = 35;
+    block[23] = 'A';
+    block[58] = 0;
+    block[59] = 36;
+    block[60] = 'A';
+
+    FrameIndexer indexer;
+    CHECK_EQUAL(58, indexer.Index(block, sizeof(block)));
+    CHECK_EQUAL(2, indexer.size());
+    CHECK_EQUAL(2, indexer[0].offset);
+    CHECK_EQUAL(19, indexer[0].length);
+    CHECK_EQUAL('A', indexer[1].type);
+    CHECK_EQUAL(1, indexer.Validate());
+}
+
+TEST(UnitTest, Depth) {
+    Book book;
+    book.enable_depth_deltas(true);
+    book.insert<Order>(Utils::Side::bid, 100, 5.0, false, false, 1);
+    book.insert<Order>(Utils::Side::bid, 101, 3.0, false, false, 2);
+    book.insert<Order>(Utils::Side::bid, 100, 2.0, false, false, 3);
+
+    const Depth &bids = book.get_bid_depth();
+    CHECK_EQUAL(2, bids.size());
+    CHECK_EQUAL(101, bids[0].price);
+    DOUBLES_EQUAL(7.0, bids[1].quantity, 1e-9);
+    CHECK_EQUAL(2, bids[1].orders);
+
+    CHECK_TRUE(book.remove(2));
+    CHECK_EQUAL(1, bids.size());
+    CHECK_EQUAL(100, bids[0].price);
+
+    // 100 added at 0, 101 added at 0, 100 updated at 1, 101 removed
+    const auto &deltas = book.get_depth_deltas();
+    CHECK_EQUAL(4, deltas.size());
+    CHECK_EQUAL(DepthDelta::add, deltas[1].action);
+    CHECK_EQUAL(0, deltas[1].index);
+    CHECK_EQUAL(DepthDelta::update, deltas[2].action);
+    CHECK_EQUAL(1, deltas[2].index);
+    CHECK_EQUAL(DepthDelta::remove, deltas[3].action);
+    CHECK_EQUAL(0, deltas[3].index);
+}
+
+TEST(UnitTest, Trigger) {
+    Book book;
+    auto falling = book.insert<Trigger>(Utils::Side::bid, 99);
+    book.insert<Order>(Utils::Side::ask, 101, 1.0);
+    auto stop = book.insert<Trigger>(Utils::Side::ask, 101);
+    auto canceled = book.insert<Trigger>(Utils::Side::ask, 101);
+    CHECK_TRUE(stop->is_queued());
+    // orders that do not trade leave the market price and triggers alone
+    CHECK_TRUE(falling->is_queued());
+    CHECK_TRUE(canceled->cancel());
+    CHECK_FALSE(canceled->cancel());
+
+    // the trade at 101 fires the ask trigger
+    book.insert<Order>(Utils::Side::bid, 101, 1.0);
+    CHECK_EQUAL(101, book.get_market_price());
+    CHECK_FALSE(stop->is_queued());
+    CHECK_TRUE(stop->get_book() == nullptr);
+}
+
+TEST(UnitTest, InsertBatch) {
+    Book book;
+    std::vector<SharedOrderPtr> orders{
+        std::make_shared<Order>(Utils::Side::bid, 100, 2.0, false, false, 1),
+        std::make_shared<Order>(Utils::Side::ask, 102, 1.0, false, false, 2),
+        std::make_shared<Order>(Utils::Side::ask, 100, 1.0, false, false, 3),
+        std::make_shared<Order>(Utils::Side::ask, 101, 0.0, false, false, 4)};
+    book.insert_batch(orders.data(), orders.size());
+
+    // the third order trades with the first, the fourth is rejected
+    CHECK_EQUAL(100, book.get_market_price());
+    CHECK_EQUAL(100, book.get_bid_price());
+    CHECK_EQUAL(102, book.get_ask_price());
+    DOUBLES_EQUAL(1.0, orders[0]->get_quantity(), 1e-9);
+    CHECK_EQUAL(2, book.get_order_count());
+    CHECK_FALSE(orders[3]->is_queued());
+}
+
+TEST(UnitTest, AllOrNothing) {
+    Book book;
+    auto aon = book.insert<Order>(Utils::Side::ask, 100, 5.0, false, true, 1);
+    book.insert<Order>(Utils::Side::bid, 100, 2.0, false, false, 2);
+    CHECK_TRUE(aon->is_queued());
+    DOUBLES_EQUAL(2.0, book.get_bid_volume(100), 1e-9);
+    DOUBLES_EQUAL(5.0, book.get_ask_volume(101), 1e-9);
+    DOUBLES_EQUAL(0.0, book.get_ask_volume(99), 1e-9);
+
+    // the bid above the ask completes the volume it needs
+    book.insert<Order>(Utils::Side::bid, 101, 3.0, false, false, 3);
+    CHECK_FALSE(aon->is_queued());
+    CHECK_EQUAL(100, book.get_market_price());
+    CHECK_EQUAL(0, book.get_order_count());
+    DOUBLES_EQUAL(0.0, book.get_bid_volume(100), 1e-9);
+}
+
+TEST(UnitTest, ExecutionReports) {
+    Book book;
+    book.enable_execution_reports(true);
+    book.insert<Order>(Utils::Side::ask, 101, 3.0, false, false, 1);
+    book.insert<Order>(Utils::Side::bid, 101, 1.0, false, false, 2);
+    CHECK_TRUE(book.cancel(1, 1.0));
+
+    // accepted and queued ask, accepted bid filled by it, partial cancel
+    const auto &reports = book.get_execution_reports();
+    CHECK_EQUAL(5, reports.size());
+    CHECK_EQUAL(ExecutionReport::queued, reports[1].type);
+    CHECK_EQUAL(ExecutionReport::fill, reports[3].type);
+    CHECK_EQUAL(2, reports[3].id);
+    CHECK_EQUAL(1, reports[3].maker_id);
+    CHECK_EQUAL(101, reports[3].price);
+    DOUBLES_EQUAL(1.0, reports[3].quantity, 1e-9);
+    CHECK_EQUAL(ExecutionReport::canceled, reports[4].type);
+
+    book.clear_execution_reports();
+    CHECK_TRUE(book.get_execution_reports().empty());
+
+    // the bid releasing an all-or-nothing ask is queued before its fills
+    book.insert<Order>(Utils::Side::ask, 99, 3.0, false, true, 3);
+    book.insert<Order>(Utils::Side::bid, 99, 1.0, false, false, 4);
+    book.insert<Order>(Utils::Side::bid, 100, 2.0, false, false, 5);
+    std::size_t queued = reports.size(), filled = reports.size();
+    for (std::size_t i = reports.size(); i-- > 0;) {
+        if (reports[i].type == ExecutionReport::queued && reports[i].id == 5) {
+            queued = i;
+        }
+        if (reports[i].type == ExecutionReport::fill) {
+            filled = i;
+        }
+    }
+    CHECK_TRUE(filled < reports.size());
+    CHECK_TRUE(queued < filled);
+}
+
+TEST(UnitTest, Checkpoint) {
+    Book book;
+    book.insert<Order>(Utils::Side::bid, 100, 5.0, false, false, 1);
+    book.insert<Order>(Utils::Side::bid, 100, 2.0, false, true, 2);
+    book.insert<Order>(Utils::Side::ask, 101, 1.0, false, false, 3);
+    book.insert<Order>(Utils::Side::bid, 101, 1.0, false, false, 4);
+    book.insert<Trigger>(Utils::Side::ask, 110);
+
+    std::vector<uint8_t> buffer;
+    const std::size_t size =
+        book.checkpoint(buffer, Checkpoint::Position{1234, 56});
+
+    Book copy;
+    Checkpoint::Position position;
+    CHECK_EQUAL(size, copy.restore(buffer.data(), buffer.size(), &position));
+    CHECK_EQUAL(1234, position.offset);
+    CHECK_EQUAL(101, copy.get_market_price());
+    CHECK_EQUAL(2, copy.get_order_count());
+    auto limit = copy.bid_limit_at_price(100);
+    CHECK_TRUE((*limit->second.begin())->get_id() == 1);
+    DOUBLES_EQUAL(2.0, limit->second.get_all_or_nothing_quantity(), 1e-9);
+
+    // orders held outside the book survive a restore, no longer queued
+    auto held = copy.insert<Order>(Utils::Side::ask, 105, 7.0, false, false,
+                                   9);
+    CHECK_EQUAL(size, copy.restore(buffer.data(), buffer.size()));
+    CHECK_FALSE(held->is_queued());
+    CHECK_TRUE(held->get_book() == nullptr);
+    copy.insert<Order>(Utils::Side::ask, 106, 3.0, false, false, 10);
+    CHECK_EQUAL(9, held->get_id());
+    DOUBLES_EQUAL(7.0, held->get_quantity(), 1e-9);
+    CHECK_EQUAL(3, copy.get_order_count());
+
+    // checkpoints of another tick size are refused
+    Book other(100);
+    CHECK_EQUAL(0, other.restore(buffer.data(), buffer.size()));
+}
+
+TEST(UnitTest, Journal) {
+    const char *path = "test_journal.jrn";
+    OrderJournal journal;
+    CHECK_TRUE(journal.Open(path, 1, true));
+
+    Book book;
+    book.set_journal(&journal);
+    book.insert<Order>(Utils::Side::bid, 100, 5.0, false, false, 1);
+    book.insert<Order>(Utils::Side::bid, 100, 2.0, false, true, 2);
+    book.insert<Order>(Utils::Side::ask, 102, 3.0, false, false, 3);
+    book.cancel(1, 1.0);
+    book.execute(3, 1.0);
+    book.replace(2, 4, 101, 2.0);
+    book.insert<Order>(Utils::Side::ask, 100, 1.0, false, false, 5);
+    // changes of resting orders are journaled as well
+    book.find_order(3)->set_quantity(4.0);
+    book.find_order(1)->set_all_or_nothing(true);
+    CHECK_TRUE(journal.Sync());
+    CHECK_EQUAL(10, journal.durable_sequence());
+    journal.Close();
+    CHECK_EQUAL(10, journal.get_metrics().commands);
+
+    // replaying the journal rebuilds the same book
+    FileSystem::MappedFile file(path);
+    CHECK_TRUE(file.Open());
+    Book copy;
+    uint64_t last = 0;
+    const std::size_t applied =
+        Journal::Replay(file.data(), file.size(), copy, 0, &last);
+    CHECK_EQUAL(10, applied);
+    CHECK_EQUAL(10, last);
+    std::vector<uint8_t> expected, replayed;
+    book.checkpoint(expected);
+    copy.checkpoint(replayed);
+    CHECK_TRUE(expected == replayed);
+
+    file.Close();
+    std::remove(path);
 }
 
-Test(UnitTest, Inserts) {
-    CHECK_TRUE(insert_marketable_bid());
-    CHECK_TRUE(insert_marketable_ask());
+TEST(UnitTest, SeekIndex) {
+    // ten delete messages a microsecond apart
+    std::vector<uint8_t> stream;
+    MessageTypes::Encoder encoder(stream);
+    MessageTypes::Header header;
+    for (uint64_t i = 0; i < 10; ++i) {
+        header.timestamp = 1000 * i;
+        encoder.OrderDelete(header, i + 1);
+    }
+
+    // an entry every 4 messages, frames spanning the blocks
+    SeekIndexBuilder builder(4, 1000000);
+    for (std::size_t offset = 0; offset < stream.size(); offset += 5) {
+        builder.Process(stream.data() + offset,
+                        std::min<std::size_t>(5, stream.size() - offset));
+    }
+    CHECK_EQUAL(10, builder.messages());
+    CHECK_EQUAL(3, builder.index().entries().size());
+
+    std::vector<uint8_t> buffer;
+    builder.index().write(buffer);
+    SeekIndex index;
+    CHECK_TRUE(index.read(buffer.data(), buffer.size()));
+    CHECK_EQUAL(stream.size(), index.end().offset);
+
+    const SeekEntry *entry = index.seek(4500);
+    CHECK_EQUAL(4000, entry->timestamp);
+    CHECK_EQUAL(4, entry->position.sequence);
+    CHECK_EQUAL(4 * (2 + 19), entry->position.offset);
+    const Checkpoint::Position position =
+        index.locate(stream.data(), stream.size(), 4500);
+    CHECK_EQUAL(5, position.sequence);
+    CHECK_EQUAL(5 * (2 + 19), position.offset);
+
+    // the entry at sequence 4 shares its timestamp with message 3
+    const uint64_t times[] = {0, 1000, 2000, 4000, 4000, 5000, 6000};
+    std::vector<uint8_t> same;
+    MessageTypes::Encoder same_encoder(same);
+    for (std::size_t i = 0; i < 7; ++i) {
+        header.timestamp = times[i];
+        same_encoder.OrderDelete(header, i + 1);
+    }
+    SeekIndexBuilder same_builder(4, 1000000);
+    same_builder.Process(same.data(), same.size());
+    CHECK_EQUAL(4000, same_builder.index().entries()[1].timestamp);
+    const Checkpoint::Position first =
+        same_builder.index().locate(same.data(), same.size(), 4000);
+    CHECK_EQUAL(3, first.sequence);
+    CHECK_EQUAL(3 * (2 + 19), first.offset);
+}
+
+TEST(UnitTest, Archive) {
+    std::vector<uint8_t> stream(100000);
+    for (std::size_t i = 0; i < stream.size(); ++i) {
+        stream[i] = static_cast<uint8_t>(i * 7 / 3);
+    }
+
+    // two gzip members, read back as one stream in blocks of 4 KB
+    const char *path = "test_archive.gz";
+    gzFile gz = gzopen(path, "wb");
+    gzwrite(gz, stream.data(), 60000);
+    gzclose(gz);
+    gz = gzopen(path, "ab");
+    gzwrite(gz, stream.data() + 60000, stream.size() - 60000);
+    gzclose(gz);
+
+    FileSystem::ArchiveReader archive(path, 4096, 2);
+    CHECK_TRUE(archive.Open());
+    CHECK_TRUE(archive.compression() == FileSystem::Compression::gzip);
+    std::vector<uint8_t> read;
+    const void *data;
+    std::size_t size;
+    while (archive.Next(data, size)) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        read.insert(read.end(), bytes, bytes + size);
+    }
+    CHECK_FALSE(archive.failed());
+    CHECK_TRUE(read == stream);
+    CHECK_EQUAL(stream.size(), archive.size());
+
+    archive.Close();
+    std::remove(path);
+}
+
+TEST(UnitTest, AsyncReader) {
+    // 300 delete messages, frames spanning the 4 KB blocks
+    std::vector<uint8_t> stream;
+    MessageTypes::Encoder encoder(stream);
+    MessageTypes::Header header;
+    for (uint64_t i = 0; i < 300; ++i) {
+        header.timestamp = 1000 * i;
+        encoder.OrderDelete(header, i + 1);
+    }
+    const char *path = "test_reader.itch";
+    FileSystem::FileWriter writer(path);
+    CHECK_TRUE(writer.Open(true));
+    CHECK_TRUE(writer.Write(stream.data(), stream.size()));
+    writer.Close();
+
+    // io_uring when available, then the pread thread
+    for (const bool uring : {true, false}) {
+        FileSystem::AsyncReader reader(path, 4096, 2);
+        CHECK_TRUE(reader.Open(false, uring));
+        CHECK_EQUAL(stream.size(), reader.size());
+        SeekIndexBuilder builder;
+        std::vector<uint8_t> read;
+        const void *data;
+        std::size_t size;
+        while (reader.Next(data, size)) {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            read.insert(read.end(), bytes, bytes + size);
+            builder.Process(data, size);
+        }
+        CHECK_FALSE(reader.failed());
+        CHECK_TRUE(read == stream);
+        CHECK_EQUAL(300, builder.messages());
+    }
+
+    std::remove(path);
+}
+
+TEST(UnitTest, LatencyHistogram) {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value);
+    }
+    LatencyHistogram other;
+    other.record(1000000);
+    histogram.merge(other);
+
+    CHECK_EQUAL(1001, histogram.count());
+    CHECK_EQUAL(1, histogram.min());
+    CHECK_EQUAL(1000000, histogram.max());
+    // 500 falls in the bucket [496, 511]
+    CHECK_EQUAL(511, histogram.percentile(0.5));
+    CHECK_EQUAL(1000000, histogram.percentile(1.0));
 }
 
+TEST(UnitTest, Encoder) {
+    std::vector<uint8_t> buffer;
+    MessageTypes::Encoder encoder(buffer);
+    MessageTypes::Header header;
+    header.locate = 7;
+    header.timestamp = 0x123456789abc;
+
+    auto message = encoder.AddOrderMPIDAttribution(header, 42, 'S', 300,
+                                                   "MSFT", 1234500, "ABCD");
+    CHECK_EQUAL(2 + 40, buffer.size());
+    CHECK_EQUAL(40, Utils::LoadBigEndian16(buffer.data()));
+    CHECK_EQUAL('F', message.Type());
+    CHECK_EQUAL(7, message.StockLocate());
+    CHECK_EQUAL(0x123456789abc, message.Timestamp());
+    CHECK_EQUAL(42, message.OrderReferenceNumber());
+    CHECK_EQUAL('S', message.BuySellIndicator());
+    CHECK_EQUAL(300, message.Shares());
+    CHECK_TRUE(message.Stock() == "MSFT    ");
+    CHECK_EQUAL(1234500, message.Price());
+    CHECK_TRUE(message.Attribution() == "ABCD");
+}
+
+int main(int argc, char **argv) {
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,148 @@
+/*
+ * Synthetic ITCH 5.0 stream generator (see include/generator.hpp)
+ *
+ * Build from the repository root with make generator, e.g.
+ *   ./generator --messages 100000000 --symbols 8000 --seed 7 -o day.itch
+ *
+ * The stream is written with the 2 bytes length prefix of every message,
+ * to a file or to stdout, and can be replayed by main. --messages counts
+ * the order messages, the system events and the directory excluded.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../include/generator.hpp"
+
+namespace {
+
+struct Option {
+    const char* name;
+    const char* help;
+};
+
+const Option options[] = {
+    {"--messages", "order messages to generate (1000000)"},
+    {"--seed", "random seed (1)"},
+    {"--symbols", "number of symbols, at most 65535 (100)"},
+    {"--zipf", "Zipf exponent of the symbol popularity (1.0)"},
+    {"--add", "relative frequency of adds (0.45)"},
+    {"--cancel", "relative frequency of partial cancels (0.10)"},
+    {"--delete", "relative frequency of deletes (0.30)"},
+    {"--execute", "relative frequency of executions (0.10)"},
+    {"--replace", "relative frequency of replaces (0.05)"},
+    {"--depth", "most resting orders per symbol (200)"},
+    {"--levels", "mean distance from the mid price in ticks (4)"},
+    {"--walk", "probability of a mid price move per message (0.05)"},
+    {"-o", "output file (stdout)"},
+};
+
+void Usage(const char* program) {
+    std::fprintf(stderr, "usage: %s [options]\n", program);
+    for (const Option& option : options) {
+        std::fprintf(stderr, "  %-12s %s\n", option.name, option.help);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    std::size_t messages = 1000000;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string name = argv[i];
+        if (name == "-h" || name == "--help") {
+            Usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 == argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+
+        if (name == "--messages") {
+            messages = std::strtoull(value, nullptr, 10);
+        } else if (name == "--seed") {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else if (name == "--symbols") {
+            config.symbols = std::strtoull(value, nullptr, 10);
+        } else if (name == "--zipf") {
+            config.zipf = std::strtod(value, nullptr);
+        } else if (name == "--add") {
+            config.add_ratio = std::strtod(value, nullptr);
+        } else if (name == "--cancel") {
+            config.cancel_ratio = std::strtod(value, nullptr);
+        } else if (name == "--delete") {
+            config.delete_ratio = std::strtod(value, nullptr);
+        } else if (name == "--execute") {
+            config.execute_ratio = std::strtod(value, nullptr);
+        } else if (name == "--replace") {
+            config.replace_ratio = std::strtod(value, nullptr);
+        } else if (name == "--depth") {
+            config.depth = std::strtoull(value, nullptr, 10);
+        } else if (name == "--levels") {
+            config.levels = std::strtod(value, nullptr);
+        } else if (name == "--walk") {
+            config.walk = std::strtod(value, nullptr);
+        } else if (name == "-o") {
+            path = value;
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const double ratios = config.add_ratio + config.cancel_ratio +
+                          config.delete_ratio + config.execute_ratio +
+                          config.replace_ratio;
+    if (config.symbols == 0 || config.symbols > 65535 || config.depth == 0 ||
+        config.levels < 0 || config.add_ratio <= 0 || ratios <= 0) {
+        std::fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+
+    std::FILE* file = path != nullptr ? std::fopen(path, "wb") : stdout;
+    if (file == nullptr) {
+        std::perror(path);
+        return 1;
+    }
+
+    Generator generator(config);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(1 << 22);
+
+    const std::size_t chunk = 1 << 16;
+    std::size_t done = 0;
+    bool written = true;
+    generator.start(buffer);
+    while (written) {
+        const std::size_t count = std::min(chunk, messages - done);
+        generator.generate(count, buffer);
+        done += count;
+        if (done == messages) generator.finish(buffer);
+
+        written = std::fwrite(buffer.data(), 1, buffer.size(), file) ==
+                  buffer.size();
+        buffer.clear();
+        if (done == messages) break;
+    }
+
+    if (path != nullptr && std::fclose(file) != 0) written = false;
+    if (!written) {
+        std::perror(path != nullptr ? path : "stdout");
+        return 1;
+    }
+
+    std::fprintf(stderr, "%zu messages, %zu resting orders\n",
+                 generator.messages(), generator.order_count());
+    return 0;
+}